@@ -5,11 +5,18 @@
 
 
 #include <cereal/archives/portable_binary.hpp>
+#include <chrono>
 #include <founder_graphs/cst.hh>
+#include <founder_graphs/gap_free_text.hh>
+#include <founder_graphs/lcp.hh>
 #include <iostream>
 #include <libbio/file_handling.hh>
+#include <libbio/utility.hh>
+#include <random>
+#include <unistd.h>
 #include "cmdline.h"
 
+namespace fg = founder_graphs;
 namespace lb = libbio;
 
 
@@ -25,44 +32,256 @@ namespace {
 	}
 
 	
-	void build_cst(
+	std::size_t available_memory()
+	{
+		auto const page_size(::sysconf(_SC_PAGESIZE));
+#if defined(_SC_AVPHYS_PAGES)
+		auto const page_count(::sysconf(_SC_AVPHYS_PAGES));
+#else
+		auto const page_count(::sysconf(_SC_PHYS_PAGES));
+#endif
+		if (page_size <= 0 || page_count <= 0)
+			return 0;
+		return std::size_t(page_size) * std::size_t(page_count);
+	}
+	
+	
+	bool cache_fits_in_memory(std::size_t const text_size)
+	{
+		// Estimate the size of the cached text, BWT, suffix array and LCP array,
+		// the latter two bit-compressed, and leave room for working space.
+		auto const width(sdsl::bits::hi(text_size) + 1);
+		auto const estimate(text_size * 3 + 2 * (text_size * width + 7) / 8);
+		return estimate <= available_memory();
+	}
+	
+	
+	template <typename t_fn>
+	double measure_seconds(t_fn &&fn)
+	{
+		auto const start(std::chrono::steady_clock::now());
+		fn();
+		auto const end(std::chrono::steady_clock::now());
+		return std::chrono::duration <double>(end - start).count();
+	}
+	
+	
+	// Visit some ancestors of random leaves as find_founder_block_boundaries does when climbing
+	// the tree to determine the string depths.
+	template <typename t_cst>
+	std::size_t run_queries(t_cst const &cst, std::size_t const query_count)
+	{
+		constexpr std::size_t const max_ancestor_count{16};
+		std::mt19937_64 rng(1);
+		std::uniform_int_distribution <std::size_t> dist(1, cst.csa.size());
+		std::size_t retval{};
+		for (std::size_t i(0); i < query_count; ++i)
+		{
+			auto node(cst.select_leaf(dist(rng)));
+			for (std::size_t j(0); j < max_ancestor_count && node != cst.root(); ++j)
+			{
+				retval += cst.depth(node) + cst.rb(node) - cst.lb(node);
+				node = cst.parent(node);
+			}
+		}
+		return retval;
+	}
+	
+	
+	sdsl::cache_config prepare_cache(
 		char const *input_path,
+		char const *sequence_list_path,
+		bool const input_is_gzipped,
+		std::size_t const buffer_count,
+		char const *cache_directory,
+		std::size_t const thread_count,
 		char const *text_path,
 		char const *sa_path,
 		char const *bwt_path,
 		char const *lcp_path,
 		char const *csa_path,
-		cereal::PortableBinaryOutputArchive &archive
+		bool const needs_all_arrays
 	)
 	{
 		sdsl::cache_config config(false); // Do not remove temporary files automatically.
+		if (cache_directory)
+			config.dir = cache_directory;
+		
 		register_file_if_needed(config, text_path, sdsl::conf::KEY_TEXT, "Text path");
 		register_file_if_needed(config, sa_path, sdsl::conf::KEY_SA, "Suffix array");
 		register_file_if_needed(config, bwt_path, sdsl::conf::KEY_BWT, "BWT");
 		register_file_if_needed(config, lcp_path, sdsl::conf::KEY_LCP, "LCP");
 		register_file_if_needed(config, csa_path, sdsl::conf::KEY_CSA, "CSA");
 
-		founder_graphs::cst_type cst;
-		sdsl::construct(cst, input_path, config, 1);
-		archive(cst);
+		if (sequence_list_path)
+		{
+			// Read the text directly to the cache instead of having SDSL load it from a file.
+			lb::log_time(std::cerr) << "Reading the sequences…\n";
+			sdsl::int_vector <8> text;
+			auto const sequence_count(fg::read_gap_free_text(sequence_list_path, input_is_gzipped, buffer_count, text));
+			sdsl::append_zero_symbol(text);
+			lb::log_time(std::cerr) << "Read " << sequence_count << " sequences, text length " << text.size() << ".\n";
+			
+			// Use SDSL’s RAM file system for the temporary files if possible.
+			if (!cache_directory)
+			{
+				if (cache_fits_in_memory(text.size()))
+				{
+					config.dir = "@";
+					lb::log_time(std::cerr) << "Storing the temporary files in memory.\n";
+				}
+				else
+				{
+					lb::log_time(std::cerr) << "Storing the temporary files in " << config.dir << " since they are not expected to fit in memory.\n";
+				}
+			}
+			
+			sdsl::store_to_cache(text, sdsl::conf::KEY_TEXT, config);
+		}
+		
+		if ((1 < thread_count || needs_all_arrays) && !lcp_path)
+		{
+			// Prepare the text and the suffix array as SDSL would and build the LCP array in parallel.
+			if (!sdsl::cache_file_exists(sdsl::conf::KEY_TEXT, config))
+			{
+				sdsl::int_vector <8> text;
+				sdsl::load_vector_from_file(text, input_path, 1);
+				
+				// As in sdsl::construct(); reports the error.
+				if (!sdsl::contains_no_zero_symbol(text, input_path))
+					std::exit(EXIT_FAILURE);
+				
+				sdsl::append_zero_symbol(text);
+				sdsl::store_to_cache(text, sdsl::conf::KEY_TEXT, config);
+			}
+			
+			if (!sdsl::cache_file_exists(sdsl::conf::KEY_SA, config))
+			{
+				lb::log_time(std::cerr) << "Building the suffix array…\n";
+				sdsl::construct_sa <8>(config);
+			}
+			
+			lb::log_time(std::cerr) << "Building the LCP array with " << thread_count << " tasks…\n";
+			fg::construct_lcp_parallel(config, thread_count);
+		}
+		
+		// Build the BWT, too, so that only the steps specific to each CST are measured.
+		if (needs_all_arrays && !sdsl::cache_file_exists(sdsl::conf::KEY_BWT, config))
+		{
+			lb::log_time(std::cerr) << "Building the BWT…\n";
+			sdsl::construct_bwt <8>(config);
+		}
+		
+		return config;
 	}
 
 
-	void write_cst(
-		gengetopt_args_info const &args_info,
-		cereal::PortableBinaryOutputArchive &archive
-	)
+	sdsl::cache_config prepare_cache(gengetopt_args_info const &args_info)
 	{
-		build_cst(
+		return prepare_cache(
 			args_info.input_arg,
+			args_info.sequence_list_arg,
+			args_info.gzip_input_flag,
+			args_info.buffer_count_arg,
+			args_info.cache_directory_arg,
+			args_info.threads_arg,
 			args_info.text_arg,
 			args_info.sa_arg,
 			args_info.bwt_arg,
 			args_info.lcp_arg,
 			args_info.csa_arg,
-			archive
+			args_info.benchmark_flag
 		);
 	}
+	
+	
+	void write_cst(
+		gengetopt_args_info const &args_info,
+		fg::cst_flavour const flavour,
+		cereal::PortableBinaryOutputArchive &archive
+	)
+	{
+		auto config(prepare_cache(args_info));
+		
+		lb::log_time(std::cerr) << "Building the CST (" << fg::cst_flavour_name(flavour) << ")…\n";
+		fg::cst_variant cst;
+		fg::emplace_cst(cst, flavour);
+		std::visit([&args_info, &config](auto &cst_){
+			sdsl::construct(cst_, (args_info.input_arg ? args_info.input_arg : ""), config, 1);
+		}, cst);
+		fg::save_cst(archive, cst);
+	}
+	
+	
+	// SDSL caches the CSA under a key that depends on its type, and the flavours that share the CSA type
+	// would load it instead of building it. Remove it from the cache so that it is built again.
+	template <typename t_cst>
+	void remove_cached_csa(t_cst const &, sdsl::cache_config &config)
+	{
+		typename t_cst::csa_type csa;
+		auto const key(std::string(sdsl::conf::KEY_CSA) + "_" + sdsl::util::class_to_hash(csa));
+		if (sdsl::cache_file_exists(key, config))
+			sdsl::remove(sdsl::cache_file_name(key, config));
+		config.file_map.erase(key);
+	}
+	
+	
+	// Build each flavour of the CST from the same temporary files and report the construction time,
+	// the size and the time taken by the queries. Only the text, the suffix array, the BWT and the LCP array
+	// are shared; the CSA is built separately for each flavour.
+	void benchmark_cst_flavours(gengetopt_args_info const &args_info)
+	{
+		auto config(prepare_cache(args_info));
+		std::size_t const query_count(args_info.benchmark_queries_arg);
+		
+		std::cout << "FLAVOUR\tCONSTRUCTION_SECONDS\tSIZE_BYTES\tQUERY_COUNT\tQUERY_SECONDS\tCHECKSUM\n";
+		for (std::size_t i(0); i < fg::CST_FLAVOUR_COUNT; ++i)
+		{
+			auto const flavour(fg::cst_flavour(i));
+			lb::log_time(std::cerr) << "Building the CST (" << fg::cst_flavour_name(flavour) << ")…\n";
+			
+			fg::cst_variant cst;
+			fg::emplace_cst(cst, flavour);
+			std::visit([&args_info, &config, query_count, flavour](auto &cst_){
+				remove_cached_csa(cst_, config);
+				auto const construction_time(measure_seconds([&](){
+					sdsl::construct(cst_, (args_info.input_arg ? args_info.input_arg : ""), config, 1);
+				}));
+				
+				std::size_t checksum{};
+				auto const query_time(measure_seconds([&](){
+					checksum = run_queries(cst_, query_count);
+				}));
+				
+				std::cout << fg::cst_flavour_name(flavour) << '\t' << construction_time << '\t' << sdsl::size_in_bytes(cst_) << '\t' << query_count << '\t' << query_time << '\t' << checksum << '\n';
+			}, cst);
+		}
+		
+		std::cout << std::flush;
+	}
+	
+	
+	fg::cst_flavour cst_flavour_arg(gengetopt_args_info const &args_info)
+	{
+		switch (args_info.flavour_arg)
+		{
+			case flavour_arg_sct3:
+				return fg::cst_flavour::sct3;
+			
+			case flavour_arg_sct3_lcp_byte:
+				return fg::cst_flavour::sct3_lcp_byte;
+			
+			case flavour_arg_sct3_balanced_wt:
+				return fg::cst_flavour::sct3_balanced_wt;
+			
+			case flavour_arg_sada:
+				return fg::cst_flavour::sada;
+			
+			default:
+				std::cerr << "ERROR: Unexpected CST flavour.\n";
+				std::exit(EXIT_FAILURE);
+		}
+	}
 }
 
 
@@ -79,17 +298,58 @@ int main(int argc, char **argv)
 	std::ios_base::sync_with_stdio(false);	// Don't use C style IO after calling cmdline_parser.
 	std::cin.tie(nullptr);					// We don't require any input from the user.
 
+	if (args_info.threads_arg <= 0)
+	{
+		std::cerr << "ERROR: Thread count must be positive.\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (args_info.sequence_list_arg)
+	{
+		// The text would be written to the given path.
+		if (args_info.text_arg)
+		{
+			std::cerr << "ERROR: --text cannot be used with --sequence-list.\n";
+			std::exit(EXIT_FAILURE);
+		}
+		
+		if (args_info.buffer_count_arg <= 0)
+		{
+			std::cerr << "ERROR: Buffer count must be positive.\n";
+			std::exit(EXIT_FAILURE);
+		}
+	}
+
+	if (args_info.benchmark_flag)
+	{
+		if (args_info.output_arg)
+		{
+			std::cerr << "ERROR: --output cannot be used with --benchmark.\n";
+			std::exit(EXIT_FAILURE);
+		}
+		
+		if (args_info.benchmark_queries_arg < 0)
+		{
+			std::cerr << "ERROR: Query count must be non-negative.\n";
+			std::exit(EXIT_FAILURE);
+		}
+		
+		benchmark_cst_flavours(args_info);
+		return EXIT_SUCCESS;
+	}
+	
+	auto const flavour(cst_flavour_arg(args_info));
 	if (args_info.output_arg)
 	{
 		lb::file_ostream stream;
 		lb::open_file_for_writing(args_info.output_arg, stream, lb::writing_open_mode::CREATE);
 		cereal::PortableBinaryOutputArchive archive(stream);
-		write_cst(args_info, archive);
+		write_cst(args_info, flavour, archive);
 	}
 	else
 	{
 		cereal::PortableBinaryOutputArchive archive(std::cout);
-		write_cst(args_info, archive);
+		write_cst(args_info, flavour, archive);
 	}
 	
 	return EXIT_SUCCESS;
@@ -42,6 +42,18 @@ namespace {
 	}
 	
 	
+	fg::msa_format input_format(gengetopt_args_info const &args_info)
+	{
+		if (args_info.fasta_input_given)
+			return fg::msa_format::fasta;
+		if (args_info.packed_input_given)
+			return fg::msa_format::packed;
+		if (args_info.bgzip_input_given)
+			return fg::msa_format::bgzip;
+		return fg::msa_format::text;
+	}
+	
+	
 	// Postcondition: path_template contains the path of the temporary file.
 	template <typename t_stream>
 	void open_temporary_file_for_rw(std::string &path_template, std::size_t const suffix_length, t_stream &stream)
@@ -189,7 +201,10 @@ namespace {
 		std::optional <std::string>			m_index_input_path;
 		std::uint16_t						m_buffer_count{};
 		std::uint16_t						m_chunk_size{};
-		bool								m_input_is_bgzipped{};
+		std::uint16_t						m_read_ahead_block_count{};
+		std::size_t							m_block_cache_size{};
+		fg::msa_format						m_input_format{};
+		bool								m_should_map_input{};
 		bool								m_should_skip_csa{};
 		bool								m_should_skip_support{};
 		bool								m_should_skip_output{};
@@ -210,7 +225,10 @@ namespace {
 			m_index_input_path(make_optional(args_info.index_input_arg)),
 			m_buffer_count(args_info.buffer_count_arg),
 			m_chunk_size(args_info.chunk_size_arg),
-			m_input_is_bgzipped(args_info.bgzip_input_given),
+			m_read_ahead_block_count(args_info.read_ahead_arg),
+			m_block_cache_size(std::size_t(args_info.block_cache_size_arg) * 1024 * 1024),
+			m_input_format(input_format(args_info)),
+			m_should_map_input(args_info.mmap_given),
 			m_should_skip_csa(args_info.skip_csa_given),
 			m_should_skip_support(args_info.skip_support_given),
 			m_should_skip_output(args_info.skip_output_given)
@@ -244,7 +262,10 @@ namespace {
 		fgi::read_optimized_segmentation(
 			m_sequence_list_path.c_str(),
 			m_segmentation_path.c_str(),
-			m_input_is_bgzipped,
+			m_input_format,
+			m_read_ahead_block_count,
+			m_block_cache_size,
+			(m_should_map_input ? fg::bgzip_access_mode::mmap : fg::bgzip_access_mode::pread),
 			graph
 		);
 			
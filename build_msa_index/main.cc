@@ -1,126 +1,69 @@
 /*
- * Copyright (c) 2021 Tuukka Norri
+ * Copyright (c) 2021-2022 Tuukka Norri
  * This code is licensed under MIT license (see LICENSE for details).
  */
 
 
-#include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
 #include <cereal/archives/portable_binary.hpp>
 #include <founder_graphs/msa_index.hh>
-#include <founder_graphs/utility.hh>
+#include <founder_graphs/msa_index_builder.hh>
 #include <iostream>
-#include <libbio/assert.hh>
-#include <libbio/file_handle.hh>
 #include <libbio/file_handling.hh>
+#include <string>
+#include <vector>
 #include "cmdline.h"
 
 namespace fg	= founder_graphs;
 namespace lb	= libbio;
-namespace ios	= boost::iostreams;
 
 
 namespace {
 	
-	void open_stream(lb::file_handle const &handle, lb::file_istream &stream)
+	class msa_index_writer final : public fg::msa_index_builder_delegate
 	{
-		ios::file_descriptor_source source(handle.get(), ios::never_close_handle);
-		stream.open(source);
-		stream.exceptions(std::istream::badbit);
-	}
-	
+	protected:
+		cereal::PortableBinaryOutputArchive	&m_archive;
 	
-	std::size_t handle_file(std::string const &path, std::size_t const size, bool const input_is_gzipped, sdsl::bit_vector &buffer, cereal::PortableBinaryOutputArchive &archive)
-	{
-		std::cerr << "Handling " << path << "…" << std::flush;
-		lb::file_handle handle(lb::open_file_for_reading(path));
-		
-		// Clear the gap buffer.
-		if (input_is_gzipped)
-		{
-			if (SIZE_MAX == size)
-				buffer.resize(0);
-			else
-				buffer.assign(size, 0);
-		}
-		else
+	public:
+		msa_index_writer(cereal::PortableBinaryOutputArchive &archive):
+			m_archive(archive)
 		{
-			// Check the file size.
-			auto const [actual_size, preferred_block_size] = fg::check_file_size(handle);
-			if (SIZE_MAX != size)
-				libbio_always_assert_eq(size, actual_size);
-			
-			// Clear the buffer.
-			libbio_assert_lt(0, actual_size);
-			buffer.assign(actual_size, 0);
-			libbio_assert_eq(buffer.size(), actual_size);
 		}
-		
-		// Handle the sequence.
-		lb::file_istream stream;
-		open_stream(handle, stream);
-		
-		ios::filtering_istream in;
-		if (input_is_gzipped)
-			in.push(ios::gzip_decompressor());
-		in.push(stream);
-		
-		char ch{};
-		std::size_t i(0);
-		std::size_t gap_count(0);
-		while (in >> std::noskipws >> ch)
-		{
-			if ('-' == ch)
-			{
-				if (input_is_gzipped && SIZE_MAX == size)
-					buffer.resize(1 + i, 0);
-				buffer[i] = 1;
-				++gap_count;
-			}
+	
+		void output_sequence(fg::msa_index_sequence const &seq) override;
+	};
+	
+	
+	void msa_index_writer::output_sequence(fg::msa_index_sequence const &seq)
+	{
+		std::cerr << "Handled " << seq.path << "; " << seq.size << " characters, " << seq.gap_count << " gap characters; ";
+		std::cerr << fg::gap_vector_type_name(seq.index.type()) << " gap vector of " << seq.index.size_in_bytes() << " bytes.\n";
 			
-			++i;
-		}
-		
-		if (input_is_gzipped && SIZE_MAX == size)
-			buffer.resize(i, 0);
-		
-		libbio_always_assert(i == buffer.size());
-		
-		// Create a compressed index and prepare rank and select support.
-		fg::aligned_sequence_index seq_idx(buffer);
-		seq_idx.prepare_rank_and_select_support();
-		
-		std::cerr << " handled " << i << " characters; found " << gap_count << " gap characters.\n";
-		
 		// Archive.
-		archive(seq_idx);
-		
-		return i;
+		m_archive(seq.index);
 	}
 	
 	
-	void build_msa_index(char const *sequence_list_path, bool const input_is_gzipped)
+	void build_msa_index(char const *sequence_list_path, std::size_t const buffer_count, double const size_slack, bool const input_is_gzipped)
 	{
 		lb::file_istream stream;
 		lb::open_file_for_reading(sequence_list_path, stream);
 		
 		std::vector <std::string> paths;
 		std::string line;
-		std::size_t file_size{SIZE_MAX};
 		while (std::getline(stream, line))
 			paths.push_back(line);
-
+		
 		// Prepare the output archive.
 		cereal::PortableBinaryOutputArchive archive(std::cout);
-		{
-			std::size_t const size(paths.size());
-			archive(cereal::make_size_tag(size));
-		}
+		fg::msa_index::save_header(archive, paths.size());
 		
 		// Handle the inputs.
-		sdsl::bit_vector buffer;
+		msa_index_writer writer(archive);
+		fg::msa_index_builder builder(writer, buffer_count, size_slack, input_is_gzipped);
 		for (auto const &path : paths)
-			file_size = handle_file(path, file_size, input_is_gzipped, buffer, archive);
+			builder.submit(path);
+		builder.finish();
 		
 		std::cout << std::flush;
 	}
@@ -132,7 +75,7 @@ int main(int argc, char **argv)
 #ifndef NDEBUG
 	std::cerr << "Assertions have been enabled." << std::endl;
 #endif
-	
+
 	gengetopt_args_info args_info;
 	if (0 != cmdline_parser(argc, argv, &args_info))
 		std::exit(EXIT_FAILURE);
@@ -140,7 +83,19 @@ int main(int argc, char **argv)
 	std::ios_base::sync_with_stdio(false);	// Don't use C style IO after calling cmdline_parser.
 	std::cin.tie(nullptr);					// We don't require any input from the user.
 	
-	build_msa_index(args_info.sequence_list_arg, args_info.gzip_input_flag);
+	if (args_info.buffer_count_arg <= 0)
+	{
+		std::cerr << "Buffer count must be positive.\n";
+		std::exit(EXIT_FAILURE);
+	}
+	
+	if (args_info.size_slack_arg < 0.0)
+	{
+		std::cerr << "Size slack must be non-negative.\n";
+		std::exit(EXIT_FAILURE);
+	}
+	
+	build_msa_index(args_info.sequence_list_arg, args_info.buffer_count_arg, args_info.size_slack_arg, args_info.gzip_input_flag);
 	
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <cereal/archives/portable_binary.hpp>
+#include <founder_graphs/bwt.hh>
+#include <founder_graphs/lcp.hh>
+#include <founder_graphs/r_index.hh>
+#include <iostream>
+#include <libbio/assert.hh>
+#include <libbio/file_handling.hh>
+#include <libbio/utility.hh>
+#include <sdsl/int_vector.hpp>
+#include <sdsl/int_vector_buffer.hpp>
+#include <sdsl/io.hpp>
+#include "cmdline.h"
+
+namespace fg = founder_graphs;
+namespace lb = libbio;
+
+
+namespace {
+	
+	template <typename t_sa, typename t_bwt, typename t_lcp>
+	void add_values(t_sa &sa, t_bwt &bwt, t_lcp &lcp, fg::r_index_builder &builder)
+	{
+		libbio_always_assert_eq(sa.size(), bwt.size());
+		libbio_always_assert_eq(sa.size(), lcp.size());
+		
+		auto const size(sa.size());
+		for (std::size_t i(0); i < size; ++i)
+			builder.add(bwt[i], sa[i], lcp[i]);
+	}
+	
+	
+	void build_r_index(
+		char const *sa_path,
+		char const *bwt_path,
+		char const *lcp_path,
+		char const *text_path,
+		std::size_t const thread_count,
+		cereal::PortableBinaryOutputArchive &archive
+	)
+	{
+		fg::r_index_builder builder;
+		
+		if (bwt_path && lcp_path)
+		{
+			// Only O(r) values are kept in memory.
+			lb::log_time(std::cerr) << "Reading the suffix array, the BWT and the LCP array…\n";
+			sdsl::int_vector_buffer <0> sa(sa_path);
+			sdsl::int_vector_buffer <8> bwt(bwt_path);
+			sdsl::int_vector_buffer <0> lcp(lcp_path);
+			add_values(sa, bwt, lcp, builder);
+		}
+		else
+		{
+			lb::log_time(std::cerr) << "Loading the text and the suffix array…\n";
+			sdsl::int_vector <8> text;
+			sdsl::int_vector <0> sa;
+			libbio_always_assert(sdsl::load_from_file(text, text_path));
+			libbio_always_assert(sdsl::load_from_file(sa, sa_path));
+			
+			sdsl::int_vector <8> bwt;
+			if (bwt_path)
+				libbio_always_assert(sdsl::load_from_file(bwt, bwt_path));
+			else
+			{
+				lb::log_time(std::cerr) << "Building the BWT with " << thread_count << " tasks…\n";
+				fg::construct_bwt_parallel(text, sa, bwt, thread_count);
+			}
+			
+			sdsl::int_vector <0> lcp;
+			if (lcp_path)
+				libbio_always_assert(sdsl::load_from_file(lcp, lcp_path));
+			else
+			{
+				lb::log_time(std::cerr) << "Building the LCP array with " << thread_count << " tasks…\n";
+				fg::construct_lcp_parallel(text, sa, lcp, thread_count);
+			}
+			
+			lb::log_time(std::cerr) << "Determining the runs…\n";
+			add_values(sa, bwt, lcp, builder);
+		}
+		
+		lb::log_time(std::cerr) << "Building the index…\n";
+		fg::r_index index;
+		builder.finish(index);
+		lb::log_time(std::cerr) << "The BWT has " << index.run_count() << " runs; the index size is " << index.size_in_bytes() << " bytes.\n";
+		
+		archive(index);
+	}
+	
+	
+	void write_r_index(
+		gengetopt_args_info const &args_info,
+		cereal::PortableBinaryOutputArchive &archive
+	)
+	{
+		build_r_index(
+			args_info.sa_arg,
+			args_info.bwt_arg,
+			args_info.lcp_arg,
+			args_info.text_arg,
+			args_info.threads_arg,
+			archive
+		);
+	}
+}
+
+
+int main(int argc, char **argv)
+{
+#ifndef NDEBUG
+	std::cerr << "Assertions have been enabled." << std::endl;
+#endif
+
+	gengetopt_args_info args_info;
+	if (0 != cmdline_parser(argc, argv, &args_info))
+		std::exit(EXIT_FAILURE);
+	
+	std::ios_base::sync_with_stdio(false);	// Don't use C style IO after calling cmdline_parser.
+	std::cin.tie(nullptr);					// We don't require any input from the user.
+	
+	if (args_info.threads_arg <= 0)
+	{
+		std::cerr << "ERROR: Thread count must be positive.\n";
+		std::exit(EXIT_FAILURE);
+	}
+	
+	if (! (args_info.bwt_arg && args_info.lcp_arg) && !args_info.text_arg)
+	{
+		std::cerr << "ERROR: --text is required unless both --bwt and --lcp are given.\n";
+		std::exit(EXIT_FAILURE);
+	}
+	
+	if (args_info.output_arg)
+	{
+		lb::file_ostream stream;
+		lb::open_file_for_writing(args_info.output_arg, stream, lb::writing_open_mode::CREATE);
+		cereal::PortableBinaryOutputArchive archive(stream);
+		write_r_index(args_info, archive);
+	}
+	else
+	{
+		cereal::PortableBinaryOutputArchive archive(std::cout);
+		write_r_index(args_info, archive);
+	}
+	
+	return EXIT_SUCCESS;
+}
@@ -7,25 +7,44 @@
 #define CEREAL_LOAD_FUNCTION_NAME cereal_load
 #define CEREAL_SAVE_FUNCTION_NAME cereal_save
 
+#include <algorithm>
 #include <divsufsort.h>
+#include <filesystem>
+#include <founder_graphs/bgzip_reader.hh>
+#include <founder_graphs/bwt.hh>
+#include <founder_graphs/external_suffix_array.hh>
+#include <founder_graphs/gap_free_text.hh>
+#include <founder_graphs/lcp.hh>
 #include <founder_graphs/utility.hh>
 #include <libbio/assert.hh>
 #include <libbio/file_handle.hh>
 #include <libbio/file_handling.hh>
 #include <iostream>
+#include <optional>
 #include <sdsl/int_vector.hpp>
+#include <sdsl/io.hpp>
+#include <span>
 #include <sys/types.h>
 #include <sys/uio.h>
+#include <thread>
 #include <unistd.h>
 #include "cmdline.h"
 
 namespace fg	= founder_graphs;
+namespace fs	= std::filesystem;
 namespace lb	= libbio;
 
 
 namespace {
 	
-	typedef std::vector <std::uint8_t> input_vector;
+	struct divsufsort_block_sorter final : public fg::external_suffix_array_block_sorter
+	{
+		void sort_block(std::span <std::uint8_t> const block, std::span <std::int32_t> const sa) override
+		{
+			auto const res(::divsufsort(block.data(), sa.data(), block.size()));
+			libbio_always_assert_eq(0, res);
+		}
+	};
 	
 	
 	template <std::size_t t_int_width, std::size_t t_shift_amt>
@@ -45,7 +64,7 @@ namespace {
 	}
 	
 	
-	void read_file(lb::file_handle const &handle, input_vector &buffer, std::size_t const preferred_block_size)
+	void read_file(lb::file_handle const &handle, std::span <std::uint8_t> const buffer, std::size_t const preferred_block_size)
 	{
 		// Try to reduce the number of system calls needed by using ::readv.
 		std::array <struct iovec, 32> iov;
@@ -95,16 +114,18 @@ namespace {
 	}
 	
 	
-	void build_sa(char const *input_path)
+	void build_sa(sdsl::int_vector <8> &text, char const *text_output_path, char const *bwt_output_path, char const *lcp_output_path)
 	{
-		lb::file_handle handle(lb::open_file_for_reading(input_path));
-		libbio_always_assert_neq(-1, handle.get());
-		
-		// Read the file into memory.
-		std::cerr << "Reading the input…\n";
-		auto const [file_size, preferred_block_size] = fg::check_file_size(handle);
-		input_vector input(file_size, 0);
-		read_file(handle, input, preferred_block_size);
+		// SDSL expects the text to be terminated with a unique zero character, which is also included in the suffix array.
+		auto *input(reinterpret_cast <std::uint8_t *>(text.data()));
+		auto const file_size(text.size());
+		libbio_always_assert_lt(0, file_size);
+		libbio_always_assert_eq(0, input[file_size - 1]);
+		if (std::find(input, input + file_size - 1, 0) != input + file_size - 1)
+		{
+			std::cerr << "ERROR: The input contains a zero character.\n";
+			std::exit(EXIT_FAILURE);
+		}
 		
 		// divsufsort puts everything in the global namespace.
 		std::cerr << "Building the suffix array…\n";
@@ -113,7 +134,7 @@ namespace {
 		{
 			sa.width(32);
 			sa.resize(file_size);
-			auto const res(::divsufsort(input.data(), reinterpret_cast <std::int32_t *>(sa.data()), file_size));
+			auto const res(::divsufsort(input, reinterpret_cast <std::int32_t *>(sa.data()), file_size));
 			libbio_always_assert_eq(0, res);
 			
 			// FIXME: I don’t understand why SDSL uses i << 5 here.
@@ -123,7 +144,7 @@ namespace {
 		{
 			sa.width(64);
 			sa.resize(file_size);
-			auto const res(::divsufsort(input.data(), reinterpret_cast <std::int64_t *>(sa.data()), file_size));
+			auto const res(::divsufsort(input, reinterpret_cast <std::int64_t *>(sa.data()), file_size));
 			libbio_always_assert_eq(0, res);
 			
 			resize_if_needed <64, 6>(sa, file_size);
@@ -132,6 +153,120 @@ namespace {
 		std::cerr << "Serializing…\n";
 		sa.serialize(std::cout);
 		std::cout << std::flush;
+		
+		// Store the text in the format of SDSL’s cache files.
+		if (text_output_path)
+		{
+			std::cerr << "Writing the text…\n";
+			libbio_always_assert(sdsl::store_to_file(text, text_output_path));
+		}
+		
+		// The BWT can be determined while the text and the suffix array are in memory.
+		if (bwt_output_path)
+		{
+			std::cerr << "Building the BWT…\n";
+			sdsl::int_vector <8> bwt;
+			fg::construct_bwt_parallel(text, sa, bwt, std::max(1U, std::thread::hardware_concurrency()));
+			
+			std::cerr << "Writing the BWT…\n";
+			libbio_always_assert(sdsl::store_to_file(bwt, bwt_output_path));
+		}
+		
+		// Likewise for the LCP array, which can then be passed to build_cst and build_r_index with --lcp.
+		if (lcp_output_path)
+		{
+			std::cerr << "Building the LCP array…\n";
+			sdsl::int_vector <0> lcp;
+			fg::construct_lcp_parallel(text, sa, lcp, std::max(1U, std::thread::hardware_concurrency()));
+			
+			std::cerr << "Writing the LCP array…\n";
+			libbio_always_assert(sdsl::store_to_file(lcp, lcp_output_path));
+		}
+	}
+	
+	
+	void write_text(std::span <char const> const text, char const *text_output_path)
+	{
+		// Store the zero-terminated text in the format of SDSL’s cache files, i.e. the size in bits
+		// followed by the characters padded to a multiple of eight bytes.
+		lb::file_ostream stream;
+		lb::open_file_for_writing(text_output_path, stream, lb::writing_open_mode::CREATE);
+		
+		std::uint64_t const bit_count(8 * (1 + text.size()));
+		std::array <char, 8> const padding{};
+		stream.write(reinterpret_cast <char const *>(&bit_count), sizeof(bit_count));
+		stream.write(text.data(), text.size());
+		stream.write(padding.data(), padding.size() - text.size() % padding.size()); // Includes the terminator.
+		stream << std::flush;
+	}
+	
+	
+	void build_sa_external(char const *input_path, std::size_t const memory_budget, char const *temporary_directory, char const *text_output_path)
+	{
+		// Only the current block is kept in memory in addition to the memory-mapped text.
+		lb::file_handle handle(lb::open_file_for_reading(input_path));
+		auto const [file_size, preferred_block_size] = fg::check_file_size(handle);
+		fg::memory_mapping const mapping(handle, file_size);
+		std::span const text(mapping.data(), mapping.size());
+		
+		std::cerr << "Determining the alphabet…\n";
+		divsufsort_block_sorter sorter;
+		std::optional <fg::external_suffix_array_builder> builder;
+		try
+		{
+			builder.emplace(text, (temporary_directory ? std::string(temporary_directory) : fs::temp_directory_path().string()), sorter);
+		}
+		catch (std::runtime_error const &exc)
+		{
+			std::cerr << "ERROR: " << exc.what() << '\n';
+			std::exit(EXIT_FAILURE);
+		}
+		
+		auto const block_size(builder->block_size_for_memory_budget(memory_budget));
+		std::cerr << "Building the suffix array in blocks of " << block_size << " characters…\n";
+		builder->build(block_size, std::cout);
+		
+		if (text_output_path)
+		{
+			std::cerr << "Writing the text…\n";
+			write_text(text, text_output_path);
+		}
+	}
+	
+	
+	void build_sa_from_file(char const *input_path, char const *text_output_path, char const *bwt_output_path, char const *lcp_output_path)
+	{
+		lb::file_handle handle(lb::open_file_for_reading(input_path));
+		libbio_always_assert_neq(-1, handle.get());
+		
+		// Read the file into memory.
+		std::cerr << "Reading the input…\n";
+		auto const [file_size, preferred_block_size] = fg::check_file_size(handle);
+		sdsl::int_vector <8> text(1 + file_size, 0);
+		read_file(handle, std::span(reinterpret_cast <std::uint8_t *>(text.data()), file_size), preferred_block_size);
+		
+		build_sa(text, text_output_path, bwt_output_path, lcp_output_path);
+	}
+
+	
+	void build_sa_from_sequence_list(
+		char const *sequence_list_path,
+		bool const input_is_gzipped,
+		std::size_t const buffer_count,
+		char const *text_output_path,
+		char const *bwt_output_path,
+		char const *lcp_output_path
+	)
+	{
+		// Remove the gaps while reading the sequences s.t. the text matches the one output by prepare_msa.
+		std::cerr << "Reading the sequences…\n";
+		sdsl::int_vector <8> text;
+		fg::read_gap_free_text(sequence_list_path, input_is_gzipped, buffer_count, text);
+		
+		auto const size(text.size());
+		text.resize(1 + size);
+		text[size] = 0;
+		build_sa(text, text_output_path, bwt_output_path, lcp_output_path);
 	}
 }
 
@@ -150,9 +285,64 @@ int main(int argc, char **argv)
 	std::cin.tie(nullptr);					// We don't require any input from the user.
 	
 	if (args_info.read_sa_flag)
+	{
+		if (!args_info.input_arg)
+		{
+			std::cerr << "ERROR: --read-sa requires --input.\n";
+			std::exit(EXIT_FAILURE);
+		}
+		
 		read_sa(args_info.input_arg);
+	}
+	else if (args_info.memory_budget_given)
+	{
+		if (!args_info.input_arg)
+		{
+			std::cerr << "ERROR: --memory-budget requires --input.\n";
+			std::exit(EXIT_FAILURE);
+		}
+		
+		if (args_info.bwt_output_arg)
+		{
+			std::cerr << "ERROR: --bwt-output cannot be used with --memory-budget.\n";
+			std::exit(EXIT_FAILURE);
+		}
+		
+		if (args_info.lcp_output_arg)
+		{
+			std::cerr << "ERROR: --lcp-output cannot be used with --memory-budget.\n";
+			std::exit(EXIT_FAILURE);
+		}
+		
+		if (args_info.memory_budget_arg <= 0)
+		{
+			std::cerr << "ERROR: Memory budget must be positive.\n";
+			std::exit(EXIT_FAILURE);
+		}
+		
+		build_sa_external(args_info.input_arg, std::size_t(args_info.memory_budget_arg) * 1024 * 1024, args_info.temporary_directory_arg, args_info.text_output_arg);
+	}
+	else if (args_info.sequence_list_arg)
+	{
+		if (args_info.buffer_count_arg <= 0)
+		{
+			std::cerr << "ERROR: Buffer count must be positive.\n";
+			std::exit(EXIT_FAILURE);
+		}
+		
+		build_sa_from_sequence_list(
+			args_info.sequence_list_arg,
+			args_info.gzip_input_flag,
+			args_info.buffer_count_arg,
+			args_info.text_output_arg,
+			args_info.bwt_output_arg,
+			args_info.lcp_output_arg
+		);
+	}
 	else
-		build_sa(args_info.input_arg);
+	{
+		build_sa_from_file(args_info.input_arg, args_info.text_output_arg, args_info.bwt_output_arg, args_info.lcp_output_arg);
+	}
 	
 	return EXIT_SUCCESS;
 }
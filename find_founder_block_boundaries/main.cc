@@ -8,12 +8,18 @@
 #include <founder_graphs/basic_types.hh>
 #include <founder_graphs/cst.hh>
 #include <founder_graphs/msa_index.hh>
+#include <founder_graphs/r_index.hh>
 #include <founder_graphs/reverse_msa_reader.hh>
+#include <founder_graphs/sorted_range_set.hh>
+#include <founder_graphs/streaming_coordinate_transform.hh>
 #include <iostream>
 #include <libbio/assert.hh>
+#include <libbio/dispatch.hh>
 #include <libbio/file_handling.hh>
 #include <libbio/utility.hh>
+#include <optional>
 #include <range/v3/view/subrange.hpp>
+#include <sdsl/rmq_support.hpp>
 #include <set>
 #include <vector>
 #include "cmdline.h"
@@ -30,6 +36,8 @@ namespace {
 		
 		csa_size_type	lb{};
 		csa_size_type	rb{};
+		csa_size_type	sa_lb{};	// Toeholds, only with the r-index.
+		csa_size_type	sa_rb{};
 		
 		lexicographic_range() = default;
 		
@@ -39,47 +47,72 @@ namespace {
 		{
 		}
 		
+		template <typename t_csa>
+		explicit lexicographic_range(fg::lexicographic_range <t_csa> const &range):
+			lb(range.lb),
+			rb(range.rb)
+		{
+		}
+		
+		explicit lexicographic_range(fg::lexicographic_range <fg::r_index> const &range):
+			lb(range.lb),
+			rb(range.rb),
+			sa_lb(range.sa_lb),
+			sa_rb(range.sa_rb)
+		{
+		}
+		
 		std::size_t interval_length() const { return rb - lb + 1; }
 	};
 	
 	
 	struct node_span
 	{
-		typedef fg::cst_type::node_type	node_type;
+		// Lexicographic range of the CST node, as in sdsl::bp_interval. The nodes themselves are
+		// determined only when needed, since their representation depends on the type of the CST.
+		struct interval
+		{
+			std::size_t	i{};
+			std::size_t	j{};
+		};
 		
 		struct sentinel_tag {};
 		
-		node_type	node{};			// CST node.
-		std::size_t	length_sum{};	// Cumulative sum.
-		std::size_t	sequence{};		// Sequence identifier.
+		interval	node{};
+		std::size_t	length_sum{};		// Cumulative sum.
+		std::size_t	member_offset{};	// Offset of the sequence identifiers of the equivalence class.
+		std::size_t	member_count{};		// Number of sequences in the equivalence class.
+		std::size_t	sa_lb{};			// Toeholds, only with the r-index.
+		std::size_t	sa_rb{};
 		
 		node_span() = default;
 		
-		node_span(fg::cst_type::node_type const &node_, std::size_t const sequence_):
-			node(node_),
+		node_span(lexicographic_range const &range, std::size_t const member_offset_, std::size_t const member_count_):
+			node{range.lb, range.rb},
 			length_sum(0),
-			sequence(sequence_)
+			member_offset(member_offset_),
+			member_count(member_count_),
+			sa_lb(range.sa_lb),
+			sa_rb(range.sa_rb)
 		{
 		}
 		
-		// The constructor below results in the correct interval length as long as
-		// that of node does not check for a non-empty interval.
-		static_assert(std::is_unsigned_v <fg::cst_interval_endpoint_type>);
+		// The constructor below results in the correct interval length since the endpoints are unsigned.
 		explicit node_span(sentinel_tag const &):
-			node(fg::CST_INTERVAL_ENDPOINT_MAX, fg::CST_INTERVAL_ENDPOINT_MAX - 1),
-			sequence(SIZE_MAX)
+			node{SIZE_MAX, SIZE_MAX - 1},
+			member_offset(SIZE_MAX)
 		{
 		}
 		
 		std::size_t interval_length() const { return node.j - node.i + 1; }
-		bool is_sentinel() const { return fg::CST_INTERVAL_ENDPOINT_MAX == node.i; }
+		bool is_sentinel() const { return SIZE_MAX == node.i; }
 		bool encloses(node_span const &other) const { return node.i <= other.node.i && other.node.j <= node.j; }
 	};
 
 
 	std::ostream &operator<<(std::ostream &os, node_span const &span)
 	{
-		os << "Node: [" << span.node.i << ", " << span.node.j << "] length_sum: " << span.length_sum << " seq: " << span.sequence;
+		os << "Node: [" << span.node.i << ", " << span.node.j << "] length_sum: " << span.length_sum << " members: " << span.member_count << " at " << span.member_offset;
 		return os;
 	}
 	
@@ -96,17 +129,24 @@ namespace {
 
 
 	// For debugging.
-	bool check_node_spans(node_span_vector const &vec)
+	bool check_node_spans(node_span_vector const &vec, std::vector <std::size_t> const &members)
 	{
 		bool retval{true};
 		std::set <std::size_t> seen_seq_numbers;
 		for (auto const &span : vec)
 		{
-			auto const res(seen_seq_numbers.insert(span.sequence));
-			if (!res.second)
+			if (span.is_sentinel())
+				continue;
+			
+			for (std::size_t k(0); k < span.member_count; ++k)
 			{
-				std::cerr << "Sequence number " << span.sequence << " was already assigned.\n";
-				retval = false;
+				auto const seq_idx(members[span.member_offset + k]);
+				auto const res(seen_seq_numbers.insert(seq_idx));
+				if (!res.second)
+				{
+					std::cerr << "Sequence number " << seq_idx << " was already assigned.\n";
+					retval = false;
+				}
 			}
 		}
 		return retval;
@@ -123,39 +163,890 @@ namespace {
 	}
 	
 	
-	void find_founder_block_boundaries(
-		char const *sequence_list_path,
-		char const *cst_path,
-		char const *msa_index_path,
+	typedef sdsl::rmq_succinct_sct <> rmq_type;
+	
+	
+	// Determine the CST node with the given lexicographic range. cst_sada does not have node(lb, rb),
+	// so the node is determined as the lowest common ancestor of the leftmost and the rightmost leaf.
+	template <typename t_cst>
+	typename t_cst::node_type cst_node(t_cst const &cst, std::size_t const lb, std::size_t const rb)
+	{
+		if constexpr (requires { cst.node(lb, rb); })
+			return cst.node(lb, rb);
+		else
+			return cst.lca(cst.select_leaf(1 + lb), cst.select_leaf(1 + rb));
+	}
+	
+	
+	// Algorithm for determining the string depths of the equivalence classes.
+	enum class depth_engine
+	{
+		climb,		// Use cst.parent().
+		rmq,		// Use range minimum queries over the LCP array.
+		check,		// Use both and compare the results.
+		r_index		// Use the toeholds, Φ⁻¹ and PLCP.
+	};
+	
+	
+	// Data structures that are shared by all the columns and are not modified during processing.
+	template <typename t_cst>
+	struct segmentation_context
+	{
+		typedef t_cst			cst_type;
+		
+		cst_type const			*cst{};				// Either the CST or the r-index is used.
+		fg::r_index const		*r_index{};
+		fg::msa_index const		*msa_index{};		// Not used with streaming coordinates.
+		rmq_type const			*lcp_rmq{};
+		std::size_t				seq_count{};
+		std::size_t				aligned_size{};
+		depth_engine			engine{};
+		
+		segmentation_context(
+			cst_type const *cst_,
+			fg::r_index const *r_index_,
+			fg::msa_index const *msa_index_,
+			rmq_type const *lcp_rmq_,
+			std::size_t const seq_count_,
+			std::size_t const aligned_size_,
+			depth_engine const engine_
+		):
+			cst(cst_),
+			r_index(r_index_),
+			msa_index(msa_index_),
+			lcp_rmq(lcp_rmq_),
+			seq_count(seq_count_),
+			aligned_size(aligned_size_),
+			engine(engine_)
+		{
+		}
+	};
+	
+	
+	// The lexicographic ranges of one column and the buffers needed for analysing them.
+	// Only backward search depends on the previous column, so the rest of the work can be done
+	// using a copy of the lexicographic ranges.
+	struct column_snapshot
+	{
+		std::vector <lexicographic_range>	lexicographic_ranges;	// By equivalence class, sorted by the left bound and then in reverse by the right bound.
+		std::vector <std::size_t>			member_limits;			// Offsets of the members of the equivalence classes.
+		std::vector <std::size_t>			members;				// Sequence identifiers grouped by equivalence class.
+		node_span_vector					node_spans;
+		std::vector <std::size_t>			string_depths;
+		std::vector <std::size_t>			check_string_depths;	// For comparing the depth engines.
+		std::vector <std::size_t>			top_level_spans;		// Indices of the spans not nested in other spans, for the r-index.
+		std::vector <std::size_t>			top_level_lcps;			// LCP values at the left bounds of the top-level spans.
+		std::vector <std::size_t>			top_level_depths;
+		std::vector <std::size_t>			span_top_levels;		// Containing top-level span by span.
+		std::vector <std::size_t>			handled_sequences;	// For debugging.
+		std::vector <char>					characters;			// The characters of the column, for streaming coordinates.
+		std::size_t							pos{};				// Number of handled columns counting from the right.
+		fg::length_type						block_rb{fg::LENGTH_MAX};
+		bool								has_semi_repeat_free_block{};
+		bool								is_done{};
+		
+		column_snapshot() = default;
+		
+		explicit column_snapshot(std::size_t const seq_count):
+			members(seq_count),
+			node_spans(1 + seq_count),
+			string_depths(seq_count),
+			check_string_depths(seq_count),
+			characters(seq_count)
+		{
+		}
+		
+	};
+	
+	
+	// Set the string depth of the members of the given span.
+	void assign_string_depth(column_snapshot &snapshot, node_span const &span, std::size_t const string_depth, std::vector <std::size_t> &string_depths)
+	{
+		for (std::size_t k(0); k < span.member_count; ++k)
+		{
+			auto const seq_idx(snapshot.members[span.member_offset + k]);
+			string_depths[seq_idx] = string_depth;
+#ifndef NDEBUG
+			snapshot.handled_sequences.push_back(seq_idx);
+#endif
+		}
+	}
+	
+	
+	// Determine the string depths by climbing towards the root from each node until the range of the
+	// node is no longer covered by the node spans.
+	template <typename t_cst>
+	void determine_string_depths_climb(segmentation_context <t_cst> const &ctx, column_snapshot &snapshot, std::vector <std::size_t> &string_depths)
+	{
+		auto const &cst(*ctx.cst);
+		auto const &node_spans(snapshot.node_spans);
+		node_span_cmp cmp;
+		
+		// Fill with placeholder values for extra safety.
+		std::fill(string_depths.begin(), string_depths.end(), SIZE_MAX);
+		snapshot.handled_sequences.clear();
+		
+		auto node_it(node_spans.cbegin());
+		auto const node_end(node_spans.cend() - 1); // Don’t handle the sentinel.
+		while (node_it != node_end)
+		{
+			auto &span(*node_it);
+			node_span_vector_range span_equivalence_class(node_spans.cend(), node_spans.cend());
+			auto node(cst_node(cst, span.node.i, span.node.j));
+			// On the first round, determine the initial equivalence class.
+			// Then proceed to the ancestor nodes.
+			while (true)
+			{
+				lexicographic_range const rng(cst.lb(node), cst.rb(node));
+				// Check if the length of the lexicographic range increased.
+				auto equal_range(std::equal_range(node_it, node_spans.cend(), rng, cmp));
+				libbio_assert_neq(equal_range.second, node_spans.end()); // second should always point to a valid element b.c. the last element is the sentinel.
+				libbio_assert_lt(equal_range.first, equal_range.second); // The range should always be non-empty b.c. the node itself should be inside it.
+				// Stop if we extended too much.
+				if (equal_range.second->length_sum - equal_range.first->length_sum != rng.interval_length())
+					break;
+				// Otherwise store the new range.
+				span_equivalence_class = equal_range;
+				// Continue from the parent node.
+				node = cst.parent(node);
+			}
+			
+			// cst.parent() should be called at least once b.c. the initial range is semi-repeat-free.
+			libbio_assert(! (cst.lb(node) == span.node.i && cst.rb(node) == span.node.j));
+			
+			// Determine the string depth.
+			auto const string_depth(1 + cst.depth(node));
+			libbio_assert_lt(0, string_depth);
+			for (auto const &span : ranges::subrange(span_equivalence_class.first, span_equivalence_class.second))
+				assign_string_depth(snapshot, span, string_depth, string_depths);
+			
+			node_it = span_equivalence_class.second;
+		}
+	}
+	
+	
+	// Determine the string depths with range minimum queries over the LCP array.
+	// The ancestors of a node whose ranges are contained in a maximal range [A, B] of suffix array positions
+	// covered by the node spans are exactly the ones visited by the climbing algorithm above. The lowest
+	// ancestor not contained in [A, B] is the deeper one of the lowest common ancestor of A - 1 and the node
+	// and that of the node and B + 1. For a node with range [i, j], the string depths of these are
+	// min LCP[A, i] and min LCP[j + 1, B + 1] respectively, or zero if A = 0 or B + 1 = n.
+	template <typename t_cst>
+	void determine_string_depths_rmq(segmentation_context <t_cst> const &ctx, column_snapshot &snapshot, std::vector <std::size_t> &string_depths)
+	{
+		auto const &cst(*ctx.cst);
+		auto const &lcp_rmq(*ctx.lcp_rmq);
+		auto const &node_spans(snapshot.node_spans);
+		auto const text_size(cst.csa.size());
+		auto const lcp_min([&cst, &lcp_rmq](std::size_t const lb, std::size_t const rb) -> std::size_t {
+			return cst.lcp[lcp_rmq(lb, rb)];
+		});
+		
+		// Fill with placeholder values for extra safety.
+		std::fill(string_depths.begin(), string_depths.end(), SIZE_MAX);
+		snapshot.handled_sequences.clear();
+		
+		auto run_begin(node_spans.cbegin());
+		auto const node_end(node_spans.cend() - 1); // Don’t handle the sentinel.
+		while (run_begin != node_end)
+		{
+			// Find the maximal covered range. Since the spans are sorted and can only be nested,
+			// the next span either is inside the current range, starts right after it or starts after a gap.
+			std::size_t const run_lb(run_begin->node.i);
+			std::size_t run_rb(run_begin->node.j);
+			auto run_end(run_begin + 1);
+			while (run_end != node_end && run_end->node.i <= run_rb + 1)
+			{
+				run_rb = std::max <std::size_t>(run_rb, run_end->node.j);
+				++run_end;
+			}
+			
+			for (auto const &span : ranges::subrange(run_begin, run_end))
+			{
+				std::size_t const lhs_depth(0 == run_lb ? 0 : lcp_min(run_lb, span.node.i));
+				std::size_t const rhs_depth(run_rb + 1 == text_size ? 0 : lcp_min(1 + span.node.j, 1 + run_rb));
+				assign_string_depth(snapshot, span, 1 + std::max(lhs_depth, rhs_depth), string_depths);
+			}
+			
+			run_begin = run_end;
+		}
+	}
+	
+	
+	// Determine the string depths with the r-index. Within a maximal range [A, B] covered by the node spans,
+	// the spans that are not nested in other spans partition [A, B]. Since the LCP values inside each of these
+	// are greater than the ones at their boundaries, the minima in determine_string_depths_rmq() are found at
+	// the left bounds of the top-level spans or at B + 1. Hence they can be determined from the toeholds with
+	// plcp() and phi_inverse() in O(1) queries per span instead of storing the LCP array.
+	template <typename t_cst>
+	void determine_string_depths_r_index(segmentation_context <t_cst> const &ctx, column_snapshot &snapshot, std::vector <std::size_t> &string_depths)
+	{
+		auto const &index(*ctx.r_index);
+		auto const &node_spans(snapshot.node_spans);
+		auto &top_level_spans(snapshot.top_level_spans);
+		auto &top_level_lcps(snapshot.top_level_lcps);
+		auto &top_level_depths(snapshot.top_level_depths);
+		auto &span_top_levels(snapshot.span_top_levels);
+		auto const text_size(index.size());
+		
+		// Fill with placeholder values for extra safety.
+		std::fill(string_depths.begin(), string_depths.end(), SIZE_MAX);
+		snapshot.handled_sequences.clear();
+		
+		std::size_t run_begin(0);
+		auto const span_count(node_spans.size() - 1); // Don’t handle the sentinel.
+		while (run_begin != span_count)
+		{
+			// Find the maximal covered range and its top-level spans. Since the spans are sorted by the left bound
+			// and then by the right bound, the next span either starts a new top-level span, encloses the current
+			// one and has the same left bound, or is nested in the current one.
+			top_level_spans.clear();
+			span_top_levels.clear();
+			top_level_spans.push_back(run_begin);
+			span_top_levels.push_back(0);
+			auto run_end(run_begin + 1);
+			while (run_end != span_count)
+			{
+				auto const &span(node_spans[run_end]);
+				auto const &top_level_span(node_spans[top_level_spans.back()]);
+				if (top_level_span.node.j < span.node.i)
+				{
+					if (top_level_span.node.j + 1 < span.node.i)
+						break;
+					top_level_spans.push_back(run_end);
+				}
+				else if (top_level_span.node.i == span.node.i)
+				{
+					top_level_spans.back() = run_end;
+				}
+				
+				span_top_levels.push_back(top_level_spans.size() - 1);
+				++run_end;
+			}
+			
+			// Determine the LCP values at the left bounds of the top-level spans. (LCP[0] = 0.)
+			auto const top_level_count(top_level_spans.size());
+			top_level_lcps.resize(top_level_count);
+			top_level_depths.resize(top_level_count);
+			for (std::size_t k(0); k < top_level_count; ++k)
+				top_level_lcps[k] = index.plcp(node_spans[top_level_spans[k]].sa_lb);
+			
+			// The minimum from the right is taken over the LCP values of the following top-level spans and LCP[B + 1].
+			{
+				auto const &last_span(node_spans[top_level_spans.back()]);
+				std::size_t rhs_depth(last_span.node.j + 1 == text_size ? 0 : index.plcp(index.phi_inverse(last_span.sa_rb)));
+				for (std::size_t k(top_level_count); 0 < k; --k)
+				{
+					top_level_depths[k - 1] = rhs_depth;
+					rhs_depth = std::min(rhs_depth, top_level_lcps[k - 1]);
+				}
+			}
+			
+			// The minimum from the left is taken over the LCP values up to and including the current span.
+			{
+				std::size_t lhs_depth(SIZE_MAX);
+				for (std::size_t k(0); k < top_level_count; ++k)
+				{
+					lhs_depth = std::min(lhs_depth, top_level_lcps[k]);
+					top_level_depths[k] = 1 + std::max(lhs_depth, top_level_depths[k]);
+				}
+			}
+			
+			// The nested spans have the string depth of the containing top-level span.
+			for (std::size_t k(run_begin); k < run_end; ++k)
+				assign_string_depth(snapshot, node_spans[k], top_level_depths[span_top_levels[k - run_begin]], string_depths);
+			
+			run_begin = run_end;
+		}
+	}
+	
+	
+	template <typename t_cst>
+	void check_string_depths(segmentation_context <t_cst> const &ctx, column_snapshot const &snapshot)
+	{
+		for (std::size_t j(0); j < ctx.seq_count; ++j)
+		{
+			auto const climb_depth(snapshot.string_depths[j]);
+			auto const rmq_depth(snapshot.check_string_depths[j]);
+			if (climb_depth != rmq_depth)
+			{
+				std::cerr << "String depths differ at column " << (ctx.aligned_size - snapshot.pos) << " for sequence " << j << ": " << climb_depth << " (climb) vs. " << rmq_depth << " (RMQ).\n";
+				std::cerr << "Node spans (" << snapshot.node_spans.size() << "):\n";
+				for (auto const &span : snapshot.node_spans)
+					std::cerr << span << '\n';
+				libbio_always_assert_eq(climb_depth, rmq_depth);
+			}
+		}
+	}
+	
+	
+	// Find the minimum right bound for the block given the string depths.
+	// rb_fn(sequence, block_lb, string_depth) should return the column of the string_depth-th non-gap
+	// character at or after block_lb.
+	template <typename t_cst, typename t_rb_fn>
+	fg::length_type find_block_rb(segmentation_context <t_cst> const &ctx, column_snapshot const &snapshot, t_rb_fn &&rb_fn)
+	{
+		auto const seq_count(ctx.seq_count);
+		auto const &string_depths(snapshot.string_depths);
+		auto const &node_spans(snapshot.node_spans);
+		fg::length_type const block_lb{ctx.aligned_size - snapshot.pos};
+		fg::length_type max_block_rb{0}; // Right bound of a /closed/ interval.
+		for (std::size_t j(0); j < seq_count; ++j)
+		{
+			try
+			{
+				auto const string_depth(string_depths[j]);
+				libbio_assert_lt(0, string_depth);
+				libbio_assert_neq(string_depth, SIZE_MAX);
+				auto const block_rb(rb_fn(j, block_lb, string_depth));
+				libbio_always_assert_lt(block_rb, SIZE_MAX);
+				max_block_rb = std::max(max_block_rb, fg::length_type(block_rb));
+			}
+			catch (lb::assertion_failure_exception const &exc)
+			{
+				std::cerr << "String depth for sequence " << j << '/' << seq_count << " was not set.\n";
+				
+				std::cerr << "Handled sequences:\n";
+				auto handled_sequences(snapshot.handled_sequences);
+				std::sort(handled_sequences.begin(), handled_sequences.end());
+				for (auto const idx : handled_sequences)
+					std::cerr << idx << '\n';
+				
+				std::cerr << "Node spans (" << node_spans.size() << "):\n";
+				for (auto const &span : node_spans)
+					std::cerr << span << '\n';
+				
+				std::cerr << "Members:\n";
+				for (auto const &span : node_spans)
+				{
+					if (span.is_sentinel())
+						continue;
+					
+					std::cerr << span << ':';
+					for (std::size_t k(0); k < span.member_count; ++k)
+						std::cerr << ' ' << snapshot.members[span.member_offset + k];
+					std::cerr << '\n';
+				}
+				
+				if (!check_node_spans(node_spans, snapshot.members))
+					std::cerr << "Some sequences were assigned to more than one equivalence class.\n";
+				
+				throw exc;
+			}
+		}
+		
+		// The semi-repeat-free range will be [block_lb, max_block_rb].
+		return max_block_rb;
+	}
+	
+	
+	// Check if the column range [(aligned_size - pos), aligned_size) is semi-repeat-free
+	// and determine the string depths if it is.
+	template <typename t_cst>
+	void analyse_column(segmentation_context <t_cst> const &ctx, column_snapshot &snapshot)
+	{
+		auto const seq_count(ctx.seq_count);
+		auto &node_spans(snapshot.node_spans);
+		auto &string_depths(snapshot.string_depths);
+		
+		snapshot.block_rb = fg::LENGTH_MAX;
+		snapshot.has_semi_repeat_free_block = false;
+		
+		// Store the node intervals and the equivalence classes of the sequence identifiers.
+		auto const class_count(snapshot.lexicographic_ranges.size());
+		libbio_assert_eq(class_count + 1, snapshot.member_limits.size());
+		node_spans.resize(1 + class_count);
+		for (std::size_t j(0); j < class_count; ++j)
+		{
+			auto const &lex_range(snapshot.lexicographic_ranges[j]);
+			auto const member_offset(snapshot.member_limits[j]);
+			auto const member_count(snapshot.member_limits[j + 1] - member_offset);
+			node_spans[j] = node_span(lex_range, member_offset, member_count);
+		}
+		
+		// Sentinel.
+		node_spans[class_count] = node_span(node_span::sentinel_tag{});
+		
+		// The ranges are sorted by the left bound and then in reverse by the right bound (by sorted_range_set),
+		// and the equal ranges have been merged. Since the nodes represent lexicographic ranges, they can overlap
+		// only by being nested.
+		// Sort by the left bound and then by the right bound by reversing the runs of equal left bounds.
+		{
+			auto it(node_spans.begin());
+			auto const end(node_spans.end() - 1); // Don’t handle the sentinel.
+			while (it != end)
+			{
+				auto const lb(it->node.i);
+				auto const run_end(std::find_if(it + 1, end, [lb](auto const &span){ return span.node.i != lb; }));
+				std::reverse(it, run_end);
+				it = run_end;
+			}
+		}
+		
+		libbio_assert(std::is_sorted(node_spans.begin(), node_spans.end(), [](auto const &lhs, auto const &rhs){
+			return std::make_tuple(lhs.node.i, lhs.node.j) < std::make_tuple(rhs.node.i, rhs.node.j);
+		}));
+		
+		// Update the cumulative sum.
+		// Ignore nested intervals.
+		{
+			auto &first_span(node_spans.front());
+			first_span.length_sum = 0;
+			auto const count(node_spans.size()); // Consider the sentinel, too.
+			if (1 < count)
+			{
+				// If count == 2, second_span is the sentinel.
+				auto &second_span(node_spans[1]);
+				second_span.length_sum = first_span.length_sum + first_span.interval_length();
+				for (std::size_t j(2); j < count; ++j)
+				{
+					// Don’t consider the interval of the current span, just those of the two previous ones.
+					auto &span(node_spans[j]);
+					auto const &prev1(node_spans[j - 1]);
+					auto const &prev2(node_spans[j - 2]);
+					if (prev1.encloses(prev2)) // Safe b.c. of the comparison operator used when sorting.
+						span.length_sum = prev1.length_sum + prev1.interval_length() - prev2.interval_length();
+					else
+						span.length_sum = prev1.length_sum + prev1.interval_length();
+				}
+			}
+		}
+		
+		// Make sure the altorighm for updating the cumulative sum is correct.
+		try
+		{
+			libbio_assert(std::is_sorted(node_spans.begin(), node_spans.end(), [](auto const &lhs, auto const &rhs){
+				return lhs.length_sum < rhs.length_sum;
+			}));
+		}
+		catch (lb::assertion_failure_exception const &exc)
+		{
+			std::cerr << "Node spans:\n";
+			for (auto const &span : node_spans)
+				std::cerr << span << '\n';
+			throw exc;
+		}
+		
+		// Check if the current block is semi-repeat-free.
+		libbio_assert(node_spans.back().is_sentinel());
+		if (node_spans.back().length_sum != seq_count)
+			return;
+		
+		// At this point the current block or column range [(aligned_size - pos), aligned_size)
+		// is semi-repeat-free. Try to move the right bound as far left as possible.
+		switch (ctx.engine)
+		{
+			case depth_engine::climb:
+				determine_string_depths_climb(ctx, snapshot, string_depths);
+				break;
+			
+			case depth_engine::rmq:
+				determine_string_depths_rmq(ctx, snapshot, string_depths);
+				break;
+			
+			case depth_engine::check:
+			{
+				// Run the climbing algorithm last to retain its handled_sequences.
+				determine_string_depths_rmq(ctx, snapshot, snapshot.check_string_depths);
+				determine_string_depths_climb(ctx, snapshot, string_depths);
+				check_string_depths(ctx, snapshot);
+				break;
+			}
+			
+			case depth_engine::r_index:
+				determine_string_depths_r_index(ctx, snapshot, string_depths);
+				break;
+		}
+		
+		snapshot.has_semi_repeat_free_block = true;
+		
+		// Find the minimum right bound for the block by counting characters, unless this is done in the output stage.
+		if (ctx.msa_index)
+		{
+			snapshot.block_rb = find_block_rb(ctx, snapshot, [&ctx](std::size_t const j, fg::length_type const block_lb, std::size_t const string_depth){
+				auto const &seq_idx(ctx.msa_index->sequence_indices[j]);
+				auto const non_gap_count_before(seq_idx.rank0(block_lb));
+				auto const non_gap_rb(non_gap_count_before + string_depth);
+				return seq_idx.select0(non_gap_rb);
+			});
+		}
+	}
+	
+	
+	// Writes the results in column order.
+	// If streaming coordinates are used, the right bounds of the blocks are determined here.
+	template <typename t_cst>
+	class segmentation_output
+	{
+	protected:
+		segmentation_context <t_cst> const						&m_ctx;
+		cereal::PortableBinaryOutputArchive						&m_archive;
+		std::optional <fg::streaming_coordinate_transform>		m_coordinate_transform;
+		std::size_t												m_aligned_size{};
+		std::size_t												m_semi_repeat_free_count{};
+		bool													m_verbose{};
+		
+	public:
+		segmentation_output(segmentation_context <t_cst> const &ctx, cereal::PortableBinaryOutputArchive &archive, bool const verbose):
+			m_ctx(ctx),
+			m_archive(archive),
+			m_aligned_size(ctx.aligned_size),
+			m_verbose(verbose)
+		{
+		}
+		
+		segmentation_output(segmentation_context <t_cst> const &ctx, cereal::PortableBinaryOutputArchive &archive, std::size_t const coordinate_window_size, bool const verbose):
+			m_ctx(ctx),
+			m_archive(archive),
+			m_coordinate_transform(std::in_place, ctx.seq_count, coordinate_window_size),
+			m_aligned_size(ctx.aligned_size),
+			m_verbose(verbose)
+		{
+		}
+		
+		std::size_t semi_repeat_free_count() const { return m_semi_repeat_free_count; }
+		
+		void output(column_snapshot &snapshot)
+		{
+			fg::length_type const block_lb{m_aligned_size - snapshot.pos};
+			
+			if (m_coordinate_transform)
+			{
+				auto &transform(*m_coordinate_transform);
+				transform.add_column(block_lb, [&snapshot](std::size_t const j){ return '-' == snapshot.characters[j]; });
+				if (snapshot.has_semi_repeat_free_block)
+				{
+					snapshot.block_rb = find_block_rb(m_ctx, snapshot, [&transform](std::size_t const j, fg::length_type const, std::size_t const string_depth){
+						return transform.non_gap_column(j, string_depth);
+					});
+				}
+			}
+			
+			if (!snapshot.has_semi_repeat_free_block)
+			{
+				if (m_verbose)
+					std::cerr << "No semi-repeat-free block at column " << block_lb << ".\n";
+				if (m_aligned_size == snapshot.pos)
+					std::cerr << "WARNING: No semi-repeat-free block at column zero.\n";
+				
+				m_archive(fg::length_type(fg::LENGTH_MAX));
+				return;
+			}
+			
+			// Output max_block_rb.
+			if (m_verbose)
+				std::cerr << "Found a semi-repeat-free block at [" << block_lb << ", " << snapshot.block_rb << "].\n";
+			m_archive(fg::length_type(snapshot.block_rb));
+			++m_semi_repeat_free_count;
+		}
+	};
+	
+	
+	// Analyses each column in the current thread.
+	template <typename t_cst>
+	class serial_column_processor
+	{
+	protected:
+		segmentation_context <t_cst> const	&m_ctx;
+		segmentation_output <t_cst>			&m_output;
+		column_snapshot				m_snapshot;
+		
+	public:
+		serial_column_processor(segmentation_context <t_cst> const &ctx, segmentation_output <t_cst> &output):
+			m_ctx(ctx),
+			m_output(output),
+			m_snapshot(ctx.seq_count)
+		{
+		}
+		
+		column_snapshot &next_snapshot() { return m_snapshot; }
+		
+		void submit()
+		{
+			analyse_column(m_ctx, m_snapshot);
+			m_output.output(m_snapshot);
+		}
+		
+		void finish() {}
+	};
+	
+	
+	// Analyses the columns in a concurrent queue. The snapshots are stored in a ring buffer, the size
+	// of which limits the number of columns in flight. The results are written in a serial queue
+	// in column order, after which the snapshot may be reused.
+	template <typename t_cst>
+	class pipelined_column_processor
+	{
+	protected:
+		segmentation_context <t_cst> const			&m_ctx;
+		segmentation_output <t_cst>					&m_output;
+		std::vector <column_snapshot>				m_snapshots;
+		lb::dispatch_ptr <dispatch_queue_t>			m_concurrent_queue;
+		lb::dispatch_ptr <dispatch_queue_t>			m_serial_queue;
+		lb::dispatch_ptr <dispatch_group_t>			m_group;
+		lb::dispatch_ptr <dispatch_semaphore_t>		m_sema;				// Limit the number of snapshots in use.
+		std::size_t									m_submitted_count{};
+		std::size_t									m_output_count{};	// Only accessed from m_serial_queue.
+		
+	public:
+		pipelined_column_processor(segmentation_context <t_cst> const &ctx, segmentation_output <t_cst> &output, std::size_t const buffer_count):
+			m_ctx(ctx),
+			m_output(output),
+			m_snapshots(buffer_count, column_snapshot(ctx.seq_count)),
+			m_concurrent_queue(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), true),
+			m_serial_queue(dispatch_queue_create("fi.iki.tsnorri.founder-graphs-semi-repeat-free.output-queue", DISPATCH_QUEUE_SERIAL)),
+			m_group(dispatch_group_create()),
+			m_sema(dispatch_semaphore_create(buffer_count))
+		{
+			libbio_always_assert_lt(0, buffer_count);
+		}
+		
+		column_snapshot &next_snapshot()
+		{
+			dispatch_semaphore_wait(*m_sema, DISPATCH_TIME_FOREVER);
+			return m_snapshots[m_submitted_count % m_snapshots.size()];
+		}
+		
+		void submit()
+		{
+			auto &snapshot(m_snapshots[m_submitted_count % m_snapshots.size()]);
+			++m_submitted_count;
+			
+			lb::dispatch_group_async_fn(*m_group, *m_concurrent_queue, [this, &snapshot](){
+				analyse_column(m_ctx, snapshot);
+				
+				lb::dispatch_group_async_fn(*m_group, *m_serial_queue, [this, &snapshot](){
+					snapshot.is_done = true;
+					output_done();
+				});
+			});
+		}
+		
+		void finish()
+		{
+			dispatch_group_wait(*m_group, DISPATCH_TIME_FOREVER);
+			libbio_always_assert_eq(m_submitted_count, m_output_count);
+		}
+		
+	protected:
+		void output_done()
+		{
+			// Output the consecutive columns that have been analysed.
+			while (true)
+			{
+				auto &snapshot(m_snapshots[m_output_count % m_snapshots.size()]);
+				if (!snapshot.is_done)
+					break;
+				
+				m_output.output(snapshot);
+				snapshot.is_done = false;
+				++m_output_count;
+				dispatch_semaphore_signal(*m_sema);
+			}
+		}
+	};
+	
+	
+	template <typename t_cst, typename t_index, typename t_processor>
+	void process_columns(
 		fg::reverse_msa_reader &reader,
-		bool const verbose
+		segmentation_context <t_cst> const &ctx,
+		t_index const &index,		// CSA or r-index.
+		t_processor &processor
 	)
 	{
-		lb::log_time(std::cerr) << "Loading the data structures…\n";
-
-		// Open the inputs.
-		lb::file_istream sequence_path_stream;
-		lb::open_file_for_reading(sequence_list_path, sequence_path_stream);
+		auto const seq_count(ctx.seq_count);
+		auto const aligned_size(ctx.aligned_size);
 		
-		fg::cst_type cst;
-		fg::msa_index msa_index;
+		// For storing the intervals, a slightly different idea (w.r.t. the one in the paper) is used.
+		// Store the lexicographic ranges in a vector, sort and calculate the cumulative sum of the lengths of lexicographic ranges. (The sum of the lengths is important b.c. there can be nodes between the nodes in the same subtree, and we want to exclude them.) Process from left to right as follows.
+		// – Set L and R to the vector index the current node.
+		// – Use the parent operation on the node and then the equal_range operation. Check if the lexicographic range of the found parent matches the boundaries of the equal range.
+		// 		– If it does, store the vector index range [L, R].
+		// 		– If it does not, the string depth of the parent node plus one should be stored with the nodes in the previously found equivalence class (i.e. nodes between L and R).
+		// – Continue from the next node w.r.t. R.
+		// 
+		// The lexicographic ranges in the vector need not be replaced at any point b.c. if some nodes have a valid parent node (in the sense that it does not have any other child nodes), the same nodes can be used to determine the range of the parent node.
+		//
+		// Only the backward search step depends on the previous column, so it is done here. The rest of
+		// the steps are done in analyse_column() using a snapshot of the lexicographic ranges.
+		// The ranges are kept sorted in sorted_range_set, so that the order need not be determined from scratch for every column.
+		fg::sorted_range_set <t_index> range_set(index, seq_count);
+		std::size_t pos{0};
+		while (reader.fill_buffer(
+			[
+				&reader,
+				&pos,
+				seq_count,
+				aligned_size,
+				&range_set,
+				&ctx,
+				&index,
+				&processor
+			](bool const did_fill){
+				
+				if (!did_fill)
+					return false;
+				
+				auto const block_size(reader.block_size());
+				// Read the characters. The reader stores the columns contiguously, so reading one column
+				// touches only seq_count consecutive bytes.
+				for (std::size_t i(0); i < block_size; ++i)
+				{
+					++pos;
+					libbio_assert_lte(pos, aligned_size);
+					
+					if (0 == pos % 1000000)
+						lb::log_time(std::cerr) << "Position " << pos << '/' << aligned_size << "…\n";
+					
+					// Extend the ranges once per equivalence class and character, skip gap characters.
+					auto const column(reader.column(i));
+					auto const char_fn([column](std::size_t const j){
+						return column[j];
+					});
+					
+					try
+					{
+						range_set.backward_search(index, '-', char_fn);
+					}
+					catch (lb::assertion_failure_exception const &exc)
+					{
+						std::cerr << "Position: " << (aligned_size - pos) << '\n';
+						for (std::size_t j(0); j < seq_count; ++j)
+						{
+							auto const cc(char_fn(j));
+							auto const cc_(std::uint8_t(cc)); // char may be signed.
+							if ('-' != cc && 0 == index.char2comp[cc_])
+								std::cerr << "Sequence: " << j << " character: '" << cc << "' (" << std::hex << int(cc_) << std::dec << ")\n";
+						}
+						throw exc;
+					}
+					
+					// Pass a copy of the equivalence classes to the processor.
+					auto &snapshot(processor.next_snapshot());
+					snapshot.pos = pos;
+					snapshot.lexicographic_ranges.clear();
+					snapshot.member_limits.clear();
+					for (auto const &eq_class : range_set.classes())
+					{
+						snapshot.lexicographic_ranges.emplace_back(eq_class.range);
+						snapshot.member_limits.push_back(eq_class.member_offset);
+					}
+					snapshot.member_limits.push_back(range_set.size());
+					std::copy(range_set.members().begin(), range_set.members().end(), snapshot.members.begin());
+					if (!ctx.msa_index)
+					{
+						for (std::size_t j(0); j < seq_count; ++j)
+							snapshot.characters[j] = char_fn(j);
+					}
+					processor.submit();
+				}
+				
+				return true;
+			}
+		));
 		
-		read_from_file(cst_path, cst);
-		read_from_file(msa_index_path, msa_index);
+		processor.finish();
+	}
+	
+	
+	template <typename t_cst>
+	segmentation_output <t_cst> make_segmentation_output(
+		gengetopt_args_info const &args_info,
+		segmentation_context <t_cst> const &ctx,
+		cereal::PortableBinaryOutputArchive &archive
+	)
+	{
+		if (ctx.msa_index)
+			return segmentation_output <t_cst>(ctx, archive, args_info.verbose_flag);
 		
+		// The string depths are at most one plus the maximum LCP value, so the window needs to contain
+		// that many non-gap characters unless specified otherwise.
+		std::size_t window_size{};
+		if (args_info.coordinate_window_given)
 		{
-			std::string line;
-			while (std::getline(sequence_path_stream, line))
-				reader.add_file(line);
+			if (args_info.coordinate_window_arg <= 0)
+			{
+				std::cerr << "Coordinate window size must be positive.\n";
+				std::exit(EXIT_FAILURE);
+			}
+			
+			window_size = args_info.coordinate_window_arg;
+		}
+		else if (ctx.r_index)
+		{
+			window_size = 1 + ctx.r_index->max_lcp();
+		}
+		else
+		{
+			lb::log_time(std::cerr) << "Determining the maximum LCP value…\n";
+			std::size_t max_lcp{};
+			for (auto const val : ctx.cst->lcp)
+				max_lcp = std::max <std::size_t>(max_lcp, val);
+			window_size = 1 + max_lcp;
+		}
+		
+		lb::log_time(std::cerr) << "Using streaming coordinates with a window of " << window_size << " characters.\n";
+		return segmentation_output <t_cst>(ctx, archive, window_size, args_info.verbose_flag);
+	}
+	
+	
+	template <typename t_cst>
+	void find_founder_block_boundaries(
+		gengetopt_args_info const &args_info,
+		fg::reverse_msa_reader &reader,
+		t_cst const *cst,
+		fg::r_index const *r_index,
+		fg::msa_index const *msa_index
+	)
+	{
+		// Either cst or r_index is non-null.
+		libbio_assert(!cst != !r_index);
+		
+		// Prepare the depth engine.
+		depth_engine engine{};
+		rmq_type lcp_rmq;
+		if (r_index)
+		{
+			lb::log_time(std::cerr) << "The r-index has " << r_index->run_count() << " runs.\n";
+			engine = depth_engine::r_index;
+		}
+		else
+		{
+			switch (args_info.depth_engine_arg)
+			{
+				case depth_engine_arg_climb:
+					engine = depth_engine::climb;
+					break;
+			
+				case depth_engine_arg_rmq:
+					engine = depth_engine::rmq;
+					break;
+			
+				case depth_engine_arg_check:
+					engine = depth_engine::check;
+					break;
+			
+				default:
+					std::cerr << "ERROR: Unexpected depth engine.\n";
+					std::exit(EXIT_FAILURE);
+			}
+		
+			if (depth_engine::climb != engine)
+			{
+				lb::log_time(std::cerr) << "Building the RMQ support for the LCP array…\n";
+				lcp_rmq = rmq_type(&cst->lcp);
+			}
 		}
 		
 		// Prepare for output.
 		cereal::PortableBinaryOutputArchive archive(std::cout);
 		std::size_t semi_repeat_free_count{};
-
+		
 		// Process.
 		{
 			// Prepare the reader.
+			reader.set_layout(fg::msa_buffer_layout::column_major);
 			reader.prepare();
 			auto const seq_count(reader.handle_count());
 			auto const aligned_size(reader.aligned_size());
@@ -163,266 +1054,95 @@ namespace {
 			// Output the aligned size.
 			archive(cereal::make_size_tag(aligned_size));
 			
-			// For storing the intervals, a slightly different idea (w.r.t. the one in the paper) is used.
-			// Store the lexicographic ranges in a vector, sort and calculate the cumulative sum of the lengths of lexicographic ranges. (The sum of the lengths is important b.c. there can be nodes between the nodes in the same subtree, and we want to exclude them.) Process from left to right as follows.
-			// – Set L and R to the vector index the current node.
-			// – Use the parent operation on the node and then the equal_range operation. Check if the lexicographic range of the found parent matches the boundaries of the equal range.
-			// 		– If it does, store the vector index range [L, R].
-			// 		– If it does not, the string depth of the parent node plus one should be stored with the nodes in the previously found equivalence class (i.e. nodes between L and R).
-			// – Continue from the next node w.r.t. R.
-			// 
-			// The lexicographic ranges in the vector need not be replaced at any point b.c. if some nodes have a valid parent node (in the sense that it does not have any other child nodes), the same nodes can be used to determine the range of the parent node.
-			std::vector <lexicographic_range> lexicographic_ranges(seq_count, lexicographic_range(0, cst.csa.size() - 1));
-			node_span_vector node_spans(1 + seq_count);
-			std::vector <std::size_t> string_depths(seq_count);
-			std::size_t pos{0};
-			std::vector <std::size_t> handled_sequences; // For debugging.
+			segmentation_context <t_cst> const ctx(
+				cst,
+				r_index,
+				msa_index,
+				&lcp_rmq,
+				seq_count,
+				aligned_size,
+				engine
+			);
+			auto output(make_segmentation_output(args_info, ctx, archive));
+			
+			auto const process([&reader, &ctx, cst, r_index](auto &processor){
+				if (r_index)
+					process_columns(reader, ctx, *r_index, processor);
+				else
+					process_columns(reader, ctx, cst->csa, processor);
+			});
+			
 			lb::log_time(std::cerr) << "Finding founder block boundaries…\n";
-			while (reader.fill_buffer(
-				[
-					&reader,
-					verbose,
-					&pos,
-					seq_count,
-					aligned_size,
-					&lexicographic_ranges,
-					&cst,
-					&node_spans,
-					&archive,
-					&semi_repeat_free_count,
-					&string_depths,
-					&msa_index,
-					&handled_sequences
-				](bool const did_fill){
-					
-					if (!did_fill)
-						return false;
-					
-					auto const &buffer(reader.buffer());
-					auto const block_size(reader.block_size());
-					// Read the characters.
-					for (std::size_t i(0); i < block_size; ++i)
-					{
-						++pos;
-						libbio_assert_lte(pos, aligned_size);
-
-						if (0 == pos % 1000000)
-							lb::log_time(std::cerr) << "Position " << pos << '/' << aligned_size << "…\n";
-						
-						for (std::size_t j(0); j < seq_count; ++j)
-						{
-							auto const idx((j + 1) * block_size - i - 1);
-							auto const cc(buffer[idx]);
-							auto &lex_range(lexicographic_ranges[j]);
-							
-							// Skip gap characters.
-							if ('-' != cc)
-							{
-								try
-								{
-									sdsl::backward_search(cst.csa, lex_range.lb, lex_range.rb, cc, lex_range.lb, lex_range.rb);
-									libbio_always_assert_lte(lex_range.lb, lex_range.rb);
-								}
-								catch (lb::assertion_failure_exception const &exc)
-								{
-									std::cerr << "Sequence: " << j << '\n';
-									std::cerr << "Position: " << (aligned_size - pos) << '\n';
-									std::cerr << "Character: '" << cc << "' (" << std::hex << int(cc) << ")\n";
-									throw exc;
-								}
-							}
-							
-							// Convert to a CST node and store the sequence identifier.
-							auto &span(node_spans[j]);
-							span = node_span(cst.node(lex_range.lb, lex_range.rb), j);
-						}
-						
-						// Sentinel.
-						node_spans[seq_count] = node_span(node_span::sentinel_tag{});
-
-						// Sort by the left bound and the in reverse by the right bound.
-						// Since the nodes represent lexicographic ranges, they can overlap only by being nested.
-						std::sort(node_spans.begin(), node_spans.end(), [](auto const &lhs, auto const &rhs){
-							return std::make_tuple(lhs.node.i, lhs.node.j) < std::make_tuple(rhs.node.i, rhs.node.j);
-						});
-
-						// Update the cumulative sum.
-						// Ignore nested intervals.
-						{
-							auto &first_span(node_spans.front());
-							first_span.length_sum = 0;
-							auto const count(node_spans.size()); // Consider the sentinel, too.
-							if (1 < count)
-							{
-								// If count == 2, second_span is the sentinel.
-								auto &second_span(node_spans[1]);
-								second_span.length_sum = first_span.length_sum + first_span.interval_length();
-								for (std::size_t j(2); j < count; ++j)
-								{
-									// Don’t consider the interval of the current span, just those of the two previous ones.
-									auto &span(node_spans[j]);
-									auto const &prev1(node_spans[j - 1]);
-									auto const &prev2(node_spans[j - 2]);
-									if (prev1.encloses(prev2)) // Safe b.c. of the comparison operator used when sorting.
-										span.length_sum = prev1.length_sum + prev1.interval_length() - prev2.interval_length();
-									else
-										span.length_sum = prev1.length_sum + prev1.interval_length();
-								}
-							}
-						}
-
-						// Make sure the altorighm for updating the cumulative sum is correct.
-						try
-						{
-							libbio_assert(std::is_sorted(node_spans.begin(), node_spans.end(), [](auto const &lhs, auto const &rhs){
-								return lhs.length_sum < rhs.length_sum;
-							}));
-						}
-						catch (lb::assertion_failure_exception const &exc)
-						{
-							std::cerr << "Node spans:\n";
-							for (auto const &span : node_spans)
-								std::cerr << span << '\n';
-							throw exc;
-						}
-						
-						// Check if the current block is semi-repeat-free.
-						libbio_assert(node_spans.back().is_sentinel());
-						if (node_spans.back().length_sum != seq_count)
-						{
-							if (verbose)
-								std::cerr << "No semi-repeat-free block at column " << (aligned_size - pos) << ".\n";
-							if (aligned_size == pos)
-								std::cerr << "WARNING: No semi-repeat-free block at column zero.\n";
-
-							archive(fg::length_type(fg::LENGTH_MAX));
-							continue;
-						}
-						
-						// At this point the current block or column range [(aligned_size - pos), aligned_size)
-						// is semi-repeat-free. Try to move the right bound as far left as possible.
-						{
-							node_span_cmp cmp;
-							
-							// Fill with placeholder values for extra safety.
-							std::fill(string_depths.begin(), string_depths.end(), SIZE_MAX);
-							
-							auto node_it(node_spans.cbegin());
-							auto const node_end(node_spans.cend() - 1); // Don’t handle the sentinel.
-							handled_sequences.clear();
-							while (node_it != node_end)
-							{
-								auto &span(*node_it);
-								node_span_vector_range span_equivalence_class(node_spans.cend(), node_spans.cend());
-								auto node(span.node); // Copy.
-								// On the first round, determine the initial equivalence class.
-								// Then proceed to the ancestor nodes.
-								while (true)
-								{
-									lexicographic_range const rng(cst.lb(node), cst.rb(node));
-									// Check if the length of the lexicographic range increased.
-									auto equal_range(std::equal_range(node_it, node_spans.cend(), rng, cmp));
-									libbio_assert_neq(equal_range.second, node_spans.end()); // second should always point to a valid element b.c. the last element is the sentinel.
-									libbio_assert_lt(equal_range.first, equal_range.second); // The range should always be non-empty b.c. the node itself should be inside it.
-									// Stop if we extended too much.
-									if (equal_range.second->length_sum - equal_range.first->length_sum != rng.interval_length())
-										break;
-									// Otherwise store the new range.
-									span_equivalence_class = equal_range;
-									// Continue from the parent node.
-									node = cst.parent(node);
-								}
-								
-								// cst.parent() should be called at least once b.c. the initial range is semi-repeat-free.
-								libbio_assert_neq(span.node, node);
-								
-								// Determine the string depth.
-								auto const string_depth(1 + cst.depth(node));
-								libbio_assert_lt(0, string_depth);
-								for (auto const &span : ranges::subrange(span_equivalence_class.first, span_equivalence_class.second))
-								{
-									string_depths[span.sequence] = string_depth;
-#ifndef NDEBUG
-									handled_sequences.push_back(span.sequence);
-#endif
-								}
-								
-								node_it = span_equivalence_class.second;
-							}
-						}
-
-						// Find the minimum right bound for the block by counting characters.
-						fg::length_type const block_lb{aligned_size - pos};
-						fg::length_type max_block_rb{0}; // Right bound of a /closed/ interval.
-						for (std::size_t j(0); j < seq_count; ++j)
-						{
-							try
-							{
-								auto const string_depth(string_depths[j]);
-								libbio_assert_lt(0, string_depth);
-								libbio_assert_neq(string_depth, SIZE_MAX);
-								auto const &seq_idx(msa_index.sequence_indices[j]);
-								auto const non_gap_count_before(seq_idx.rank0_support(block_lb));
-								auto const non_gap_rb(non_gap_count_before + string_depth);
-								auto const block_rb(seq_idx.select0_support(non_gap_rb));
-								libbio_always_assert_lt(block_rb, SIZE_MAX);
-								max_block_rb = std::max(max_block_rb, fg::length_type(block_rb));
-							}
-							catch (lb::assertion_failure_exception const &exc)
-							{
-								std::cerr << "String depth for sequence " << j << '/' << seq_count << " was not set.\n";
-
-								std::cerr << "Handled sequences:\n";
-								std::sort(handled_sequences.begin(), handled_sequences.end());
-								for (auto const idx : handled_sequences)
-									std::cerr << idx << '\n';
-
-								std::cerr << "Node spans (" << node_spans.size() << "):\n";
-								for (auto const &span : node_spans)
-									std::cerr << span << '\n';
-
-								auto sorted_node_spans(node_spans);
-								std::sort(sorted_node_spans.begin(), sorted_node_spans.end(), [](auto const &lhs, auto const &rhs){
-									return lhs.sequence < rhs.sequence;
-								});
-								std::cerr << "Sorted node spans (" << sorted_node_spans.size() << "):\n";
-								for (auto const &span : sorted_node_spans)
-									std::cerr << span << '\n';
-								{
-									std::cerr << "Equivalent sequence numbers:\n";
-									std::size_t prev_eq(SIZE_MAX);
-									for (std::size_t k(1); k < sorted_node_spans.size(); ++k)
-									{
-										if (sorted_node_spans[k - 1].sequence == sorted_node_spans[k].sequence)
-										{
-											if (k - 1 != prev_eq)
-												std::cerr << sorted_node_spans[k - 1] << '\n';
-											std::cerr << sorted_node_spans[k] << '\n';
-											prev_eq = k;
-										}
-									}
-								}
-
-								throw exc;
-							}
-						}
-						
-						// Output max_block_rb.
-						// The semi-repeat-free range will be [block_lb, max_block_rb].
-						if (verbose)
-							std::cerr << "Found a semi-repeat-free block at [" << block_lb << ", " << max_block_rb << "].\n";
-						archive(fg::length_type(max_block_rb));
-						++semi_repeat_free_count;
-					}
-					
-					return true;
+			if (args_info.pipelined_flag)
+			{
+				if (args_info.buffer_count_arg <= 0)
+				{
+					std::cerr << "Buffer count must be positive.\n";
+					std::exit(EXIT_FAILURE);
 				}
-			));
+				
+				pipelined_column_processor <t_cst> processor(ctx, output, args_info.buffer_count_arg);
+				process(processor);
+			}
+			else
+			{
+				serial_column_processor <t_cst> processor(ctx, output);
+				process(processor);
+			}
+			
+			semi_repeat_free_count = output.semi_repeat_free_count();
 		}
 		
 		std::cout << std::flush;
 		lb::log_time(std::cerr) << "Done. Found " << semi_repeat_free_count << " semi-repeat-free blocks.\n";
 	}
+	
+	
+	void find_founder_block_boundaries(
+		gengetopt_args_info const &args_info,
+		fg::reverse_msa_reader &reader
+	)
+	{
+		lb::log_time(std::cerr) << "Loading the data structures…\n";
+		
+		// Open the inputs.
+		lb::file_istream sequence_path_stream;
+		lb::open_file_for_reading(args_info.sequence_list_arg, sequence_path_stream);
+		
+		fg::cst_variant cst;
+		fg::r_index r_index;
+		fg::msa_index msa_index;
+		bool const uses_r_index(args_info.r_index_arg);
+		bool const uses_streaming_coordinates(args_info.streaming_coordinates_flag);
+		
+		if (uses_r_index)
+			read_from_file(args_info.r_index_arg, r_index);
+		else
+		{
+			// The flavour is determined from the header of the file.
+			fg::read_cst(args_info.cst_arg, cst);
+			lb::log_time(std::cerr) << "The CST flavour is " << fg::cst_flavour_name(fg::cst_flavour(cst.index())) << ".\n";
+		}
+		
+		if (!uses_streaming_coordinates)
+			read_from_file(args_info.msa_index_arg, msa_index);
+		
+		{
+			std::string line;
+			while (std::getline(sequence_path_stream, line))
+				reader.add_file(line);
+		}
+		
+		auto const * const msa_index_ptr(uses_streaming_coordinates ? nullptr : &msa_index);
+		if (uses_r_index)
+			find_founder_block_boundaries <fg::cst_type>(args_info, reader, nullptr, &r_index, msa_index_ptr);
+		else
+		{
+			std::visit([&args_info, &reader, msa_index_ptr](auto const &cst_){
+				find_founder_block_boundaries(args_info, reader, &cst_, nullptr, msa_index_ptr);
+			}, cst);
+		}
+	}
 }
 
 
@@ -439,15 +1159,70 @@ int main(int argc, char **argv)
 	std::ios_base::sync_with_stdio(false);	// Don't use C style IO after calling cmdline_parser.
 	std::cin.tie(nullptr);					// We don't require any input from the user.
 	
-	if (args_info.bgzip_input_flag)
+	if (!(args_info.streaming_coordinates_flag || args_info.msa_index_arg))
+	{
+		std::cerr << "MSA index is required unless --streaming-coordinates is given.\n";
+		std::exit(EXIT_FAILURE);
+	}
+	
+	if (1 != bool(args_info.cst_arg) + bool(args_info.r_index_arg))
+	{
+		std::cerr << "ERROR: Exactly one of --cst and --r-index is required.\n";
+		std::exit(EXIT_FAILURE);
+	}
+	
+	if (args_info.r_index_arg && args_info.depth_engine_given)
 	{
+		std::cerr << "ERROR: --depth-engine cannot be used with --r-index.\n";
+		std::exit(EXIT_FAILURE);
+	}
+	
+	if (1 < args_info.bgzip_input_flag + args_info.packed_input_flag + args_info.fasta_input_flag)
+	{
+		std::cerr << "ERROR: --bgzip-input, --packed-input and --fasta-input are mutually exclusive.\n";
+		std::exit(EXIT_FAILURE);
+	}
+	
+	if (args_info.mmap_flag && !args_info.bgzip_input_flag)
+	{
+		std::cerr << "ERROR: --mmap can only be used with --bgzip-input.\n";
+		std::exit(EXIT_FAILURE);
+	}
+	
+	if (args_info.io_uring_flag && (args_info.bgzip_input_flag || args_info.packed_input_flag || args_info.fasta_input_flag))
+	{
+		std::cerr << "ERROR: --io-uring can only be used with uncompressed text input.\n";
+		std::exit(EXIT_FAILURE);
+	}
+	
+	if (args_info.fasta_input_flag)
+	{
+		fg::fasta_reverse_msa_reader reader;
+		find_founder_block_boundaries(args_info, reader);
+	}
+	else if (args_info.packed_input_flag)
+	{
+		fg::packed_reverse_msa_reader reader;
+		find_founder_block_boundaries(args_info, reader);
+	}
+	else if (args_info.bgzip_input_flag)
+	{
+		if (args_info.read_ahead_arg < 0)
+		{
+			std::cerr << "ERROR: Read-ahead block count must be non-negative.\n";
+			std::exit(EXIT_FAILURE);
+		}
+		
 		fg::bgzip_reverse_msa_reader reader;
-		find_founder_block_boundaries(args_info.sequence_list_arg, args_info.cst_arg, args_info.msa_index_arg, reader, args_info.verbose_flag);
+		reader.set_read_ahead_block_count(args_info.read_ahead_arg);
+		reader.set_access_mode(args_info.mmap_flag ? fg::bgzip_access_mode::mmap : fg::bgzip_access_mode::pread);
+		find_founder_block_boundaries(args_info, reader);
 	}
 	else
 	{
 		fg::text_reverse_msa_reader reader;
-		find_founder_block_boundaries(args_info.sequence_list_arg, args_info.cst_arg, args_info.msa_index_arg, reader, args_info.verbose_flag);
+		reader.set_uses_io_uring(args_info.io_uring_flag);
+		find_founder_block_boundaries(args_info, reader);
 	}
 	
 	return EXIT_SUCCESS;
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#ifndef FOUNDER_GRAPHS_BATCHED_BACKWARD_SEARCH_HH
+#define FOUNDER_GRAPHS_BATCHED_BACKWARD_SEARCH_HH
+
+#include <founder_graphs/cst.hh>
+#include <sdsl/suffix_array_algorithm.hpp>
+#include <span>
+
+
+namespace founder_graphs {
+	
+	template <typename t_csa>
+	struct backward_search_query
+	{
+		typedef t_csa							csa_type;
+		typedef typename csa_type::size_type	size_type;
+		typedef typename csa_type::char_type	char_type;
+		
+		size_type	lb{};
+		size_type	rb{};
+		char_type	cc{};
+		
+		backward_search_query() = default;
+		
+		backward_search_query(size_type const lb_, size_type const rb_, char_type const cc_):
+			lb(lb_),
+			rb(rb_),
+			cc(cc_)
+		{
+		}
+		
+		template <typename t_range>
+		backward_search_query(t_range const &range, char_type const cc_):
+			lb(range.lb),
+			rb(range.rb),
+			cc(cc_)
+		{
+		}
+		
+		size_type size() const { return rb + 1 - lb; }
+		bool empty() const { return rb + 1 == lb; }
+		
+		// Store the extended range.
+		template <typename t_range>
+		void assign_to(t_range &range) const
+		{
+			range.lb = lb;
+			range.rb = rb;
+		}
+	};
+	
+	
+	// Extend the ranges of the given queries with their characters in place. As in sdsl::backward_search(),
+	// an empty range is indicated by rb + 1 == lb. The queries are processed in small batches level by level
+	// in the wavelet tree, and the bit vector words needed on the next level are prefetched, so that the
+	// memory accesses of the queries overlap.
+	void batched_backward_search(csa_type const &csa, std::span <backward_search_query <csa_type>> const queries);
+	
+	
+	// Fallback for other index types.
+	template <typename t_csa>
+	void batched_backward_search(t_csa const &csa, std::span <backward_search_query <t_csa>> const queries)
+	{
+		for (auto &query : queries)
+			sdsl::backward_search(csa, query.lb, query.rb, query.cc, query.lb, query.rb);
+	}
+}
+
+#endif
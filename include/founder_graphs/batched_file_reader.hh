@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#ifndef FOUNDER_GRAPHS_BATCHED_FILE_READER_HH
+#define FOUNDER_GRAPHS_BATCHED_FILE_READER_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+
+namespace founder_graphs {
+	
+	struct read_request
+	{
+		char			*buffer{};
+		std::size_t		offset{};		// File offset.
+		std::size_t		length{};
+		std::uint32_t	file_index{};	// Index of the file in the span passed to set_files().
+	};
+	
+	
+	// Reads a number of file ranges at a time. On Linux, the reads are submitted to io_uring in one batch,
+	// and the completions are reaped while the remaining reads are in flight. If io_uring is not available,
+	// the ranges are read with pread().
+	class batched_file_reader
+	{
+	public:
+		constexpr static inline unsigned int const QUEUE_DEPTH_DEFAULT{256};
+		
+	protected:
+		struct io_uring_context;
+		
+	protected:
+		std::unique_ptr <io_uring_context>	m_ring;
+		std::vector <int>					m_fds;
+		std::vector <std::size_t>			m_progress;		// Bytes read so far, per request.
+		std::vector <std::size_t>			m_pending;		// Indices of the requests to be submitted.
+		
+	public:
+		batched_file_reader();
+		~batched_file_reader();
+		
+		batched_file_reader(batched_file_reader const &) = delete;
+		batched_file_reader &operator=(batched_file_reader const &) = delete;
+		batched_file_reader(batched_file_reader &&);
+		batched_file_reader &operator=(batched_file_reader &&);
+		
+		// Try to set up io_uring. Returns false if not available, in which case read() falls back to pread().
+		bool setup_io_uring(unsigned int const queue_depth = QUEUE_DEPTH_DEFAULT);
+		bool uses_io_uring() const { return bool(m_ring); }
+		
+		// Set the files to be read. The descriptors are registered with io_uring if possible.
+		void set_files(std::span <int const> const fds);
+		
+		// Register a buffer with io_uring s.t. reads to it need not map the pages for each request.
+		// The buffer needs to remain valid until the next call or until the reader is destroyed.
+		void register_buffer(std::span <char> const buffer);
+		
+		// Read the given ranges. Throws std::runtime_error on read errors and on unexpected end of file.
+		void read(std::span <read_request const> const requests);
+		
+	protected:
+		void read_pread(std::span <read_request const> const requests);
+		void read_io_uring(std::span <read_request const> const requests);
+	};
+}
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#ifndef FOUNDER_GRAPHS_BGZIP_BLOCK_CACHE_HH
+#define FOUNDER_GRAPHS_BGZIP_BLOCK_CACHE_HH
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace founder_graphs {
+	
+	constexpr static inline std::size_t const BGZIP_BLOCK_CACHE_SIZE_DEFAULT{256 * 1024 * 1024};
+	
+	
+	// Least-recently-used cache of decompressed BGZF blocks of a number of files (rows).
+	// The total size of the cached blocks is limited to the given number of bytes.
+	// May be shared by several readers and used from multiple threads. Each reader should
+	// get identifiers for its files with add_file().
+	class bgzip_block_cache
+	{
+	public:
+		struct block
+		{
+			std::vector <char>	data;
+			std::once_flag		is_decompressed;	// The block should be filled with std::call_once.
+			
+			explicit block(std::size_t const size): data(size) {}
+		};
+		
+		typedef std::shared_ptr <block>		block_ptr;
+		
+	protected:
+		typedef std::pair <std::size_t, std::size_t>	key_type;	// File identifier, block.
+		
+		struct key_hash
+		{
+			std::size_t operator()(key_type const &key) const { return std::hash <std::size_t>()(key.first) ^ (std::hash <std::size_t>()(key.second) * 0x9e3779b97f4a7c15ULL); }
+		};
+		
+		typedef std::list <std::pair <key_type, block_ptr>>	entry_list;	// Most recently used first.
+		
+	protected:
+		entry_list														m_entries;
+		std::unordered_map <key_type, entry_list::iterator, key_hash>	m_entries_by_key;
+		std::mutex														m_mutex;
+		std::size_t														m_capacity{};	// In bytes.
+		std::size_t														m_size{};
+		std::size_t														m_hit_count{};
+		std::size_t														m_miss_count{};
+		std::size_t														m_file_count{};
+		
+	public:
+		explicit bgzip_block_cache(std::size_t const capacity = BGZIP_BLOCK_CACHE_SIZE_DEFAULT):
+			m_capacity(capacity)
+		{
+		}
+		
+		// Return a new file identifier.
+		std::size_t add_file() { std::lock_guard const lock(m_mutex); return m_file_count++; }
+		
+		// Return the block with the given identifiers. If it is not cached, an empty block of the given size
+		// is added and returned; the caller should then decompress it with std::call_once. Evicted blocks
+		// remain valid as long as they are referenced.
+		block_ptr get(std::size_t const file_id, std::size_t const block_idx, std::size_t const size);
+		
+		// Remove all the blocks and reset the counters.
+		void clear();
+		
+		std::size_t capacity() const { return m_capacity; }
+		std::size_t size() { std::lock_guard const lock(m_mutex); return m_size; }
+		std::size_t hit_count() { std::lock_guard const lock(m_mutex); return m_hit_count; }
+		std::size_t miss_count() { std::lock_guard const lock(m_mutex); return m_miss_count; }
+		
+	protected:
+		void evict();
+	};
+}
+
+#endif
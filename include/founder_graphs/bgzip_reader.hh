@@ -11,12 +11,18 @@
 #include <libbio/cxxcompat.hh>
 #include <libbio/file_handle.hh>
 #include <ostream>
+#include <span>
 #include <string>
+#include <utility>
 #include <vector>
 
 
 namespace founder_graphs {
 	
+	// Default number of blocks read in advance by the MSA readers.
+	constexpr static inline std::size_t const READ_AHEAD_BLOCK_COUNT_DEFAULT{2};
+	
+	
 	struct bgzip_index_entry
 	{
 		std::size_t	compressed_offset{};
@@ -48,22 +54,83 @@ namespace founder_graphs {
 	typedef std::vector <bgzip_index_entry> index_entry_vector;
 	
 	
+	enum class bgzip_access_mode
+	{
+		pread,	// Copy the compressed data to a buffer.
+		mmap	// Map the compressed file and decompress from the mapped memory.
+	};
+	
+	
+	enum class bgzip_access_pattern
+	{
+		normal,
+		sequential,	// From the first block to the last one.
+		reverse		// From the last block to the first one.
+	};
+	
+	
+	// Read-only mapping of a file.
+	class memory_mapping
+	{
+	protected:
+		char const	*m_data{};
+		std::size_t	m_size{};
+		
+	public:
+		memory_mapping() = default;
+		memory_mapping(libbio::file_handle const &handle, std::size_t const size);
+		~memory_mapping() { unmap(); }
+		
+		memory_mapping(memory_mapping const &) = delete;
+		memory_mapping &operator=(memory_mapping const &) = delete;
+		memory_mapping(memory_mapping &&other) { *this = std::move(other); }
+		inline memory_mapping &operator=(memory_mapping &&other);
+		
+		void unmap();
+		void advise(std::size_t const offset, std::size_t const length, int const advice) const;
+		
+		char const *data() const { return m_data; }
+		std::size_t size() const { return m_size; }
+		bool empty() const { return nullptr == m_data; }
+	};
+	
+	
 	class bgzip_reader
 	{
+	public:
+		typedef std::span <char const>	input_span_type;
+		
 	protected:
 		libbio::file_handle	m_handle;
+		memory_mapping		m_mapping;
 		index_entry_vector	m_index_entries;
 		std::vector <char>	m_input_buffer;
+		input_span_type		m_input;
 		std::size_t			m_current_block{};
 		std::size_t			m_preferred_block_size{};
 		std::size_t			m_last_read_count{};
+		bgzip_access_mode	m_access_mode{bgzip_access_mode::pread};
+		bool				m_should_verify_checksums{true};
 		
 	public:
 		void open(std::string const &path);
 		void open(libbio::file_handle &&handle, libbio::file_handle &index_handle);
 		
+		// Should be called before open().
+		void set_access_mode(bgzip_access_mode const mode) { m_access_mode = mode; }
+		bgzip_access_mode access_mode() const { return m_access_mode; }
+		
+		// Advise the kernel about the order in which the blocks will be read. Only has an effect in the mmap mode.
+		void advise_access_pattern(bgzip_access_pattern const pattern) const;
+		// Advise the kernel that the given blocks will be read soon. Only has an effect in the mmap mode.
+		void advise_will_need(std::size_t const block, std::size_t const count) const;
+		
 		index_entry_vector const &index_entries() const { return m_index_entries; }
 		
+		// Compare the CRC32 values of the blocks to those of the decompressed data.
+		void set_verifies_checksums(bool const should_verify) { m_should_verify_checksums = should_verify; }
+		bool verifies_checksums() const { return m_should_verify_checksums; }
+		
 		inline std::size_t find_uncompressed_offset_lb(std::size_t const offset) const;
 		std::size_t find_uncompressed_offset_rb(std::size_t const offset) const { return find_uncompressed_offset_rb(offset, 0); }
 		inline std::size_t find_uncompressed_offset_rb(std::size_t const offset, std::size_t const start) const;
@@ -84,9 +151,28 @@ namespace founder_graphs {
 		void read_current_block() { read_blocks(1); }
 		void read_blocks(std::size_t const count);
 		std::size_t decompress(std::span <char> buffer) const;
+		
+		// Variants that do not use the internal buffer and hence may be called from multiple threads.
+		// read_blocks() returns the compressed data, which is stored in input_buffer only in the pread mode.
+		input_span_type read_blocks(std::size_t const block, std::size_t const count, std::vector <char> &input_buffer) const;
+		std::size_t decompress(std::size_t const block, std::size_t const count, input_span_type const input, std::span <char> output_buffer) const;
 	};
 	
 	
+	memory_mapping &memory_mapping::operator=(memory_mapping &&other)
+	{
+		if (this != &other)
+		{
+			unmap();
+			m_data = other.m_data;
+			m_size = other.m_size;
+			other.m_data = nullptr;
+			other.m_size = 0;
+		}
+		return *this;
+	}
+	
+	
 	std::size_t bgzip_reader::find_uncompressed_offset_lb(std::size_t const offset) const
 	{
 		auto const it(std::upper_bound(m_index_entries.begin(), m_index_entries.end(), offset, bgzip_index_entry_uncompressed_offset_cmp()));
@@ -169,10 +255,6 @@ namespace founder_graphs {
 		libbio_always_assert_lt(count + m_current_block, m_index_entries.size());
 		return m_index_entries[count + m_current_block].uncompressed_offset - current_block_uncompressed_offset();
 	}
-	
-	
-	// For checking that MSAs have matching indices.
-	void check_matching_bgzip_index_entries(std::vector <bgzip_reader> const &readers);
 }
 
 #endif
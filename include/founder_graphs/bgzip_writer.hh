@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#ifndef FOUNDER_GRAPHS_BGZIP_WRITER_HH
+#define FOUNDER_GRAPHS_BGZIP_WRITER_HH
+
+#include <cstddef>
+#include <founder_graphs/bgzip_reader.hh>
+#include <ostream>
+#include <span>
+
+
+namespace founder_graphs {
+	
+	// Max. size of a BGZF block, see Section 4.1. The BGZF compression format in https://samtools.github.io/hts-specs/SAMv1.pdf
+	constexpr static inline std::size_t const BGZF_BLOCK_MAX_SIZE{65536};
+	
+	// Max. amount of uncompressed data per block. As in bgzip, leaves room for the header, the footer
+	// and the overhead of deflating incompressible data.
+	constexpr static inline std::size_t const BGZF_BLOCK_UNCOMPRESSED_MAX_SIZE{65280};
+	
+	
+	// Compress the input to one BGZF block. The output buffer needs to have room for BGZF_BLOCK_MAX_SIZE bytes.
+	// Returns the size of the block. May be called from multiple threads.
+	std::size_t compress_bgzf_block(std::span <char const> const input, std::span <char> const output, int const compression_level);
+	
+	// Write the empty block that marks the end of a BGZF file.
+	void write_bgzf_eof_marker(std::ostream &os);
+	
+	// Write a .gzi index. The entries should contain the offsets of the written blocks in order, starting from (0, 0),
+	// which is not stored. The EOF marker should not be included.
+	void write_bgzip_index(std::ostream &os, index_entry_vector const &entries);
+}
+
+#endif
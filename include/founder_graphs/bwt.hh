@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#ifndef FOUNDER_GRAPHS_BWT_HH
+#define FOUNDER_GRAPHS_BWT_HH
+
+#include <sdsl/int_vector.hpp>
+
+
+namespace founder_graphs {
+	
+	// Build the BWT of a zero-terminated text from its suffix array such that
+	// the suffix array is split into partition_count parts that are handled
+	// concurrently. The result is the same as the one stored by SDSL to its cache.
+	void construct_bwt_parallel(
+		sdsl::int_vector <8> const &text,
+		sdsl::int_vector <0> const &sa,
+		sdsl::int_vector <8> &bwt,
+		std::size_t const partition_count
+	);
+}
+
+#endif
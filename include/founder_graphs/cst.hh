@@ -6,13 +6,25 @@
 #ifndef FOUNDER_GRAPHS_CST_HH
 #define FOUNDER_GRAPHS_CST_HH
 
+#include <cereal/cereal.hpp>
+#include <cstdint>
 #include <limits>
+#include <sdsl/cst_sada.hpp>
 #include <sdsl/cst_sct3.hpp>
+#include <sdsl/lcp_byte.hpp>
+#include <sdsl/wt_blcd.hpp>
+#include <stdexcept>
+#include <variant>
 
 
 namespace founder_graphs {
 	
-	typedef sdsl::csa_wt <>	csa_type;
+	// CSTs saved by earlier versions do not have a header and are of type cst_type.
+	constexpr static inline std::uint64_t const CST_MAGIC{0x5244'4854'5343'4746}; // “FGCSTHDR” in little-endian byte order.
+	constexpr static inline std::uint64_t const CST_FORMAT_VERSION{1};
+	
+	
+	typedef sdsl::csa_wt <>	csa_type; // Huffman-shaped wavelet tree.
 	
 	typedef sdsl::cst_sct3 <
 		csa_type,
@@ -25,6 +37,103 @@ namespace founder_graphs {
 	
 	typedef decltype(std::declval <cst_type::node_type>().i) cst_interval_endpoint_type;
 	constexpr inline auto CST_INTERVAL_ENDPOINT_MAX{std::numeric_limits <cst_interval_endpoint_type>::max()};
+	
+	
+	// Alternative CST configurations. The LCP values are stored either with directly addressable codes or
+	// with one byte per value and the large values separately; the wavelet tree of the CSA is either
+	// Huffman-shaped or balanced. cst_sada stores the balanced parentheses of all the nodes, which takes
+	// more space than the representation of cst_sct3 but makes some of the tree operations simpler.
+	typedef sdsl::csa_wt <sdsl::wt_blcd <>>	balanced_csa_type;
+	
+	typedef sdsl::cst_sct3 <
+		csa_type,
+		sdsl::lcp_byte <>,
+		sdsl::bp_support_sada <>,
+		sdsl::bit_vector,
+		sdsl::rank_support_v5 <>,
+		sdsl::select_support_mcl <>
+	> cst_sct3_lcp_byte_type;
+	
+	typedef sdsl::cst_sct3 <
+		balanced_csa_type,
+		sdsl::lcp_dac <>,
+		sdsl::bp_support_sada <>,
+		sdsl::bit_vector,
+		sdsl::rank_support_v5 <>,
+		sdsl::select_support_mcl <>
+	> cst_sct3_balanced_wt_type;
+	
+	typedef sdsl::cst_sada <csa_type, sdsl::lcp_dac <>> cst_sada_type;
+	
+	
+	// CST types in the order of the variant in cst_variant.
+	enum class cst_flavour : std::uint8_t
+	{
+		sct3 = 0,
+		sct3_lcp_byte,
+		sct3_balanced_wt,
+		sada
+	};
+	
+	constexpr static inline std::size_t const CST_FLAVOUR_COUNT{4};
+	
+	typedef std::variant <cst_type, cst_sct3_lcp_byte_type, cst_sct3_balanced_wt_type, cst_sada_type>	cst_variant;
+	
+	
+	inline char const *cst_flavour_name(cst_flavour const flavour)
+	{
+		switch (flavour)
+		{
+			case cst_flavour::sct3:				return "sct3";
+			case cst_flavour::sct3_lcp_byte:	return "sct3_lcp_byte";
+			case cst_flavour::sct3_balanced_wt:	return "sct3_balanced_wt";
+			case cst_flavour::sada:				return "sada";
+		}
+		
+		return "unknown";
+	}
+	
+	
+	// Replace the contents of cst with an empty CST of the given flavour.
+	inline void emplace_cst(cst_variant &cst, cst_flavour const flavour)
+	{
+		switch (flavour)
+		{
+			case cst_flavour::sct3:
+				cst.emplace <cst_type>();
+				return;
+			
+			case cst_flavour::sct3_lcp_byte:
+				cst.emplace <cst_sct3_lcp_byte_type>();
+				return;
+			
+			case cst_flavour::sct3_balanced_wt:
+				cst.emplace <cst_sct3_balanced_wt_type>();
+				return;
+			
+			case cst_flavour::sada:
+				cst.emplace <cst_sada_type>();
+				return;
+		}
+		
+		throw std::runtime_error("Unexpected CST flavour");
+	}
+	
+	
+	// Write the header that records the flavour, followed by the CST.
+	template <typename t_archive>
+	void save_cst(t_archive &archive, cst_variant const &cst)
+	{
+		std::uint8_t const flavour_(cst.index());
+		archive(CST_MAGIC);
+		archive(CST_FORMAT_VERSION);
+		archive(CEREAL_NVP(flavour_));
+		std::visit([&archive](auto const &cst_){ archive(cst_); }, cst);
+	}
+	
+	
+	// Read a CST saved with save_cst() or one of type cst_type saved without a header.
+	void read_cst(char const *path, cst_variant &cst);
 }
 
 #endif
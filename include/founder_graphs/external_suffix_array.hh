@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#ifndef FOUNDER_GRAPHS_EXTERNAL_SUFFIX_ARRAY_HH
+#define FOUNDER_GRAPHS_EXTERNAL_SUFFIX_ARRAY_HH
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string>
+
+
+namespace founder_graphs {
+	
+	struct external_suffix_array_block_sorter
+	{
+		virtual ~external_suffix_array_block_sorter() {}
+		
+		// Sort the suffixes of the given string s.t. a suffix that is a prefix of
+		// another one is the smaller one, as e.g. divsufsort does. Called for
+		// strings of at most INT32_MAX characters.
+		virtual void sort_block(std::span <std::uint8_t> const block, std::span <std::int32_t> const sa) = 0;
+	};
+	
+	
+	// Builds the suffix array of the text followed by a zero character in blocks
+	// s.t. only the current block needs to be sorted in memory. The blocks are
+	// handled from right to left. The suffixes of each block are sorted with a
+	// modified alphabet that encodes the order of the suffixes w.r.t. the first
+	// suffix of the preceding block, after which they are merged with the suffix
+	// array of the preceding blocks that is stored in a temporary file. The merge
+	// positions are determined with backward search over the BWT of the block.
+	// The method is similar to the one in Kärkkäinen, Kempa: Engineering a
+	// lightweight external memory suffix array construction algorithm (2014).
+	// The text is typically memory-mapped and is read sequentially except for
+	// the current block.
+	class external_suffix_array_builder
+	{
+	public:
+		typedef std::array <std::uint8_t, 256>	rank_array;
+		
+	protected:
+		std::span <char const>					m_text;				// Without the zero character.
+		std::string								m_temporary_directory;
+		external_suffix_array_block_sorter		*m_sorter{};
+		rank_array								m_ranks{};			// Character ranks, zero for the terminator.
+		std::size_t								m_alphabet_size{};	// Including the terminator.
+		
+	public:
+		// Throws if the text contains a zero character or more than 84 distinct characters.
+		external_suffix_array_builder(
+			std::span <char const> const text,
+			std::string temporary_directory,
+			external_suffix_array_block_sorter &sorter
+		);
+		
+		std::size_t alphabet_size() const { return m_alphabet_size; }
+		
+		// Maximum block size s.t. the data structures for one block fit in the given number of bytes.
+		std::size_t block_size_for_memory_budget(std::size_t const memory_budget) const;
+		
+		// Write the suffix array to the stream in the format of sdsl::int_vector <0>.
+		void build(std::size_t const block_size, std::ostream &os);
+	};
+}
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#ifndef FOUNDER_GRAPHS_FASTA_MSA_HH
+#define FOUNDER_GRAPHS_FASTA_MSA_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <founder_graphs/bgzip_reader.hh>
+#include <libbio/assert.hh>
+#include <libbio/file_handle.hh>
+#include <string>
+#include <vector>
+
+
+namespace founder_graphs {
+	
+	constexpr static inline std::size_t const FASTA_MSA_BLOCK_SIZE_DEFAULT{65536};
+	
+	
+	// Memory-mapped MSA stored as one uncompressed FASTA file with all the rows of equal length.
+	// The rows are located with a samtools faidx compatible index, i.e. one line per row with the
+	// name, length, offset, line bases and line width separated by tabs.
+	class fasta_msa
+	{
+	public:
+		struct row_entry
+		{
+			std::string	name;
+			std::size_t	length{};
+			std::size_t	offset{};		// Byte offset of the first character.
+			std::size_t	line_bases{};	// Characters per line.
+			std::size_t	line_width{};	// Bytes per line including the newline.
+			
+			std::size_t byte_offset(std::size_t const pos) const { return offset + (pos / line_bases) * line_width + pos % line_bases; }
+		};
+		
+		typedef std::vector <row_entry>	row_entry_vector;
+		
+	protected:
+		libbio::file_handle	m_handle;
+		memory_mapping		m_mapping;
+		row_entry_vector	m_rows;
+		std::size_t			m_aligned_size{};
+		
+	public:
+		// Open the given file and the index in path + ".fai".
+		void open(std::string const &path);
+		void open(std::string const &path, std::string const &index_path);
+		
+		row_entry_vector const &rows() const { return m_rows; }
+		std::size_t row_count() const { return m_rows.size(); }
+		std::size_t aligned_size() const { return m_aligned_size; }
+		
+		// Advise the kernel about the order in which the columns will be read.
+		void advise_access_pattern(bgzip_access_pattern const pattern) const;
+		// Advise the kernel that the columns [lb, rb) of every row will be read soon.
+		void advise_will_need(std::size_t const lb, std::size_t const rb) const;
+		
+		// Copy the characters [lb, rb) of the given row to dst.
+		inline void copy(std::size_t const row, std::size_t const lb, std::size_t const rb, char *dst) const;
+		
+	protected:
+		void read_index(std::string const &index_path);
+	};
+	
+	
+	void fasta_msa::copy(std::size_t const row, std::size_t const lb, std::size_t const rb, char *dst) const
+	{
+		libbio_assert_lt(row, m_rows.size());
+		libbio_assert_lte(lb, rb);
+		libbio_assert_lte(rb, m_aligned_size);
+		
+		// Copy one line at a time.
+		auto const &entry(m_rows[row]);
+		auto pos(lb);
+		while (pos < rb)
+		{
+			auto const count(std::min(rb - pos, entry.line_bases - pos % entry.line_bases));
+			dst = std::copy_n(m_mapping.data() + entry.byte_offset(pos), count, dst);
+			pos += count;
+		}
+	}
+}
+
+#endif
@@ -7,6 +7,7 @@
 #define FOUNDER_GRAPHS_FOUNDER_GRAPH_INDICES_BLOCK_GRAPH_HH
 
 #include <founder_graphs/founder_graph_indices/basic_types.hh>
+#include <founder_graphs/msa_reader.hh>
 #include <map>
 #include <set>
 #include <string>
@@ -52,10 +53,16 @@ namespace founder_graphs::founder_graph_indices {
 	
 	
 	// Postcondition: gr reflects the contents of the other parameters.
+	// read_ahead_block_count is the number of bgzip blocks per sequence read in advance.
+	// If block_cache_size is non-zero, bgzipped input is read with bgzip_random_access_msa_reader
+	// using a block cache of the given size in bytes.
 	void read_optimized_segmentation(
 		char const *sequence_list_path,
 		char const *segmentation_path,
-		bool const input_is_bgzipped,
+		msa_format const input_format,
+		std::size_t const read_ahead_block_count,
+		std::size_t const block_cache_size,
+		bgzip_access_mode const access_mode,
 		block_graph &gr
 	);
 	
@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#ifndef FOUNDER_GRAPHS_GAP_FREE_TEXT_HH
+#define FOUNDER_GRAPHS_GAP_FREE_TEXT_HH
+
+#include <sdsl/int_vector.hpp>
+
+
+namespace founder_graphs {
+	
+	// Read the sequences listed in the given file concurrently and store them to text with the gaps
+	// removed and each sequence preceded by “#”, i.e. in the format output by prepare_msa. The text
+	// is not zero-terminated. Returns the number of sequences.
+	std::size_t read_gap_free_text(
+		char const *sequence_list_path,
+		bool const input_is_gzipped,
+		std::size_t const buffer_count,
+		sdsl::int_vector <8> &text
+	);
+}
+
+#endif
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#ifndef FOUNDER_GRAPHS_LCP_HH
+#define FOUNDER_GRAPHS_LCP_HH
+
+#include <sdsl/config.hpp>
+#include <sdsl/int_vector.hpp>
+
+
+namespace founder_graphs {
+	
+	// Build the LCP array of a zero-terminated text with the Φ algorithm such that
+	// the text positions and the suffix array are split into partition_count
+	// parts that are handled concurrently. The result is bit-compressed like the
+	// one built by SDSL, i.e. lcp[0] = 0 and lcp[i] is the length of the longest
+	// common prefix of the suffixes at sa[i - 1] and sa[i]. Throws std::runtime_error if
+	// the text contains a zero character before the terminator.
+	void construct_lcp_parallel(
+		sdsl::int_vector <8> const &text,
+		sdsl::int_vector <0> const &sa,
+		sdsl::int_vector <0> &lcp,
+		std::size_t const partition_count
+	);
+	
+	// Load the text and the suffix array from SDSL’s cache and store the LCP array there.
+	void construct_lcp_parallel(sdsl::cache_config &config, std::size_t const partition_count);
+}
+
+#endif
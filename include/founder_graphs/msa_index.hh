@@ -1,27 +1,63 @@
 /*
- * Copyright (c) 2021 Tuukka Norri
+ * Copyright (c) 2021-2022 Tuukka Norri
  * This code is licensed under MIT license (see LICENSE for details).
  */
 
 #ifndef FOUNDER_GRAPHS_MSA_INDEX_HH
 #define FOUNDER_GRAPHS_MSA_INDEX_HH
 
+#include <cstdint>
 #include <istream>
 #include <ostream>
 #include <sdsl/bit_vectors.hpp>
 #include <sdsl/rank_support_v5.hpp>
 #include <sdsl/select_support_mcl.hpp>
 #include <sdsl/rrr_vector.hpp>
+#include <sdsl/sd_vector.hpp>
+#include <span>
+#include <stdexcept>
+#include <variant>
 #include <vector>
 
 
 namespace founder_graphs {
 	
-	struct aligned_sequence_index
+	// Indices built with earlier versions do not have a header and use rrr_gap_vector for all the sequences.
+	constexpr static inline std::uint64_t const MSA_INDEX_MAGIC{0x5844'4941'534D'4746}; // “FGMSAIDX” in little-endian byte order.
+	constexpr static inline std::uint64_t const MSA_INDEX_FORMAT_VERSION{1};
+	
+	
+	// Representations of the gap positions of an aligned sequence, in the order of the variant in aligned_sequence_index.
+	enum class gap_vector_type : std::uint8_t
+	{
+		rrr = 0,
+		sd,
+		run_length
+	};
+	
+	
+	inline char const *gap_vector_type_name(gap_vector_type const type)
+	{
+		switch (type)
+		{
+			case gap_vector_type::rrr:			return "rrr";
+			case gap_vector_type::sd:			return "sd";
+			case gap_vector_type::run_length:	return "run-length";
+		}
+		
+		return "unknown";
+	}
+	
+	
+	// The gap vector types have the following interface:
+	//	size() – length of the aligned sequence,
+	//	rank0(pos) – number of non-gap characters in [0, pos),
+	//	select0(k) – position of the k-th non-gap character (1-based),
+	//	size_in_bytes(), prepare_rank_and_select_support() (needs to be called after copying or moving).
+	
+	// Suitable for gaps of moderate density.
+	struct rrr_gap_vector
 	{
-		//typedef sdsl::bit_vector				bit_vector_type;
-		//typedef sdsl::rank_support_v5 <0>		rank0_support_type;
-		//typedef sdsl::select_support_mcl <0>	select0_support_type;
 		typedef sdsl::rrr_vector <>				bit_vector_type;
 		typedef bit_vector_type::rank_0_type	rank0_support_type;
 		typedef bit_vector_type::select_0_type	select0_support_type;
@@ -30,23 +66,54 @@ namespace founder_graphs {
 		rank0_support_type		rank0_support;
 		select0_support_type	select0_support;
 		
-		aligned_sequence_index() = default;
+		rrr_gap_vector() = default;
 		
-#if 0
-		explicit aligned_sequence_index(std::size_t const size):
-			gap_positions(size)
+		explicit rrr_gap_vector(sdsl::bit_vector const &vec):
+			gap_positions(vec)
 		{
 		}
-#endif
-
-		explicit aligned_sequence_index(sdsl::bit_vector const &vec):
+		
+		std::size_t size() const { return gap_positions.size(); }
+		std::size_t rank0(std::size_t const pos) const { return rank0_support(pos); }
+		std::size_t select0(std::size_t const k) const { return select0_support(k); }
+		std::size_t size_in_bytes() const { return sdsl::size_in_bytes(gap_positions) + sdsl::size_in_bytes(rank0_support) + sdsl::size_in_bytes(select0_support); }
+		inline void prepare_rank_and_select_support();
+		
+		inline bool operator==(rrr_gap_vector const &other) const;
+		
+		template <typename t_archive>
+		void CEREAL_SAVE_FUNCTION_NAME(t_archive &archive) const;
+		
+		template <typename t_archive>
+		void CEREAL_LOAD_FUNCTION_NAME(t_archive &archive);
+	};
+	
+	
+	// Suitable for sequences with few gaps.
+	struct sd_gap_vector
+	{
+		typedef sdsl::sd_vector <>				bit_vector_type;
+		typedef bit_vector_type::rank_0_type	rank0_support_type;
+		typedef bit_vector_type::select_0_type	select0_support_type;
+		
+		bit_vector_type			gap_positions;
+		rank0_support_type		rank0_support;
+		select0_support_type	select0_support;
+		
+		sd_gap_vector() = default;
+		
+		explicit sd_gap_vector(sdsl::bit_vector const &vec):
 			gap_positions(vec)
 		{
 		}
 		
+		std::size_t size() const { return gap_positions.size(); }
+		std::size_t rank0(std::size_t const pos) const { return rank0_support(pos); }
+		std::size_t select0(std::size_t const k) const { return select0_support(k); }
+		std::size_t size_in_bytes() const { return sdsl::size_in_bytes(gap_positions) + sdsl::size_in_bytes(rank0_support) + sdsl::size_in_bytes(select0_support); }
 		inline void prepare_rank_and_select_support();
 		
-		inline bool operator==(aligned_sequence_index const &other) const;
+		bool operator==(sd_gap_vector const &other) const { return gap_positions == other.gap_positions; }
 		
 		template <typename t_archive>
 		void CEREAL_SAVE_FUNCTION_NAME(t_archive &archive) const;
@@ -56,13 +123,121 @@ namespace founder_graphs {
 	};
 	
 	
+	// Suitable for sequences in which the gaps occur in long runs. Stores the starting positions of the runs
+	// and the numbers of non-gap characters that precede each run; the number of gap characters before
+	// run t is then run_start(t) - run_offset(t).
+	struct run_length_gap_vector
+	{
+		typedef sdsl::sd_vector <>				bit_vector_type;
+		typedef bit_vector_type::rank_1_type	rank1_support_type;
+		typedef bit_vector_type::select_1_type	select1_support_type;
+		
+		bit_vector_type			run_starts;
+		bit_vector_type			run_offsets;
+		rank1_support_type		run_starts_rank1_support;
+		select1_support_type	run_starts_select1_support;
+		rank1_support_type		run_offsets_rank1_support;
+		select1_support_type	run_offsets_select1_support;
+		std::size_t				run_count{};
+		std::size_t				gap_count{};
+		
+		run_length_gap_vector() = default;
+		explicit run_length_gap_vector(sdsl::bit_vector const &vec);
+		
+		std::size_t size() const { return run_starts.size(); }
+		inline std::size_t rank0(std::size_t const pos) const;
+		inline std::size_t select0(std::size_t const k) const;
+		std::size_t size_in_bytes() const;
+		inline void prepare_rank_and_select_support();
+		
+		inline bool operator==(run_length_gap_vector const &other) const;
+		
+		template <typename t_archive>
+		void CEREAL_SAVE_FUNCTION_NAME(t_archive &archive) const;
+		
+		template <typename t_archive>
+		void CEREAL_LOAD_FUNCTION_NAME(t_archive &archive);
+		
+	protected:
+		// Number of gap characters before the given run (1-based).
+		std::size_t gaps_before_run(std::size_t const run) const { return (run <= run_count ? run_starts_select1_support(run) - run_offsets_select1_support(run) : gap_count); }
+	};
+	
+	
+	// The support structures of the gap vectors store pointers to the bit vectors. To make sure that they
+	// do not keep pointing into the source object, they are prepared again when the index is copied or moved.
+	struct aligned_sequence_index
+	{
+		typedef std::variant <rrr_gap_vector, sd_gap_vector, run_length_gap_vector>	gap_vector_variant;
+		
+		gap_vector_variant	gap_vector;
+		
+		aligned_sequence_index() = default;
+		
+		aligned_sequence_index(aligned_sequence_index const &other):
+			gap_vector(other.gap_vector)
+		{
+			prepare_rank_and_select_support();
+		}
+		
+		aligned_sequence_index(aligned_sequence_index &&other):
+			gap_vector(std::move(other.gap_vector))
+		{
+			prepare_rank_and_select_support();
+		}
+		
+		aligned_sequence_index &operator=(aligned_sequence_index const &other)
+		{
+			gap_vector = other.gap_vector;
+			prepare_rank_and_select_support();
+			return *this;
+		}
+		
+		aligned_sequence_index &operator=(aligned_sequence_index &&other)
+		{
+			gap_vector = std::move(other.gap_vector);
+			prepare_rank_and_select_support();
+			return *this;
+		}
+		
+		// Choose the representation whose select0 is expected to be the fastest among those the size of which
+		// is at most (1 + size_slack) times that of the smallest one.
+		explicit aligned_sequence_index(sdsl::bit_vector const &vec, double const size_slack = 0.0);
+		
+		aligned_sequence_index(sdsl::bit_vector const &vec, gap_vector_type const type);
+		
+		gap_vector_type type() const { return gap_vector_type(gap_vector.index()); }
+		std::size_t size() const { return std::visit([](auto const &gv){ return gv.size(); }, gap_vector); }
+		std::size_t rank0(std::size_t const pos) const { return std::visit([pos](auto const &gv){ return gv.rank0(pos); }, gap_vector); }
+		std::size_t select0(std::size_t const k) const { return std::visit([k](auto const &gv){ return gv.select0(k); }, gap_vector); }
+		bool is_gap(std::size_t const pos) const { return rank0(1 + pos) == rank0(pos); }
+		std::size_t size_in_bytes() const { return std::visit([](auto const &gv){ return gv.size_in_bytes(); }, gap_vector); }
+		void prepare_rank_and_select_support() { std::visit([](auto &gv){ gv.prepare_rank_and_select_support(); }, gap_vector); }
+		
+		bool operator==(aligned_sequence_index const &other) const { return gap_vector == other.gap_vector; }
+		
+		template <typename t_archive>
+		void CEREAL_SAVE_FUNCTION_NAME(t_archive &archive) const;
+		
+		template <typename t_archive>
+		void CEREAL_LOAD_FUNCTION_NAME(t_archive &archive);
+		
+		// Load an index saved before MSA_INDEX_FORMAT_VERSION 1.
+		template <typename t_archive>
+		void load_unversioned(t_archive &archive);
+	};
+	
+	
 	struct msa_index
 	{
 		typedef std::vector <aligned_sequence_index>	index_vector;
 		
 		index_vector	sequence_indices;
 		
-		// Saving is done in build_msa_index.
+		// Saving is done in build_msa_index, which outputs the header followed by count aligned_sequence_indices.
+		template <typename t_archive>
+		static void save_header(t_archive &archive, std::size_t const count);
+		
 		template <typename t_archive>
 		void CEREAL_LOAD_FUNCTION_NAME(t_archive &archive);
 		
@@ -70,21 +245,27 @@ namespace founder_graphs {
 	};
 	
 	
-	void aligned_sequence_index::prepare_rank_and_select_support()
+	// Set the bits that correspond to the gap characters in text, starting from bit pos of words.
+	// Words that text covers only partially are updated atomically, so adjacent ranges may be
+	// handled concurrently. Returns the number of gap characters.
+	std::size_t mark_gaps(std::span <char const> const text, std::uint64_t *words, std::size_t pos);
+	
+	
+	void rrr_gap_vector::prepare_rank_and_select_support()
 	{
 		rank0_support = rank0_support_type(&gap_positions);
 		select0_support = select0_support_type(&gap_positions);
 	}
 	
 	
-	bool aligned_sequence_index::operator==(aligned_sequence_index const &other) const
+	bool rrr_gap_vector::operator==(rrr_gap_vector const &other) const
 	{
 		return gap_positions == other.gap_positions && rank0_support == other.rank0_support && select0_support == other.select0_support;
 	}
 	
 	
 	template <typename t_archive>
-	void aligned_sequence_index::CEREAL_SAVE_FUNCTION_NAME(t_archive &archive) const
+	void rrr_gap_vector::CEREAL_SAVE_FUNCTION_NAME(t_archive &archive) const
 	{
 		archive(CEREAL_NVP(gap_positions));
 		archive(CEREAL_NVP(rank0_support));
@@ -93,7 +274,34 @@ namespace founder_graphs {
 	
 	
 	template <typename t_archive>
-	void aligned_sequence_index::CEREAL_LOAD_FUNCTION_NAME(t_archive &archive)
+	void rrr_gap_vector::CEREAL_LOAD_FUNCTION_NAME(t_archive &archive)
+	{
+		archive(CEREAL_NVP(gap_positions));
+		archive(CEREAL_NVP(rank0_support));
+		archive(CEREAL_NVP(select0_support));
+		rank0_support.set_vector(&gap_positions);
+		select0_support.set_vector(&gap_positions);
+	}
+	
+	
+	void sd_gap_vector::prepare_rank_and_select_support()
+	{
+		rank0_support = rank0_support_type(&gap_positions);
+		select0_support = select0_support_type(&gap_positions);
+	}
+	
+	
+	template <typename t_archive>
+	void sd_gap_vector::CEREAL_SAVE_FUNCTION_NAME(t_archive &archive) const
+	{
+		archive(CEREAL_NVP(gap_positions));
+		archive(CEREAL_NVP(rank0_support));
+		archive(CEREAL_NVP(select0_support));
+	}
+	
+	
+	template <typename t_archive>
+	void sd_gap_vector::CEREAL_LOAD_FUNCTION_NAME(t_archive &archive)
 	{
 		archive(CEREAL_NVP(gap_positions));
 		archive(CEREAL_NVP(rank0_support));
@@ -103,15 +311,144 @@ namespace founder_graphs {
 	}
 	
 	
+	std::size_t run_length_gap_vector::rank0(std::size_t const pos) const
+	{
+		// Find the last run that starts before pos.
+		auto const run(run_starts_rank1_support(pos));
+		if (0 == run)
+			return pos;
+		
+		auto const run_start(run_starts_select1_support(run));
+		auto const gaps_before(run_start - run_offsets_select1_support(run));
+		auto const run_length(gaps_before_run(1 + run) - gaps_before);
+		return pos - gaps_before - std::min(run_length, pos - run_start);
+	}
+	
+	
+	std::size_t run_length_gap_vector::select0(std::size_t const k) const
+	{
+		// The runs preceded by less than k non-gap characters precede the k-th non-gap character.
+		auto const run_count_before(run_offsets_rank1_support(k));
+		return k - 1 + gaps_before_run(1 + run_count_before);
+	}
+	
+	
+	void run_length_gap_vector::prepare_rank_and_select_support()
+	{
+		run_starts_rank1_support = rank1_support_type(&run_starts);
+		run_starts_select1_support = select1_support_type(&run_starts);
+		run_offsets_rank1_support = rank1_support_type(&run_offsets);
+		run_offsets_select1_support = select1_support_type(&run_offsets);
+	}
+	
+	
+	bool run_length_gap_vector::operator==(run_length_gap_vector const &other) const
+	{
+		return run_starts == other.run_starts && run_offsets == other.run_offsets && run_count == other.run_count && gap_count == other.gap_count;
+	}
+	
+	
+	template <typename t_archive>
+	void run_length_gap_vector::CEREAL_SAVE_FUNCTION_NAME(t_archive &archive) const
+	{
+		archive(CEREAL_NVP(run_starts));
+		archive(CEREAL_NVP(run_offsets));
+		archive(CEREAL_NVP(run_count));
+		archive(CEREAL_NVP(gap_count));
+	}
+	
+	
+	template <typename t_archive>
+	void run_length_gap_vector::CEREAL_LOAD_FUNCTION_NAME(t_archive &archive)
+	{
+		archive(CEREAL_NVP(run_starts));
+		archive(CEREAL_NVP(run_offsets));
+		archive(CEREAL_NVP(run_count));
+		archive(CEREAL_NVP(gap_count));
+		prepare_rank_and_select_support(); // The support structures of sd_vector only store a pointer to the vector.
+	}
+	
+	
+	template <typename t_archive>
+	void aligned_sequence_index::CEREAL_SAVE_FUNCTION_NAME(t_archive &archive) const
+	{
+		std::uint8_t const type_(gap_vector.index());
+		archive(CEREAL_NVP(type_));
+		std::visit([&archive](auto const &gv){ archive(gv); }, gap_vector);
+	}
+	
+	
+	template <typename t_archive>
+	void aligned_sequence_index::CEREAL_LOAD_FUNCTION_NAME(t_archive &archive)
+	{
+		std::uint8_t type_{};
+		archive(CEREAL_NVP(type_));
+		switch (gap_vector_type(type_))
+		{
+			case gap_vector_type::rrr:
+				archive(gap_vector.emplace <rrr_gap_vector>());
+				break;
+			
+			case gap_vector_type::sd:
+				archive(gap_vector.emplace <sd_gap_vector>());
+				break;
+			
+			case gap_vector_type::run_length:
+				archive(gap_vector.emplace <run_length_gap_vector>());
+				break;
+			
+			default:
+				throw std::runtime_error("Unexpected gap vector type");
+		}
+	}
+	
+	
+	template <typename t_archive>
+	void aligned_sequence_index::load_unversioned(t_archive &archive)
+	{
+		archive(gap_vector.emplace <rrr_gap_vector>());
+	}
+	
+	
+	template <typename t_archive>
+	void msa_index::save_header(t_archive &archive, std::size_t const count)
+	{
+		archive(MSA_INDEX_MAGIC);
+		archive(MSA_INDEX_FORMAT_VERSION);
+		archive(cereal::make_size_tag(count));
+	}
+	
+	
 	template <typename t_archive>
 	void msa_index::CEREAL_LOAD_FUNCTION_NAME(t_archive &archive)
 	{
+		// Unversioned indices begin with the sequence count, which is stored in the same way as MSA_INDEX_MAGIC.
+		std::uint64_t header{};
+		archive(header);
+		
+		std::uint64_t version{};
 		std::size_t size{};
-		archive(cereal::make_size_tag(size));
+		if (MSA_INDEX_MAGIC == header)
+		{
+			archive(version);
+			archive(cereal::make_size_tag(size));
+		}
+		else
+		{
+			size = header;
+		}
+		
+		if (MSA_INDEX_FORMAT_VERSION < version)
+			throw std::runtime_error("Unsupported MSA index format version");
 		
 		sequence_indices.resize(size);
 		for (auto &seq_idx : sequence_indices)
-			archive(seq_idx);
+		{
+			if (0 == version)
+				seq_idx.load_unversioned(archive);
+			else
+				archive(seq_idx);
+		}
 	}
 }
 
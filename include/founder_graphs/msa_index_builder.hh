@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#ifndef FOUNDER_GRAPHS_MSA_INDEX_BUILDER_HH
+#define FOUNDER_GRAPHS_MSA_INDEX_BUILDER_HH
+
+#include <atomic>
+#include <founder_graphs/bgzip_reader.hh>
+#include <founder_graphs/msa_index.hh>
+#include <libbio/dispatch.hh>
+#include <libbio/file_handle.hh>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+namespace founder_graphs {
+	
+	// Number of characters handled in one task.
+	constexpr static inline std::size_t const MSA_INDEX_BUILDER_CHUNK_SIZE{16 * 1024 * 1024};
+	
+	
+	struct msa_index_sequence
+	{
+		std::string							path;
+		libbio::file_handle					handle;				// Uncompressed input.
+		std::optional <bgzip_reader>		bgzip_input;		// Bgzipped input with an index.
+		sdsl::bit_vector					gaps;				// Filled if the builder builds the index.
+		aligned_sequence_index				index;				// Ditto.
+		std::vector <std::vector <char>>	gap_free_chunks;	// Filled if the builder removes the gaps.
+		std::atomic_size_t					remaining_chunks{};
+		std::atomic_size_t					gap_count{};
+		std::size_t							size{};
+		bool								is_done{};			// Only accessed from the serial queue.
+	};
+	
+	
+	struct msa_index_builder_delegate
+	{
+		virtual ~msa_index_builder_delegate() {}
+		
+		// Called in a serial queue in the order in which the sequences were submitted.
+		virtual void output_sequence(msa_index_sequence const &seq) = 0;
+	};
+	
+	
+	// Handles the sequences in a concurrent queue. The sequences are stored in a ring buffer, the size
+	// of which limits the number of sequences in flight. The gaps of each sequence are located in
+	// chunks that may also be processed concurrently. The sequences are passed to the delegate in a
+	// serial queue in the order of submission, after which the slot may be reused.
+	class msa_index_builder
+	{
+	protected:
+		msa_index_builder_delegate					*m_delegate{};
+		std::vector <msa_index_sequence>			m_sequences;
+		libbio::dispatch_ptr <dispatch_queue_t>		m_concurrent_queue;
+		libbio::dispatch_ptr <dispatch_queue_t>		m_serial_queue;
+		libbio::dispatch_ptr <dispatch_group_t>		m_group;
+		libbio::dispatch_ptr <dispatch_semaphore_t>	m_sema;					// Limit the number of sequences in use.
+		std::size_t									m_submitted_count{};
+		std::size_t									m_output_count{};		// Only accessed from m_serial_queue.
+		std::size_t									m_sequence_size{SIZE_MAX};	// Only accessed from m_serial_queue.
+		double										m_size_slack{};
+		bool										m_input_is_gzipped{};
+		bool										m_should_remove_gaps{};
+		bool										m_should_build_index{};
+		
+	public:
+		msa_index_builder(
+			msa_index_builder_delegate &delegate,
+			std::size_t const buffer_count,
+			double const size_slack,
+			bool const input_is_gzipped,
+			bool const should_remove_gaps = false,
+			bool const should_build_index = true
+		);
+		
+		// Not thread-safe.
+		void submit(std::string const &path);
+		void finish();
+		
+	protected:
+		void submit_uncompressed(msa_index_sequence &seq);
+		void submit_bgzip(msa_index_sequence &seq);
+		void submit_gzip(msa_index_sequence &seq);
+		void set_chunk_count(msa_index_sequence &seq, std::size_t const count);
+		void handle_chunk(msa_index_sequence &seq, std::size_t const chunk_idx, std::size_t const pos, std::span <char const> const chunk);
+		void chunk_done(msa_index_sequence &seq);
+		void finish_sequence(msa_index_sequence &seq);
+		void output_done();
+	};
+}
+
+#endif
@@ -6,10 +6,15 @@
 #ifndef FOUNDER_GRAPHS_MSA_READER_HH
 #define FOUNDER_GRAPHS_MSA_READER_HH
 
+#include <founder_graphs/batched_file_reader.hh>
+#include <founder_graphs/bgzip_block_cache.hh>
 #include <founder_graphs/bgzip_reader.hh>
+#include <founder_graphs/fasta_msa.hh>
+#include <founder_graphs/packed_msa.hh>
 #include <functional>
 #include <libbio/dispatch/dispatch_ptr.hh>
 #include <libbio/file_handle.hh>
+#include <memory>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -17,6 +22,15 @@
 
 namespace founder_graphs {
 	
+	enum class msa_format
+	{
+		text,	// One file per sequence.
+		bgzip,	// One bgzipped file per sequence.
+		packed,	// Packed MSA, see packed_msa.hh.
+		fasta	// Indexed FASTA file with all the sequences, see fasta_msa.hh.
+	};
+	
+	
 	enum class range_overlap_type
 	{
 		INCLUDES,
@@ -26,7 +40,7 @@ namespace founder_graphs {
 	};
 	
 	
-	// FIXME: Consider merging with reverse_msa_reader, add random access. reverse_msa_reader handles one character at a time, though, while msa_reader allows to specify a range of characters.
+	// FIXME: Consider merging with reverse_msa_reader. (See bgzip_random_access_msa_reader for random access.) reverse_msa_reader handles one character at a time, though, while msa_reader allows to specify a range of characters.
 	class msa_reader
 	{
 	public:
@@ -59,11 +73,19 @@ namespace founder_graphs {
 	{
 	protected:
 		std::vector <libbio::file_handle>	m_handles;
+		batched_file_reader					m_batched_reader;
+		std::vector <read_request>			m_read_requests;
+		buffer_type							m_data;			// Row-major, used with io_uring.
 		std::size_t							m_preferred_block_size{}; // Hopefully the same for all handles.
 		std::size_t							m_aligned_size{};
 		std::size_t							m_file_position{};
+		bool								m_should_use_io_uring{};
 	
 	public:
+		// Read the rows of each range with one batch of io_uring requests if available. Should be called before prepare().
+		void set_uses_io_uring(bool const should_use) { m_should_use_io_uring = should_use; }
+		bool uses_io_uring() const { return m_batched_reader.uses_io_uring(); }
+		
 		void add_file(std::string const &path) override;
 		void prepare() override;
 		using msa_reader::fill_buffer;
@@ -71,9 +93,14 @@ namespace founder_graphs {
 		
 		std::size_t aligned_size() const override { return m_aligned_size; }
 		std::size_t handle_count() const override { return m_handles.size(); }
+		
+	protected:
+		bool fill_buffer_batched(std::size_t const lb, std::size_t const rb, fill_buffer_callback_type &cb);
 	};
 	
 	
+	// Reads the bgzipped sequences. If read-ahead is enabled, the blocks that follow the most recently
+	// requested range are read and decompressed in the background while the callback is being run.
 	class bgzip_msa_reader final : public msa_reader
 	{
 	protected:
@@ -85,12 +112,32 @@ namespace founder_graphs {
 
 		friend std::ostream &operator<<(std::ostream &, block_range const &);
 		
+		struct read_ahead_buffer
+		{
+			std::vector <char>						input_buffer;
+			buffer_type								buffer;		// Decompressed contents of [block_lb, block_rb).
+			std::size_t								block_lb{};
+			std::size_t								block_rb{};
+		};
+		
 	protected:
 		std::vector <bgzip_reader>				m_handles;
 		std::vector <block_range>				m_current_block_ranges;
+		std::vector <read_ahead_buffer>			m_read_ahead_buffers;
 		libbio::dispatch_ptr <dispatch_group_t>	m_decompress_group;
+		libbio::dispatch_ptr <dispatch_group_t>	m_read_ahead_group;
+		std::size_t								m_read_ahead_block_count{READ_AHEAD_BLOCK_COUNT_DEFAULT};
+		bgzip_access_mode						m_access_mode{bgzip_access_mode::pread};
 		
 	public:
+		~bgzip_msa_reader() override;
+		
+		// Should be called before add_file().
+		void set_access_mode(bgzip_access_mode const mode) { m_access_mode = mode; }
+		
+		// Maximum number of bgzip blocks per sequence read in advance. Zero disables read-ahead. Should be called before prepare().
+		void set_read_ahead_block_count(std::size_t const count) { m_read_ahead_block_count = count; }
+		
 		void add_file(std::string const &path) override;
 		void prepare() override;
 		using msa_reader::fill_buffer;
@@ -108,9 +155,103 @@ namespace founder_graphs {
 			std::size_t const block_lb,
 			std::size_t const block_rb
 		);
+		
+		void decompress_blocks(std::size_t const handle_idx, std::size_t const block_lb, std::size_t const block_rb, std::span <char> buffer);
+		void start_read_ahead();
+		void wait_for_read_ahead();
 	};
 
 
+	// Reads arbitrary regions of the bgzipped sequences. The decompressed blocks are stored in a cache that
+	// may be shared with other readers, so that reading overlapping regions does not require decompressing
+	// the same blocks again.
+	class bgzip_random_access_msa_reader final : public msa_reader
+	{
+	protected:
+		std::vector <bgzip_reader>				m_handles;
+		std::vector <std::size_t>				m_file_ids;		// Identifiers in m_cache.
+		std::shared_ptr <bgzip_block_cache>		m_cache;
+		buffer_type								m_data;			// Row-major, used with fill_buffer().
+		libbio::dispatch_ptr <dispatch_group_t>	m_prefetch_group;
+		std::size_t								m_prefetched_lb{};	// Range of the columns prefetched by fill_buffer() since the last seek.
+		std::size_t								m_prefetched_rb{};
+		bgzip_access_mode						m_access_mode{bgzip_access_mode::pread};
+		bool									m_should_prefetch_next_range{true};
+		
+	public:
+		~bgzip_random_access_msa_reader() override;
+		
+		// Should be called before add_file().
+		void set_access_mode(bgzip_access_mode const mode) { m_access_mode = mode; }
+		
+		// Should be called before prepare(). If not called, a cache of BGZIP_BLOCK_CACHE_SIZE_DEFAULT bytes is created.
+		void set_cache(std::shared_ptr <bgzip_block_cache> cache) { m_cache = std::move(cache); }
+		std::shared_ptr <bgzip_block_cache> const &cache() const { return m_cache; }
+		
+		// Decompress the range that follows the one passed to fill_buffer() in the background.
+		void set_prefetches_next_range(bool const should_prefetch) { m_should_prefetch_next_range = should_prefetch; }
+		
+		void add_file(std::string const &path) override;
+		void prepare() override;
+		using msa_reader::fill_buffer;
+		bool fill_buffer(std::size_t const lb, std::size_t const rb, fill_buffer_callback_type &) override;
+		
+		// Copy the columns [column_lb, column_rb) of the rows [row_lb, row_rb) to dst in row-major order.
+		// May be called from multiple threads.
+		void read(std::size_t const row_lb, std::size_t const row_rb, std::size_t const column_lb, std::size_t const column_rb, std::span <char> const dst);
+		
+		// Hint that the given region will be read soon. The blocks are decompressed in the background.
+		void prefetch(std::size_t const row_lb, std::size_t const row_rb, std::size_t const column_lb, std::size_t const column_rb);
+		
+		std::size_t aligned_size() const override { return (m_handles.empty() ? 0 : m_handles.front().uncompressed_size()); }
+		std::size_t handle_count() const override { return m_handles.size(); }
+		
+	protected:
+		bgzip_block_cache::block_ptr decompressed_block(std::size_t const row, std::size_t const block) const;
+		void copy_row(std::size_t const row, std::size_t const column_lb, std::size_t const column_rb, char *dst) const;
+	};
+	
+	
+	// Reads a packed MSA. add_file() should be called once with the path of the packed file.
+	class packed_msa_reader final : public msa_reader
+	{
+	protected:
+		packed_msa		m_msa;
+		buffer_type		m_data;			// Row-major.
+		bool			m_is_open{};
+		
+	public:
+		void add_file(std::string const &path) override;
+		void prepare() override;
+		using msa_reader::fill_buffer;
+		bool fill_buffer(std::size_t const lb, std::size_t const rb, fill_buffer_callback_type &) override;
+		
+		std::size_t aligned_size() const override { return m_msa.aligned_size(); }
+		std::size_t handle_count() const override { return m_msa.row_count(); }
+	};
+	
+	
+	// Reads an indexed FASTA file that contains all the sequences. add_file() should be called once with the path of the FASTA file.
+	class fasta_msa_reader final : public msa_reader
+	{
+	protected:
+		fasta_msa		m_msa;
+		buffer_type		m_data;			// Row-major.
+		std::size_t		m_advised_lb{};	// Range passed to advise_will_need() most recently.
+		std::size_t		m_advised_rb{};
+		bool			m_is_open{};
+		
+	public:
+		void add_file(std::string const &path) override;
+		void prepare() override;
+		using msa_reader::fill_buffer;
+		bool fill_buffer(std::size_t const lb, std::size_t const rb, fill_buffer_callback_type &) override;
+		
+		std::size_t aligned_size() const override { return m_msa.aligned_size(); }
+		std::size_t handle_count() const override { return m_msa.row_count(); }
+	};
+	
+	
 	inline std::ostream &operator<<(std::ostream &os, bgzip_msa_reader::block_range const &br)
 	{
 		os << "block_lb: " << br.block_lb << " block_rb: " << br.block_rb;
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#ifndef FOUNDER_GRAPHS_PACKED_MSA_HH
+#define FOUNDER_GRAPHS_PACKED_MSA_HH
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <founder_graphs/bgzip_reader.hh>
+#include <libbio/file_handle.hh>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+
+namespace founder_graphs {
+	
+	// Packed MSA format. All integers are stored in little-endian byte order.
+	//
+	// Header:		magic (8 bytes), row count, aligned size, tile width (in columns), tile count (64-bit integers).
+	// Tiles:		For each tile of tile_width columns (the last one may be narrower), the columns from left to right,
+	//				each with the 4-bit codes of all rows (even rows in the low nibbles) padded to a whole number of bytes.
+	//				After the columns, the number of escaped characters (64-bit) followed by one 64-bit
+	//				integer per escaped character sorted by position; the character is stored in the low byte and
+	//				column_in_tile * row_count + row in the remaining bits.
+	//				Codes 0–14 correspond to PACKED_MSA_ALPHABET, and code 15 indicates an escaped character.
+	// Tile index:	tile_count + 1 byte offsets (64-bit) of the tiles from the beginning of the file.
+	// Footer:		byte offset of the tile index (64-bit), magic (8 bytes).
+	//
+	// Since the tile index can be used to locate any tile, the file can be traversed in both directions.
+	// Version 01 only had codes for ACGTN-; since its files are a subset of the current format, they can still be read.
+	
+	constexpr static inline std::array <char, 8> const PACKED_MSA_MAGIC{'F', 'G', 'P', 'M', 'S', 'A', '0', '2'};
+	constexpr static inline std::array <char, 8> const PACKED_MSA_MAGIC_V1{'F', 'G', 'P', 'M', 'S', 'A', '0', '1'};
+	constexpr static inline std::size_t const PACKED_MSA_HEADER_SIZE{8 + 4 * 8};
+	constexpr static inline std::size_t const PACKED_MSA_FOOTER_SIZE{8 + 8};
+	constexpr static inline std::size_t const PACKED_MSA_TILE_WIDTH_DEFAULT{65536};
+	
+	constexpr static inline std::uint8_t const PACKED_MSA_ESCAPE_CODE{0xf};
+	// Soft-masked bases and the most common IUPAC codes are included so that they need not be escaped.
+	constexpr static inline std::array <char, 15> const PACKED_MSA_ALPHABET{
+		'A', 'C', 'G', 'T', 'N', '-',
+		'a', 'c', 'g', 't', 'n',
+		'R', 'Y', 'K', 'M'
+	};
+	
+	
+	// 4-bit code of the given character.
+	constexpr inline std::uint8_t packed_msa_code(char const cc)
+	{
+		switch (cc)
+		{
+			case 'A':	return 0;
+			case 'C':	return 1;
+			case 'G':	return 2;
+			case 'T':	return 3;
+			case 'N':	return 4;
+			case '-':	return 5;
+			case 'a':	return 6;
+			case 'c':	return 7;
+			case 'g':	return 8;
+			case 't':	return 9;
+			case 'n':	return 10;
+			case 'R':	return 11;
+			case 'Y':	return 12;
+			case 'K':	return 13;
+			case 'M':	return 14;
+			default:	return PACKED_MSA_ESCAPE_CODE;
+		}
+	}
+	
+	
+	// Writes the packed format to a stream.
+	class packed_msa_writer
+	{
+	public:
+		typedef std::span <char const>	row_span_type;
+		
+	protected:
+		std::ostream				*m_stream{};
+		std::vector <std::uint64_t>	m_tile_offsets;
+		std::vector <std::uint8_t>	m_tile_buffer;
+		std::vector <std::uint64_t>	m_escapes;
+		std::size_t					m_row_count{};
+		std::size_t					m_aligned_size{};
+		std::size_t					m_tile_width{};
+		std::size_t					m_position{};			// Aligned position.
+		std::size_t					m_stream_position{};	// Byte position.
+		
+	public:
+		packed_msa_writer() = default;
+		
+		packed_msa_writer(std::ostream &stream, std::size_t const row_count, std::size_t const aligned_size, std::size_t const tile_width):
+			m_stream(&stream),
+			m_row_count(row_count),
+			m_aligned_size(aligned_size),
+			m_tile_width(tile_width)
+		{
+		}
+		
+		std::size_t tile_width() const { return m_tile_width; }
+		std::size_t tile_count() const { return (m_aligned_size + m_tile_width - 1) / m_tile_width; }
+		
+		void write_header();
+		// Write the next tile. rows should contain one span of equal length per row; the length should be tile_width except for the last tile.
+		void write_tile(std::span <row_span_type const> const rows);
+		void finish();
+		
+	protected:
+		void write_uint64(std::uint64_t const val);
+		void write_bytes(char const *data, std::size_t const size);
+	};
+	
+	
+	// Memory-mapped packed MSA.
+	class packed_msa
+	{
+	protected:
+		libbio::file_handle			m_handle;
+		memory_mapping				m_mapping;
+		std::vector <std::uint64_t>	m_tile_offsets;
+		std::size_t					m_row_count{};
+		std::size_t					m_aligned_size{};
+		std::size_t					m_tile_width{};
+		std::size_t					m_tile_count{};
+		
+	public:
+		void open(std::string const &path);
+		
+		std::size_t row_count() const { return m_row_count; }
+		std::size_t aligned_size() const { return m_aligned_size; }
+		std::size_t tile_width() const { return m_tile_width; }
+		std::size_t tile_count() const { return m_tile_count; }
+		std::size_t tile_lb(std::size_t const tile) const { return tile * m_tile_width; }
+		std::size_t tile_size(std::size_t const tile) const { return std::min(m_tile_width, m_aligned_size - tile_lb(tile)); }
+		std::size_t tile_for_column(std::size_t const column) const { return column / m_tile_width; }
+		
+		// Advise the kernel about the order in which the tiles will be read.
+		void advise_access_pattern(bgzip_access_pattern const pattern) const;
+		void advise_will_need(std::size_t const tile) const;
+		
+		// Decode the columns [column_lb, column_rb) of the given tile (relative to the tile) s.t. the character
+		// of row j in column c is stored to dst[j * row_stride + (c - column_lb) * column_stride].
+		void decode(
+			std::size_t const tile,
+			std::size_t const column_lb,
+			std::size_t const column_rb,
+			char *dst,
+			std::ptrdiff_t const row_stride,
+			std::ptrdiff_t const column_stride
+		) const;
+	};
+}
+
+#endif
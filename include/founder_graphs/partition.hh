@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#ifndef FOUNDER_GRAPHS_PARTITION_HH
+#define FOUNDER_GRAPHS_PARTITION_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <libbio/dispatch.hh>
+
+
+namespace founder_graphs {
+	
+	// Call fn(lb, rb) for each part of [0, size) concurrently and wait. The
+	// boundaries are multiples of alignment s.t. bit-compressed vectors may be
+	// written in parallel.
+	template <typename t_fn>
+	void for_each_partition(std::size_t const size, std::size_t const partition_count, std::size_t const alignment, t_fn &&fn)
+	{
+		auto const queue(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
+		libbio::dispatch_ptr <dispatch_group_t> group(dispatch_group_create());
+		
+		auto partition_size((size + partition_count - 1) / partition_count);
+		partition_size = std::max(alignment, (partition_size + alignment - 1) / alignment * alignment);
+		for (std::size_t i(0); i < size; i += partition_size)
+		{
+			auto const rb(std::min(size, i + partition_size));
+			libbio::dispatch_group_async_fn(*group, queue, [&fn, i, rb](){ fn(i, rb); });
+		}
+		
+		dispatch_group_wait(*group, DISPATCH_TIME_FOREVER);
+	}
+}
+
+#endif
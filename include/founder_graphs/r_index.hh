@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#ifndef FOUNDER_GRAPHS_R_INDEX_HH
+#define FOUNDER_GRAPHS_R_INDEX_HH
+
+#include <array>
+#include <cstdint>
+#include <founder_graphs/batched_backward_search.hh>
+#include <founder_graphs/lexicographic_range.hh>
+#include <sdsl/int_vector.hpp>
+#include <sdsl/sd_vector.hpp>
+#include <span>
+#include <vector>
+
+
+namespace founder_graphs {
+	
+	class r_index;
+	template <> struct lexicographic_range <r_index>;
+	
+	
+	// Run-length compressed BWT with the suffix array values at the run boundaries and the irreducible
+	// PLCP values, as in Gagie, Navarro, Prezza: Fully functional suffix trees and optimal text searching
+	// in BWT-runs bounded space (2020). The size is O(r) words for r runs, which is typically orders of
+	// magnitude less than the size of a CSA for a collection of similar sequences.
+	//
+	// Backward search maintains the suffix array values of both ends of the range (toeholds). With them,
+	// the LCP values at the boundaries of the range can be determined with phi_inverse() and plcp().
+	class r_index
+	{
+		friend class r_index_builder;
+		
+	public:
+		typedef std::uint64_t							size_type;
+		typedef std::uint8_t							char_type;
+		typedef lexicographic_range <r_index>			range_type;
+		typedef sdsl::sd_vector <>						bit_vector_type;
+		typedef bit_vector_type::rank_1_type			rank1_support_type;
+		typedef bit_vector_type::select_1_type			select1_support_type;
+		
+		// As in SDSL’s CSAs.
+		sdsl::int_vector <8>							char2comp;
+		sdsl::int_vector <8>							comp2char;
+		sdsl::int_vector <64>							C;
+		size_type										sigma{};
+		
+	protected:
+		bit_vector_type									m_run_starts;				// BWT positions of the first characters of the runs.
+		bit_vector_type									m_runs_by_char;				// comp · r + k for each run k with head comp.
+		bit_vector_type									m_run_lf_starts;			// LF-images of the first characters of the runs.
+		bit_vector_type									m_run_start_positions;		// Text positions of the first suffixes of the runs.
+		bit_vector_type									m_run_end_positions;		// Text positions of the last suffixes of the runs.
+		rank1_support_type								m_run_starts_rank1_support;
+		select1_support_type							m_run_starts_select1_support;
+		rank1_support_type								m_runs_by_char_rank1_support;
+		select1_support_type							m_runs_by_char_select1_support;
+		select1_support_type							m_run_lf_starts_select1_support;
+		rank1_support_type								m_run_start_positions_rank1_support;
+		select1_support_type							m_run_start_positions_select1_support;
+		rank1_support_type								m_run_end_positions_rank1_support;
+		select1_support_type							m_run_end_positions_select1_support;
+		sdsl::int_vector <8>							m_run_heads;				// Character ranks.
+		sdsl::int_vector <64>							m_char_run_offsets;			// Number of runs with a smaller head, by character rank.
+		sdsl::int_vector <0>							m_sa_run_starts;			// By run.
+		sdsl::int_vector <0>							m_sa_run_ends;				// By run.
+		sdsl::int_vector <0>							m_plcp_samples;				// LCP values of the first suffixes of the runs, by text position.
+		sdsl::int_vector <0>							m_phi_inverse_samples;		// SA values that follow the last suffixes of the runs, by text position.
+		size_type										m_size{};
+		size_type										m_max_lcp{};
+		
+	public:
+		size_type size() const { return m_size; }
+		size_type run_count() const { return m_run_heads.size(); }
+		size_type max_lcp() const { return m_max_lcp; }
+		
+		// Number of occurrences of the character with the given rank in BWT[0, pos).
+		size_type rank(size_type const pos, char_type const comp) const;
+		
+		// Extend the range and its toeholds with the given character. As in sdsl::backward_search(),
+		// an empty range is indicated by rb + 1 == lb. Returns the size of the new range.
+		size_type backward_search(range_type &range, char_type const cc) const;
+		
+		// SA[ISA[pos] + 1], i.e. the text position of the suffix that follows the one at pos in
+		// lexicographic order. Not defined for the last suffix.
+		size_type phi_inverse(size_type const pos) const;
+		
+		// LCP[ISA[pos]], i.e. the length of the longest common prefix of the suffix at pos and the one
+		// that precedes it in lexicographic order.
+		size_type plcp(size_type const pos) const;
+		
+		// SA[0] and SA[n - 1], the toeholds of the range of the empty string.
+		size_type first_suffix() const { return m_size - 1; }
+		size_type last_suffix() const { return m_sa_run_ends[m_sa_run_ends.size() - 1]; }
+		
+		size_type size_in_bytes() const;
+		void prepare_rank_and_select_support();
+		
+		template <typename t_archive>
+		void CEREAL_SAVE_FUNCTION_NAME(t_archive &archive) const;
+		
+		template <typename t_archive>
+		void CEREAL_LOAD_FUNCTION_NAME(t_archive &archive);
+		
+	protected:
+		size_type run_containing(size_type const pos) const { return m_run_starts_rank1_support(1 + pos) - 1; }
+		size_type run_start(size_type const run) const { return m_run_starts_select1_support(1 + run); }
+		size_type runs_before(size_type const run, char_type const comp) const { return m_runs_by_char_rank1_support(comp * run_count() + run) - m_char_run_offsets[comp]; }
+		size_type nth_run(size_type const nn, char_type const comp) const { return m_runs_by_char_select1_support(1 + m_char_run_offsets[comp] + nn) - comp * run_count(); }
+		inline size_type run_length_sum(size_type const nn, char_type const comp) const;
+		size_type preceding_position(size_type const pos) const { return (pos ? pos - 1 : m_size - 1); }
+	};
+	
+	
+	// Builds an r_index from the BWT, the suffix array and the LCP array, which are passed
+	// one position at a time in lexicographic order. Only O(r) values are stored.
+	class r_index_builder
+	{
+	public:
+		typedef r_index::size_type						size_type;
+		typedef r_index::char_type						char_type;
+		
+	protected:
+		std::vector <size_type>							m_run_starts;
+		std::vector <char_type>							m_run_heads;
+		std::vector <size_type>							m_sa_run_starts;
+		std::vector <size_type>							m_sa_run_ends;
+		std::vector <size_type>							m_lcp_run_starts;
+		std::array <size_type, 256>						m_char_counts{};
+		size_type										m_size{};
+		size_type										m_max_lcp{};
+		size_type										m_previous_sa_value{};
+		
+	public:
+		void add(char_type const bwt_char, size_type const sa_value, size_type const lcp_value);
+		void finish(r_index &index);
+	};
+	
+	
+	// Backward search with toeholds.
+	template <>
+	struct lexicographic_range <r_index>
+	{
+		typedef r_index						csa_type;
+		typedef r_index::size_type			size_type;
+		typedef r_index::char_type			char_type;
+		
+		size_type lb{};
+		size_type rb{};
+		size_type sa_lb{};	// SA[lb]
+		size_type sa_rb{};	// SA[rb]
+		
+		lexicographic_range() = default;
+		
+		explicit lexicographic_range(r_index const &index)
+		{
+			reset(index);
+		}
+		
+		size_type size() const { return rb - lb + 1; }
+		bool empty() const { return rb < lb; }
+		bool is_singleton() const { return lb == rb; }
+		bool has_prefix(lexicographic_range const other) const { return other.lb <= lb && rb <= other.rb; }
+		
+		void reset(r_index const &index)
+		{
+			lb = 0;
+			rb = index.size() - 1;
+			sa_lb = index.first_suffix();
+			sa_rb = index.last_suffix();
+		}
+		
+		size_type backward_search(r_index const &index, char_type const cc) { return index.backward_search(*this, cc); }
+	};
+	
+	
+	template <>
+	struct backward_search_query <r_index>
+	{
+		typedef r_index						csa_type;
+		typedef r_index::size_type			size_type;
+		typedef r_index::char_type			char_type;
+		typedef r_index::range_type			range_type;
+		
+		range_type	range{};
+		char_type	cc{};
+		
+		backward_search_query() = default;
+		
+		backward_search_query(range_type const &range_, char_type const cc_):
+			range(range_),
+			cc(cc_)
+		{
+		}
+		
+		size_type size() const { return range.size(); }
+		bool empty() const { return range.empty(); }
+		void assign_to(range_type &dst) const { dst = range; }
+	};
+	
+	
+	void batched_backward_search(r_index const &index, std::span <backward_search_query <r_index>> const queries);
+	
+	
+	r_index::size_type r_index::run_length_sum(size_type const nn, char_type const comp) const
+	{
+		// Total length of the first nn runs with the given head.
+		if (m_char_run_offsets[comp] + nn < m_char_run_offsets[1 + comp])
+			return m_run_lf_starts_select1_support(1 + m_char_run_offsets[comp] + nn) - C[comp];
+		return C[1 + comp] - C[comp];
+	}
+	
+	
+	template <typename t_archive>
+	void r_index::CEREAL_SAVE_FUNCTION_NAME(t_archive &archive) const
+	{
+		archive(CEREAL_NVP(char2comp));
+		archive(CEREAL_NVP(comp2char));
+		archive(CEREAL_NVP(C));
+		archive(CEREAL_NVP(sigma));
+		archive(CEREAL_NVP(m_run_starts));
+		archive(CEREAL_NVP(m_runs_by_char));
+		archive(CEREAL_NVP(m_run_lf_starts));
+		archive(CEREAL_NVP(m_run_start_positions));
+		archive(CEREAL_NVP(m_run_end_positions));
+		archive(CEREAL_NVP(m_run_heads));
+		archive(CEREAL_NVP(m_char_run_offsets));
+		archive(CEREAL_NVP(m_sa_run_starts));
+		archive(CEREAL_NVP(m_sa_run_ends));
+		archive(CEREAL_NVP(m_plcp_samples));
+		archive(CEREAL_NVP(m_phi_inverse_samples));
+		archive(CEREAL_NVP(m_size));
+		archive(CEREAL_NVP(m_max_lcp));
+	}
+	
+	
+	template <typename t_archive>
+	void r_index::CEREAL_LOAD_FUNCTION_NAME(t_archive &archive)
+	{
+		archive(CEREAL_NVP(char2comp));
+		archive(CEREAL_NVP(comp2char));
+		archive(CEREAL_NVP(C));
+		archive(CEREAL_NVP(sigma));
+		archive(CEREAL_NVP(m_run_starts));
+		archive(CEREAL_NVP(m_runs_by_char));
+		archive(CEREAL_NVP(m_run_lf_starts));
+		archive(CEREAL_NVP(m_run_start_positions));
+		archive(CEREAL_NVP(m_run_end_positions));
+		archive(CEREAL_NVP(m_run_heads));
+		archive(CEREAL_NVP(m_char_run_offsets));
+		archive(CEREAL_NVP(m_sa_run_starts));
+		archive(CEREAL_NVP(m_sa_run_ends));
+		archive(CEREAL_NVP(m_plcp_samples));
+		archive(CEREAL_NVP(m_phi_inverse_samples));
+		archive(CEREAL_NVP(m_size));
+		archive(CEREAL_NVP(m_max_lcp));
+		prepare_rank_and_select_support(); // The support structures of sd_vector only store a pointer to the vector.
+	}
+}
+
+#endif
@@ -6,16 +6,31 @@
 #ifndef FOUNDER_GRAPHS_REVERSE_MSA_READER_HH
 #define FOUNDER_GRAPHS_REVERSE_MSA_READER_HH
 
+#include <array>
+#include <founder_graphs/batched_file_reader.hh>
 #include <founder_graphs/bgzip_reader.hh>
+#include <founder_graphs/fasta_msa.hh>
+#include <founder_graphs/packed_msa.hh>
 #include <functional>
+#include <libbio/assert.hh>
 #include <libbio/dispatch/dispatch_ptr.hh>
 #include <libbio/file_handle.hh>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <string>
 #include <vector>
 
 
 namespace founder_graphs {
 	
+	enum class msa_buffer_layout
+	{
+		row_major,		// The block of each sequence is stored contiguously.
+		column_major	// Each column of the block is stored contiguously, starting from the rightmost column.
+	};
+	
+	
 	// TODO: Make this set of classes more general-purpose by e.g. by allowing traversal from the beginning or random access.
 	class reverse_msa_reader
 	{
@@ -25,8 +40,11 @@ namespace founder_graphs {
 		
 	protected:
 		buffer_type							m_buffer;
+		buffer_type							m_row_major_buffer;		// Used for reading if the layout is column-major.
 		std::size_t							m_file_position{};
 		std::size_t							m_current_block_size{};
+		std::size_t							m_row_count{};
+		msa_buffer_layout					m_layout{msa_buffer_layout::row_major};
 		
 	public:
 		virtual ~reverse_msa_reader() {}
@@ -35,21 +53,63 @@ namespace founder_graphs {
 		virtual bool fill_buffer(fill_buffer_callback_type &) = 0;
 		bool fill_buffer(fill_buffer_callback_type &&cb) { return fill_buffer(cb); }
 		
+		// Should be called before prepare().
+		void set_layout(msa_buffer_layout const layout) { m_layout = layout; }
+		msa_buffer_layout layout() const { return m_layout; }
+		
 		buffer_type const &buffer() const { return m_buffer; }
 		std::size_t block_size() const { return m_current_block_size; }
 		virtual std::size_t aligned_size() const = 0;
 		virtual std::size_t handle_count() const = 0;
+		
+		// Access the character of the given sequence in the i-th column counting from the right end of the current block.
+		inline char character(std::size_t const i, std::size_t const seq_idx) const;
+		
+		// Access the i-th column counting from the right end of the current block. Requires the column-major layout.
+		inline std::span <char const> column(std::size_t const i) const;
+		
+	protected:
+		// The buffer to which the sequences should be read in row-major layout.
+		buffer_type &read_buffer() { return (msa_buffer_layout::column_major == m_layout ? m_row_major_buffer : m_buffer); }
+		
+		// Should be called after reading the current block to read_buffer().
+		void finish_reading_block();
 	};
 	
 	
+	char reverse_msa_reader::character(std::size_t const i, std::size_t const seq_idx) const
+	{
+		libbio_assert_lt(i, m_current_block_size);
+		if (msa_buffer_layout::column_major == m_layout)
+			return m_buffer[i * m_row_count + seq_idx];
+		else
+			return m_buffer[(seq_idx + 1) * m_current_block_size - i - 1];
+	}
+	
+	
+	std::span <char const> reverse_msa_reader::column(std::size_t const i) const
+	{
+		libbio_assert_eq(msa_buffer_layout::column_major, m_layout);
+		libbio_assert_lt(i, m_current_block_size);
+		return std::span <char const>(m_buffer.data() + i * m_row_count, m_row_count);
+	}
+	
+	
 	class text_reverse_msa_reader final : public reverse_msa_reader
 	{
 	protected:
 		std::vector <libbio::file_handle>	m_handles;
+		batched_file_reader					m_batched_reader;
+		std::vector <read_request>			m_read_requests;
 		std::size_t							m_preferred_block_size{}; // Hopefully the same for all handles.
 		std::size_t							m_aligned_size{};
+		bool								m_should_use_io_uring{};
 		
 	public:
+		// Read the rows of each block with one batch of io_uring requests if available. Should be called before prepare().
+		void set_uses_io_uring(bool const should_use) { m_should_use_io_uring = should_use; }
+		bool uses_io_uring() const { return m_batched_reader.uses_io_uring(); }
+		
 		void add_file(std::string const &path) override;
 		void prepare() override;
 		using reverse_msa_reader::fill_buffer;
@@ -60,13 +120,57 @@ namespace founder_graphs {
 	};
 	
 	
+	// Reads the bgzipped sequences. If read-ahead is enabled, the column ranges that precede the current one
+	// are read and decompressed in the background while the callback is being run.
+	// The rows need not have been compressed with matching block boundaries. The columns are read in ranges
+	// determined from the boundaries of all the rows, and the blocks that span the boundary of two ranges
+	// are cached s.t. they need to be decompressed only once.
 	class bgzip_reverse_msa_reader final : public reverse_msa_reader
 	{
+	protected:
+		constexpr static inline std::size_t const BLOCK_CACHE_SIZE{2};
+		
+		typedef std::shared_ptr <std::vector <char> const>	decompressed_block_ptr;
+		
+		// Recently decompressed blocks of one row that were only partially copied to a read buffer.
+		struct block_cache
+		{
+			std::array <std::pair <std::size_t, decompressed_block_ptr>, BLOCK_CACHE_SIZE>	entries{};
+			std::size_t																	next_entry{};
+			std::mutex																	mutex;
+			
+			block_cache() { for (auto &entry : entries) entry.first = SIZE_MAX; }
+			decompressed_block_ptr find(std::size_t const block);
+			void insert(std::size_t const block, decompressed_block_ptr ptr);
+		};
+		
+		struct read_ahead_slot
+		{
+			std::vector <std::vector <char>>		input_buffers;	// One per handle.
+			buffer_type								buffer;			// Row-major.
+			libbio::dispatch_ptr <dispatch_group_t>	group;
+			std::size_t								range{SIZE_MAX};
+		};
+		
 	protected:
 		std::vector <bgzip_reader>				m_handles;
-		libbio::dispatch_ptr <dispatch_group_t>	m_decompress_group;
+		std::vector <block_cache>				m_block_caches;		// One per handle.
+		std::vector <std::size_t>				m_column_ranges;	// Boundaries of the ranges of columns read at a time.
+		std::vector <read_ahead_slot>			m_read_ahead_slots;
+		std::size_t								m_read_ahead_block_count{READ_AHEAD_BLOCK_COUNT_DEFAULT};
+		std::size_t								m_remaining_range_count{};
+		bgzip_access_mode						m_access_mode{bgzip_access_mode::pread};
 		
 	public:
+		~bgzip_reverse_msa_reader() override;
+		
+		// Should be called before add_file().
+		void set_access_mode(bgzip_access_mode const mode) { m_access_mode = mode; }
+		
+		// Maximum number of column ranges read in advance, i.e. in addition to the one passed to the callback.
+		// Zero disables read-ahead. Should be called before prepare().
+		void set_read_ahead_block_count(std::size_t const count) { m_read_ahead_block_count = count; }
+		
 		void add_file(std::string const &path) override;
 		void prepare() override;
 		using reverse_msa_reader::fill_buffer;
@@ -74,6 +178,54 @@ namespace founder_graphs {
 		
 		std::size_t aligned_size() const override { return (m_handles.empty() ? 0 : m_handles.front().uncompressed_size()); }
 		std::size_t handle_count() const override { return m_handles.size(); }
+		
+		std::size_t range_count() const { return m_column_ranges.size() - 1; }
+		
+	protected:
+		void prepare_column_ranges();
+		void schedule_range(read_ahead_slot &slot, std::size_t const range);
+		void decompress_range(std::size_t const row, std::size_t const lb, std::size_t const rb, std::vector <char> &input_buffer, char *dst);
+	};
+	
+	
+	// Reads a packed MSA one tile at a time. add_file() should be called once with the path of the packed file.
+	class packed_reverse_msa_reader final : public reverse_msa_reader
+	{
+	protected:
+		packed_msa								m_msa;
+		std::size_t								m_remaining_tile_count{};
+		bool									m_is_open{};
+		
+	public:
+		void add_file(std::string const &path) override;
+		void prepare() override;
+		using reverse_msa_reader::fill_buffer;
+		bool fill_buffer(fill_buffer_callback_type &) override;
+		
+		std::size_t aligned_size() const override { return m_msa.aligned_size(); }
+		std::size_t handle_count() const override { return m_msa.row_count(); }
+	};
+	
+	
+	// Reads an indexed FASTA file that contains all the sequences. add_file() should be called once with the path of the FASTA file.
+	class fasta_reverse_msa_reader final : public reverse_msa_reader
+	{
+	protected:
+		fasta_msa								m_msa;
+		std::size_t								m_block_size{FASTA_MSA_BLOCK_SIZE_DEFAULT};
+		bool									m_is_open{};
+		
+	public:
+		// Number of columns per block. Should be called before prepare().
+		void set_block_size(std::size_t const block_size) { libbio_always_assert_lt(0, block_size); m_block_size = block_size; }
+		
+		void add_file(std::string const &path) override;
+		void prepare() override;
+		using reverse_msa_reader::fill_buffer;
+		bool fill_buffer(fill_buffer_callback_type &) override;
+		
+		std::size_t aligned_size() const override { return m_msa.aligned_size(); }
+		std::size_t handle_count() const override { return m_msa.row_count(); }
 	};
 }
 
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#ifndef FOUNDER_GRAPHS_SEQUENCE_READER_HH
+#define FOUNDER_GRAPHS_SEQUENCE_READER_HH
+
+#include <libbio/file_handle.hh>
+#include <span>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+
+namespace founder_graphs {
+	
+	// Reads an uncompressed, gzipped or bgzipped sequence. Gzip is detected from the magic bytes.
+	class sequence_reader
+	{
+	protected:
+		libbio::file_handle	m_handle;
+		z_stream			m_stream{};
+		std::vector <char>	m_input_buffer;
+		bool				m_is_compressed{};
+		bool				m_is_in_member{};	// The end of the current gzip member has not been reached.
+		bool				m_reached_eof{};
+		
+	public:
+		explicit sequence_reader(std::string const &path);
+		~sequence_reader() { if (m_is_compressed) inflateEnd(&m_stream); }
+		
+		sequence_reader(sequence_reader const &) = delete;
+		sequence_reader &operator=(sequence_reader const &) = delete;
+		
+		// Fill the buffer. Returns the number of characters read, which is less than the size of the buffer only at the end of the file.
+		std::size_t read(std::span <char> const buffer) { return (m_is_compressed ? read_compressed(buffer) : read_uncompressed(buffer.data(), buffer.size())); }
+		
+		bool is_compressed() const { return m_is_compressed; }
+		
+	protected:
+		std::size_t read_uncompressed(char *dst, std::size_t size);
+		std::size_t read_compressed(std::span <char> const buffer);
+	};
+}
+
+#endif
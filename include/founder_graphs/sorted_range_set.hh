@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#ifndef FOUNDER_GRAPHS_SORTED_RANGE_SET_HH
+#define FOUNDER_GRAPHS_SORTED_RANGE_SET_HH
+
+#include <algorithm>
+#include <founder_graphs/batched_backward_search.hh>
+#include <founder_graphs/lexicographic_range.hh>
+#include <libbio/assert.hh>
+#include <numeric>
+#include <range/v3/view/enumerate.hpp>
+#include <range/v3/view/zip.hpp>
+#include <span>
+#include <vector>
+
+
+namespace founder_graphs {
+	
+	// Maintains a set of lexicographic ranges, one per identifier (e.g. sequence), in the order given by
+	// the left bound and then in reverse by the right bound. Since the ranges are either nested or disjoint,
+	// this places each range before the ranges nested in it.
+	//
+	// The identifiers with equal ranges are grouped into equivalence classes, so that backward search is done
+	// once per class and character. The classes are split when the characters of their members differ and
+	// merged when the extended ranges become equal again.
+	//
+	// Backward search with the same character is monotone w.r.t. both bounds, so it preserves the order.
+	// Moreover, the resulting ranges of distinct characters lie in distinct parts of the BWT. Hence after
+	// a backward search step the order may be determined by partitioning the classes stably by character
+	// and merging the result with the classes that were not extended. This takes O(m + kσ) time
+	// for m identifiers and k classes. The ranges are extended with batched_backward_search().
+	template <typename t_csa>
+	class sorted_range_set
+	{
+	public:
+		typedef t_csa								csa_type;
+		typedef typename csa_type::size_type		size_type;
+		typedef typename csa_type::char_type		char_type;
+		typedef lexicographic_range <csa_type>		range_type;
+		typedef std::vector <std::size_t>			identifier_vector;
+		typedef backward_search_query <csa_type>	query_type;
+		
+		struct equivalence_class
+		{
+			range_type	range{};
+			std::size_t	member_offset{};	// Offset in members().
+			std::size_t	member_count{};
+		};
+		
+		typedef std::vector <equivalence_class>		class_vector;
+	
+	protected:
+		class_vector				m_classes;			// In sorted order.
+		identifier_vector			m_members;			// Members of the classes, grouped by class.
+		class_vector				m_subclasses;		// Buffer for the classes split by character.
+		identifier_vector			m_subclass_members;	// Buffer for the members of the subclasses.
+		std::vector <size_type>		m_subclass_comps;	// Buffer for the character ranks of the subclasses.
+		std::vector <query_type>	m_queries;			// Buffer for the backward search queries of the subclasses.
+		identifier_vector			m_query_subclasses;	// Buffer for the indices of the subclasses by query.
+		identifier_vector			m_extended;			// Buffer for the indices of the extended subclasses.
+		identifier_vector			m_not_extended;		// Buffer for the indices of the subclasses that were not extended.
+		identifier_vector			m_subclass_order;	// Buffer for the indices of the subclasses in sorted order.
+		std::vector <size_type>		m_member_comps;		// Buffer for the character ranks of the members of the current class.
+		std::vector <std::size_t>	m_counts;			// Buffer for counts by character rank, the last one is for the skipped character.
+		std::vector <std::size_t>	m_bucket_limits;	// Buffer for the bucket limits by character rank.
+		std::vector <char_type>		m_chars_by_comp;	// Buffer for the characters of the current class by character rank.
+		size_type					m_sigma{};
+	
+	public:
+		sorted_range_set() = default;
+		
+		sorted_range_set(csa_type const &csa, std::size_t const size):
+			m_members(size),
+			m_subclass_members(size),
+			m_member_comps(size),
+			m_counts(1 + csa.sigma, 0),
+			m_bucket_limits(1 + csa.sigma, 0),
+			m_chars_by_comp(1 + csa.sigma, 0),
+			m_sigma(csa.sigma)
+		{
+			reset(csa);
+		}
+		
+		std::size_t size() const { return m_members.size(); }
+		std::size_t class_count() const { return m_classes.size(); }
+		class_vector const &classes() const { return m_classes; }			// In sorted order.
+		identifier_vector const &members() const { return m_members; }		// Grouped by class.
+		
+		std::span <std::size_t const> members(equivalence_class const &eq_class) const
+		{
+			return std::span <std::size_t const>(m_members.data() + eq_class.member_offset, eq_class.member_count);
+		}
+		
+		void reset(csa_type const &csa);
+		
+		// Extend the ranges with the characters returned by char_fn(identifier). Leave the ranges
+		// for which the character is equal to skipped_char as they are.
+		template <typename t_char_fn>
+		void backward_search(csa_type const &csa, char_type const skipped_char, t_char_fn &&char_fn);
+		
+		// For debugging.
+		bool is_sorted() const;
+	
+	protected:
+		template <typename t_char_fn>
+		void split_class(csa_type const &csa, equivalence_class const &eq_class, char_type const skipped_char, t_char_fn &&char_fn);
+		
+		void output_classes();
+	};
+	
+	
+	template <typename t_csa>
+	void sorted_range_set <t_csa>::reset(csa_type const &csa)
+	{
+		m_classes.clear();
+		std::iota(m_members.begin(), m_members.end(), 0);
+		if (!m_members.empty())
+			m_classes.push_back({range_type(csa), 0, m_members.size()});
+	}
+	
+	
+	template <typename t_csa>
+	bool sorted_range_set <t_csa>::is_sorted() const
+	{
+		return std::is_sorted(m_classes.begin(), m_classes.end(), [](auto const &lhs, auto const &rhs){
+			return lhs.range.lb < rhs.range.lb || (lhs.range.lb == rhs.range.lb && rhs.range.rb < lhs.range.rb);
+		});
+	}
+	
+	
+	template <typename t_csa>
+	template <typename t_char_fn>
+	void sorted_range_set <t_csa>::split_class(
+		csa_type const &csa,
+		equivalence_class const &eq_class,
+		char_type const skipped_char,
+		t_char_fn &&char_fn
+	)
+	{
+		auto const members_(members(eq_class));
+		auto const dst_offset(m_subclasses.empty() ? 0 : m_subclasses.back().member_offset + m_subclasses.back().member_count);
+		
+		auto const add_subclass([&](char_type const cc, std::size_t const member_offset, std::size_t const member_count){
+			m_subclasses.push_back({eq_class.range, member_offset, member_count});
+			auto &subclass(m_subclasses.back());
+			if (skipped_char == cc)
+			{
+				m_subclass_comps.push_back(m_sigma);
+				m_not_extended.push_back(m_subclasses.size() - 1);
+			}
+			else
+			{
+				m_subclass_comps.push_back(csa.char2comp[cc]);
+				m_queries.emplace_back(subclass.range, cc);
+				m_query_subclasses.push_back(m_subclasses.size() - 1);
+			}
+		});
+		
+		// Check if all the members have the same character.
+		char_type const first_cc(char_fn(members_.front()));
+		bool is_uniform{true};
+		for (auto const idx : members_.subspan(1))
+		{
+			if (char_fn(idx) != first_cc)
+			{
+				is_uniform = false;
+				break;
+			}
+		}
+		
+		// Handle the usual case separately.
+		if (is_uniform)
+		{
+			std::copy(members_.begin(), members_.end(), m_subclass_members.begin() + dst_offset);
+			add_subclass(first_cc, dst_offset, members_.size());
+			return;
+		}
+		
+		// Partition the members by character rank. Use m_sigma for the skipped character.
+		std::fill(m_counts.begin(), m_counts.end(), 0);
+		for (auto const &[i, idx] : ranges::views::enumerate(members_))
+		{
+			char_type const cc(char_fn(idx));
+			size_type const comp(skipped_char == cc ? m_sigma : csa.char2comp[cc]);
+			m_member_comps[i] = comp;
+			m_chars_by_comp[comp] = cc;
+			++m_counts[comp];
+		}
+		
+		// Determine the offsets of the subclasses.
+		{
+			std::size_t offset(dst_offset);
+			for (size_type comp(0); comp <= m_sigma; ++comp)
+			{
+				auto const count(m_counts[comp]);
+				m_bucket_limits[comp] = offset;
+				if (count)
+					add_subclass(m_chars_by_comp[comp], offset, count);
+				offset += count;
+			}
+		}
+		
+		// Copy the members.
+		for (auto const &[i, idx] : ranges::views::enumerate(members_))
+			m_subclass_members[m_bucket_limits[m_member_comps[i]]++] = idx;
+	}
+	
+	
+	template <typename t_csa>
+	void sorted_range_set <t_csa>::output_classes()
+	{
+		// Replace the classes and merge the adjacent subclasses with equal ranges.
+		m_classes.clear();
+		std::size_t member_offset(0);
+		for (auto const subclass_idx : m_subclass_order)
+		{
+			auto const &subclass(m_subclasses[subclass_idx]);
+			if (m_classes.empty() || m_classes.back().range.lb != subclass.range.lb || m_classes.back().range.rb != subclass.range.rb)
+				m_classes.push_back({subclass.range, member_offset, 0});
+			
+			auto &eq_class(m_classes.back());
+			auto const src_begin(m_subclass_members.begin() + subclass.member_offset);
+			std::copy(src_begin, src_begin + subclass.member_count, m_members.begin() + member_offset);
+			eq_class.member_count += subclass.member_count;
+			member_offset += subclass.member_count;
+		}
+	}
+	
+	
+	template <typename t_csa>
+	template <typename t_char_fn>
+	void sorted_range_set <t_csa>::backward_search(csa_type const &csa, char_type const skipped_char, t_char_fn &&char_fn)
+	{
+		m_subclasses.clear();
+		m_subclass_comps.clear();
+		m_queries.clear();
+		m_query_subclasses.clear();
+		m_not_extended.clear();
+		
+		// Split the classes by character.
+		for (auto const &eq_class : m_classes)
+			split_class(csa, eq_class, skipped_char, char_fn);
+		
+		// Extend the ranges.
+		batched_backward_search(csa, std::span <query_type>(m_queries));
+		for (auto const &[query, subclass_idx] : ranges::views::zip(m_queries, m_query_subclasses))
+		{
+			libbio_always_assert(!query.empty());
+			query.assign_to(m_subclasses[subclass_idx].range);
+		}
+		
+		// Partition the extended subclasses by character rank, which is stable w.r.t. the current order.
+		auto const subclass_count(m_subclasses.size());
+		std::fill(m_bucket_limits.begin(), m_bucket_limits.end(), 0);
+		for (auto const comp : m_subclass_comps)
+		{
+			if (comp < m_sigma)
+				++m_bucket_limits[1 + comp];
+		}
+		
+		std::partial_sum(m_bucket_limits.begin(), m_bucket_limits.end(), m_bucket_limits.begin());
+		m_extended.resize(subclass_count - m_not_extended.size());
+		for (std::size_t i(0); i < subclass_count; ++i)
+		{
+			auto const comp(m_subclass_comps[i]);
+			if (comp < m_sigma)
+				m_extended[m_bucket_limits[comp]++] = i;
+		}
+		
+		// Merge.
+		m_subclass_order.resize(subclass_count);
+		std::merge(
+			m_extended.begin(), m_extended.end(),
+			m_not_extended.begin(), m_not_extended.end(),
+			m_subclass_order.begin(),
+			[this](std::size_t const lhs, std::size_t const rhs){
+				auto const &lhs_range(m_subclasses[lhs].range);
+				auto const &rhs_range(m_subclasses[rhs].range);
+				return lhs_range.lb < rhs_range.lb || (lhs_range.lb == rhs_range.lb && rhs_range.rb < lhs_range.rb);
+			}
+		);
+		
+		output_classes();
+		libbio_assert(is_sorted());
+	}
+}
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#ifndef FOUNDER_GRAPHS_STREAMING_COORDINATE_TRANSFORM_HH
+#define FOUNDER_GRAPHS_STREAMING_COORDINATE_TRANSFORM_HH
+
+#include <algorithm>
+#include <boost/format.hpp>
+#include <cstddef>
+#include <deque>
+#include <libbio/assert.hh>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+
+namespace founder_graphs {
+	
+	// Converts non-gap character counts to aligned coordinates while the MSA is read column by column
+	// from right to left. Replaces rank and select on the gap bit vectors of msa_index in the case where
+	// the non-gap characters are counted from the most recently added column.
+	//
+	// The non-gap positions of each row are stored as runs of consecutive columns. Only the runs that
+	// contain the window_size most recently added non-gap characters are retained.
+	class streaming_coordinate_transform
+	{
+	public:
+		constexpr static inline std::size_t const WINDOW_SIZE_MAX{std::numeric_limits <std::size_t>::max()};
+	
+	protected:
+		struct non_gap_run
+		{
+			std::size_t	lb{};			// Leftmost column.
+			std::size_t	rb{};			// Rightmost column.
+			std::size_t	count_before{};	// Number of non-gap characters to the right of the run.
+			
+			non_gap_run() = default;
+			
+			non_gap_run(std::size_t const column, std::size_t const count_before_):
+				lb(column),
+				rb(column),
+				count_before(count_before_)
+			{
+			}
+			
+			std::size_t size() const { return rb - lb + 1; }
+		};
+		
+		struct row
+		{
+			std::deque <non_gap_run>	runs;
+			std::size_t					non_gap_count{};	// Number of non-gap characters in the added columns.
+		};
+	
+	protected:
+		std::vector <row>	m_rows;
+		std::size_t			m_window_size{WINDOW_SIZE_MAX};
+		std::size_t			m_next_column{};
+		bool				m_has_columns{};
+	
+	public:
+		streaming_coordinate_transform() = default;
+		
+		streaming_coordinate_transform(std::size_t const row_count, std::size_t const window_size):
+			m_rows(row_count),
+			m_window_size(window_size)
+		{
+			libbio_always_assert_lt(0, window_size);
+		}
+		
+		std::size_t row_count() const { return m_rows.size(); }
+		std::size_t window_size() const { return m_window_size; }
+		
+		// Add the given column. The columns need to be added in decreasing order without skipping any.
+		// is_gap_fn(row_idx) should return true iff the character of the given row is a gap.
+		template <typename t_is_gap_fn>
+		void add_column(std::size_t const column, t_is_gap_fn &&is_gap_fn);
+		
+		// Return the column of the count-th non-gap character (1-based) at or after the most recently added column.
+		std::size_t non_gap_column(std::size_t const row_idx, std::size_t const count) const;
+	};
+	
+	
+	template <typename t_is_gap_fn>
+	void streaming_coordinate_transform::add_column(std::size_t const column, t_is_gap_fn &&is_gap_fn)
+	{
+		libbio_assert(!m_has_columns || column == m_next_column);
+		m_has_columns = true;
+		m_next_column = column - 1;
+		
+		for (std::size_t i(0); i < m_rows.size(); ++i)
+		{
+			if (is_gap_fn(i))
+				continue;
+			
+			auto &row(m_rows[i]);
+			auto &runs(row.runs);
+			if (!runs.empty() && runs.back().lb == column + 1)
+				runs.back().lb = column;
+			else
+				runs.emplace_back(column, row.non_gap_count);
+			
+			++row.non_gap_count;
+			
+			// Remove the runs that are no longer needed.
+			if (m_window_size < row.non_gap_count)
+			{
+				auto const limit(row.non_gap_count - m_window_size);
+				while (runs.front().count_before + runs.front().size() <= limit)
+					runs.pop_front();
+			}
+		}
+	}
+	
+	
+	inline std::size_t streaming_coordinate_transform::non_gap_column(std::size_t const row_idx, std::size_t const count) const
+	{
+		auto const &row(m_rows[row_idx]);
+		auto const &runs(row.runs);
+		libbio_assert_lt(0, count);
+		libbio_always_assert_lte(count, row.non_gap_count);
+		
+		// Index of the character counting from the right.
+		auto const idx(row.non_gap_count - count);
+		if (runs.empty() || idx < runs.front().count_before)
+			throw std::runtime_error(boost::str(boost::format("Non-gap character %d of row %d is outside the window of %d characters") % count % row_idx % m_window_size));
+		
+		auto const it(std::upper_bound(runs.begin(), runs.end(), idx, [](auto const idx, auto const &run){
+			return idx < run.count_before;
+		}));
+		libbio_assert_neq(it, runs.begin());
+		auto const &run(*(it - 1));
+		libbio_assert_lt(idx - run.count_before, run.size());
+		return run.rb - (idx - run.count_before);
+	}
+}
+
+#endif
@@ -4,6 +4,7 @@
  */
 
 #include <charconv>
+#include <founder_graphs/bgzip_reader.hh>
 #include <founder_graphs/founder_graph_indices/block_graph.hh>
 #include <iostream>
 #include <libbio/utility.hh>
@@ -18,6 +19,18 @@ namespace lb	= libbio;
 
 namespace {
 	
+	fg::msa_format input_format(gengetopt_args_info const &args_info)
+	{
+		if (args_info.fasta_input_flag)
+			return fg::msa_format::fasta;
+		if (args_info.packed_input_flag)
+			return fg::msa_format::packed;
+		if (args_info.bgzip_input_flag)
+			return fg::msa_format::bgzip;
+		return fg::msa_format::text;
+	}
+	
+	
 	std::size_t read_next_block_number(std::size_t const limit)
 	{
 		std::string buffer;
@@ -56,7 +69,10 @@ int main(int argc, char **argv)
 	fgi::read_optimized_segmentation(
 		args_info.sequence_list_arg,
 		args_info.segmentation_arg,
-		args_info.bgzip_input_flag,
+		input_format(args_info),
+		fg::READ_AHEAD_BLOCK_COUNT_DEFAULT,
+		std::size_t(args_info.block_cache_size_arg) * 1024 * 1024,
+		fg::bgzip_access_mode::pread,
 		gr
 	);
 	
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <algorithm>
+#include <array>
+#include <founder_graphs/batched_backward_search.hh>
+#include <libbio/assert.hh>
+
+
+namespace fg	= founder_graphs;
+
+
+namespace {
+	
+	// Number of queries processed together. The prefetched words of one level should fit in L1.
+	constexpr static inline std::size_t const BATCH_SIZE{32};
+	
+	
+	// Access the protected members of sdsl::wt_pc.
+	template <typename t_wt>
+	struct wt_pc_access : public t_wt
+	{
+		using t_wt::m_bv;
+		using t_wt::m_bv_rank;
+		using t_wt::m_tree;
+	};
+	
+	
+	template <typename t_wt>
+	concept wt_pc_type = requires {
+		typename t_wt::tree_strat_type;
+	};
+	
+	
+	template <typename t_csa>
+	struct batch_state
+	{
+		typedef t_csa												csa_type;
+		typedef typename csa_type::size_type						size_type;
+		typedef typename csa_type::wavelet_tree_type				wavelet_tree_type;
+		typedef typename wavelet_tree_type::tree_strat_type::node_type	node_type;
+		
+		node_type		node{};
+		std::uint64_t	path{};			// Remaining bits of the path in the wavelet tree.
+		std::uint32_t	path_length{};	// Length of the remaining path.
+		size_type		c_begin{};
+		size_type		lb_rank{};		// Number of occurrences of the character in bwt[0, lb).
+		size_type		rb_rank{};		// Number of occurrences of the character in bwt[0, rb].
+	};
+	
+	
+	template <typename t_csa>
+	void batched_backward_search_wt_pc(t_csa const &csa, std::span <fg::backward_search_query <t_csa>> const queries)
+	{
+		typedef typename t_csa::wavelet_tree_type	wavelet_tree_type;
+		typedef wt_pc_access <wavelet_tree_type>	access_type;
+		typedef batch_state <t_csa>					state_type;
+		
+		auto const &wt(csa.wavelet_tree);
+		auto const &tree(wt.*(&access_type::m_tree));
+		auto const &bv(wt.*(&access_type::m_bv));
+		auto const &bv_rank(wt.*(&access_type::m_bv_rank));
+		auto const *bv_data(bv.data());
+		auto const csa_size(csa.size());
+		
+		std::array <state_type, BATCH_SIZE> states;
+		std::array <std::size_t, BATCH_SIZE> active;	// Indices of the queries that need rank queries.
+		
+		for (std::size_t batch_begin(0); batch_begin < queries.size(); batch_begin += BATCH_SIZE)
+		{
+			auto const batch(queries.subspan(batch_begin, std::min(BATCH_SIZE, queries.size() - batch_begin)));
+			std::size_t active_count{};
+			std::uint32_t max_path_length{};
+			
+			// Initialise. Handle the special cases as in sdsl::backward_search().
+			for (std::size_t i(0); i < batch.size(); ++i)
+			{
+				auto &query(batch[i]);
+				libbio_assert_lte(query.lb, query.rb);
+				libbio_assert_lt(query.rb, csa_size);
+				
+				auto const comp(csa.char2comp[query.cc]);
+				if (0 == comp && 0 < query.cc)
+				{
+					query.lb = 1;
+					query.rb = 0;
+					continue;
+				}
+				
+				auto &state(states[i]);
+				state.c_begin = csa.C[comp];
+				if (0 == query.lb && query.rb + 1 == csa_size)
+				{
+					query.lb = state.c_begin;
+					query.rb = csa.C[comp + 1] - 1;
+					continue;
+				}
+				
+				if (!tree.is_valid(tree.c_to_leaf(query.cc)))
+				{
+					query.lb = state.c_begin;
+					query.rb = state.c_begin - 1;
+					continue;
+				}
+				
+				auto const path(tree.bit_path(query.cc));
+				state.node = tree.root();
+				state.path = path;
+				state.path_length = path >> 56;
+				state.lb_rank = query.lb;
+				state.rb_rank = query.rb + 1;
+				max_path_length = std::max(max_path_length, state.path_length);
+				active[active_count++] = i;
+			}
+			
+			// Handle the queries level by level.
+			for (std::uint32_t level(0); level < max_path_length; ++level)
+			{
+				// Prefetch the words of the bit vector.
+				for (std::size_t k(0); k < active_count; ++k)
+				{
+					auto const &state(states[active[k]]);
+					if (level < state.path_length)
+					{
+						auto const bv_pos(tree.bv_pos(state.node));
+						__builtin_prefetch(bv_data + ((bv_pos + state.lb_rank) >> 6));
+						__builtin_prefetch(bv_data + ((bv_pos + state.rb_rank) >> 6));
+					}
+				}
+				
+				// Do the rank queries and move to the next level.
+				for (std::size_t k(0); k < active_count; ++k)
+				{
+					auto &state(states[active[k]]);
+					if (level < state.path_length)
+					{
+						auto const bv_pos(tree.bv_pos(state.node));
+						auto const bv_pos_rank(tree.bv_pos_rank(state.node));
+						auto const lb_ones(bv_rank(bv_pos + state.lb_rank) - bv_pos_rank);
+						auto const rb_ones(bv_rank(bv_pos + state.rb_rank) - bv_pos_rank);
+						auto const bit(state.path & 0x1);
+						if (bit)
+						{
+							state.lb_rank = lb_ones;
+							state.rb_rank = rb_ones;
+						}
+						else
+						{
+							state.lb_rank -= lb_ones;
+							state.rb_rank -= rb_ones;
+						}
+						
+						state.node = tree.child(state.node, bit);
+						state.path >>= 1;
+					}
+				}
+			}
+			
+			// Store the results.
+			for (std::size_t k(0); k < active_count; ++k)
+			{
+				auto const idx(active[k]);
+				auto const &state(states[idx]);
+				auto &query(batch[idx]);
+				query.lb = state.c_begin + state.lb_rank;
+				query.rb = state.c_begin + state.rb_rank - 1;
+			}
+		}
+	}
+}
+
+
+namespace founder_graphs {
+	
+	void batched_backward_search(csa_type const &csa, std::span <backward_search_query <csa_type>> const queries)
+	{
+		if constexpr (wt_pc_type <csa_type::wavelet_tree_type>)
+			batched_backward_search_wt_pc(csa, queries);
+		else
+			batched_backward_search <csa_type>(csa, queries);
+	}
+}
@@ -0,0 +1,420 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <founder_graphs/batched_file_reader.hh>
+#include <libbio/assert.hh>
+#include <stdexcept>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#	include <linux/io_uring.h>
+#	include <sys/mman.h>
+#	include <sys/syscall.h>
+#	include <sys/uio.h>
+// IORING_FEAT_RW_CUR_POS was added in the same version as IORING_OP_READ and IORING_REGISTER_PROBE (Linux 5.6).
+#	if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register) && defined(IORING_FEAT_RW_CUR_POS)
+#		define FOUNDER_GRAPHS_HAVE_IO_URING 1
+#	endif
+#endif
+
+namespace fg	= founder_graphs;
+
+
+#ifdef FOUNDER_GRAPHS_HAVE_IO_URING
+namespace {
+	
+	// The length field of a submission queue entry has 32 bits.
+	constexpr static std::size_t const IO_URING_READ_LENGTH_MAX{std::size_t(1) << 30};
+	constexpr static unsigned int const IO_URING_PROBE_OP_COUNT{256};
+	
+	
+	// liburing is not required, so we make the system calls directly.
+	int io_uring_setup(unsigned int const entries, io_uring_params *params)
+	{
+		return ::syscall(__NR_io_uring_setup, entries, params);
+	}
+	
+	
+	int io_uring_enter(int const fd, unsigned int const to_submit, unsigned int const min_complete, unsigned int const flags)
+	{
+		return ::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+	}
+	
+	
+	int io_uring_register(int const fd, unsigned int const opcode, void const *arg, unsigned int const nr_args)
+	{
+		return ::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+	}
+	
+	
+	template <typename t_type>
+	t_type *ring_ptr(void *ring, std::uint32_t const offset)
+	{
+		return reinterpret_cast <t_type *>(static_cast <char *>(ring) + offset);
+	}
+}
+#endif
+
+
+namespace founder_graphs {
+	
+#ifdef FOUNDER_GRAPHS_HAVE_IO_URING
+	struct batched_file_reader::io_uring_context
+	{
+		int				fd{-1};
+		void			*sq_ring{};
+		void			*cq_ring{};
+		io_uring_sqe	*sqes{};
+		std::size_t		sq_ring_size{};
+		std::size_t		cq_ring_size{};		// Zero if the rings share the mapping.
+		std::size_t		sqes_size{};
+		
+		unsigned int	*sq_head{};
+		unsigned int	*sq_tail{};
+		unsigned int	*sq_mask{};
+		unsigned int	*sq_array{};
+		unsigned int	*cq_head{};
+		unsigned int	*cq_tail{};
+		unsigned int	*cq_mask{};
+		io_uring_cqe	*cqes{};
+		unsigned int	sq_entries{};
+		
+		char			*registered_buffer{};
+		std::size_t		registered_buffer_size{};
+		bool			has_registered_files{};
+		
+		~io_uring_context();
+		bool setup(unsigned int const queue_depth);
+		bool supports_read() const;
+	};
+	
+	
+	batched_file_reader::io_uring_context::~io_uring_context()
+	{
+		if (sqes)
+			::munmap(sqes, sqes_size);
+		if (cq_ring && cq_ring_size)
+			::munmap(cq_ring, cq_ring_size);
+		if (sq_ring)
+			::munmap(sq_ring, sq_ring_size);
+		if (-1 != fd)
+			::close(fd);
+	}
+	
+	
+	bool batched_file_reader::io_uring_context::setup(unsigned int const queue_depth)
+	{
+		io_uring_params params{};
+		fd = io_uring_setup(queue_depth, &params);
+		if (fd < 0)
+		{
+			fd = -1;
+			return false;
+		}
+		
+		// Map the rings.
+		sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+		auto const cq_size(params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+		bool const uses_single_mapping(params.features & IORING_FEAT_SINGLE_MMAP);
+		if (uses_single_mapping)
+			sq_ring_size = std::max(sq_ring_size, cq_size);
+		
+		sq_ring = ::mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+		if (MAP_FAILED == sq_ring)
+		{
+			sq_ring = nullptr;
+			return false;
+		}
+		
+		if (uses_single_mapping)
+			cq_ring = sq_ring;
+		else
+		{
+			cq_ring = ::mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+			if (MAP_FAILED == cq_ring)
+			{
+				cq_ring = nullptr;
+				return false;
+			}
+			cq_ring_size = cq_size;
+		}
+		
+		sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+		auto *sqes_(::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+		if (MAP_FAILED == sqes_)
+			return false;
+		sqes = static_cast <io_uring_sqe *>(sqes_);
+		
+		sq_head = ring_ptr <unsigned int>(sq_ring, params.sq_off.head);
+		sq_tail = ring_ptr <unsigned int>(sq_ring, params.sq_off.tail);
+		sq_mask = ring_ptr <unsigned int>(sq_ring, params.sq_off.ring_mask);
+		sq_array = ring_ptr <unsigned int>(sq_ring, params.sq_off.array);
+		cq_head = ring_ptr <unsigned int>(cq_ring, params.cq_off.head);
+		cq_tail = ring_ptr <unsigned int>(cq_ring, params.cq_off.tail);
+		cq_mask = ring_ptr <unsigned int>(cq_ring, params.cq_off.ring_mask);
+		cqes = ring_ptr <io_uring_cqe>(cq_ring, params.cq_off.cqes);
+		sq_entries = params.sq_entries;
+		
+		return supports_read();
+	}
+	
+	
+	bool batched_file_reader::io_uring_context::supports_read() const
+	{
+		// The header does not determine the version of the running kernel.
+		std::vector <char> buffer(sizeof(io_uring_probe) + IO_URING_PROBE_OP_COUNT * sizeof(io_uring_probe_op), 0);
+		auto *probe(reinterpret_cast <io_uring_probe *>(buffer.data()));
+		if (io_uring_register(fd, IORING_REGISTER_PROBE, probe, IO_URING_PROBE_OP_COUNT) < 0)
+			return false;
+		
+		return (
+			IORING_OP_READ <= probe->last_op &&
+			(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) &&
+			(probe->ops[IORING_OP_READ_FIXED].flags & IO_URING_OP_SUPPORTED)
+		);
+	}
+#else
+	struct batched_file_reader::io_uring_context
+	{
+	};
+#endif
+	
+	
+	batched_file_reader::batched_file_reader() = default;
+	batched_file_reader::~batched_file_reader() = default;
+	batched_file_reader::batched_file_reader(batched_file_reader &&) = default;
+	batched_file_reader &batched_file_reader::operator=(batched_file_reader &&) = default;
+	
+	
+	bool batched_file_reader::setup_io_uring(unsigned int const queue_depth)
+	{
+#ifdef FOUNDER_GRAPHS_HAVE_IO_URING
+		libbio_always_assert_lt(0, queue_depth);
+		auto ring(std::make_unique <io_uring_context>());
+		if (!ring->setup(queue_depth))
+			return false;
+		
+		m_ring = std::move(ring);
+		if (!m_fds.empty())
+			set_files(std::vector <int>(m_fds));
+		return true;
+#else
+		return false;
+#endif
+	}
+	
+	
+	void batched_file_reader::set_files(std::span <int const> const fds)
+	{
+		m_fds.assign(fds.begin(), fds.end());
+		
+#ifdef FOUNDER_GRAPHS_HAVE_IO_URING
+		if (!m_ring)
+			return;
+		
+		// Registering the files is optional; fall back to passing the descriptors if not possible.
+		auto &ring(*m_ring);
+		if (ring.has_registered_files)
+		{
+			io_uring_register(ring.fd, IORING_UNREGISTER_FILES, nullptr, 0);
+			ring.has_registered_files = false;
+		}
+		
+		if (!m_fds.empty())
+			ring.has_registered_files = (0 <= io_uring_register(ring.fd, IORING_REGISTER_FILES, m_fds.data(), m_fds.size()));
+#endif
+	}
+	
+	
+	void batched_file_reader::register_buffer(std::span <char> const buffer)
+	{
+#ifdef FOUNDER_GRAPHS_HAVE_IO_URING
+		if (!m_ring)
+			return;
+		
+		// Registering the buffer is optional (and may fail because of RLIMIT_MEMLOCK); fall back to IORING_OP_READ if not possible.
+		auto &ring(*m_ring);
+		if (ring.registered_buffer)
+		{
+			io_uring_register(ring.fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+			ring.registered_buffer = nullptr;
+			ring.registered_buffer_size = 0;
+		}
+		
+		if (buffer.empty())
+			return;
+		
+		iovec const iov{buffer.data(), buffer.size()};
+		if (0 <= io_uring_register(ring.fd, IORING_REGISTER_BUFFERS, &iov, 1))
+		{
+			ring.registered_buffer = buffer.data();
+			ring.registered_buffer_size = buffer.size();
+		}
+#endif
+	}
+	
+	
+	void batched_file_reader::read(std::span <read_request const> const requests)
+	{
+		if (m_ring)
+			read_io_uring(requests);
+		else
+			read_pread(requests);
+	}
+	
+	
+	void batched_file_reader::read_pread(std::span <read_request const> const requests)
+	{
+		for (auto const &req : requests)
+		{
+			libbio_assert_lt(req.file_index, m_fds.size());
+			std::size_t progress{};
+			while (progress < req.length)
+			{
+				auto const res(::pread(m_fds[req.file_index], req.buffer + progress, req.length - progress, req.offset + progress));
+				if (-1 == res)
+				{
+					if (EINTR == errno)
+						continue;
+					throw std::runtime_error(std::strerror(errno));
+				}
+				
+				if (0 == res)
+					throw std::runtime_error("Unexpected end of file.");
+				
+				progress += res;
+			}
+		}
+	}
+	
+	
+	void batched_file_reader::read_io_uring(std::span <read_request const> const requests)
+	{
+#ifdef FOUNDER_GRAPHS_HAVE_IO_URING
+		auto &ring(*m_ring);
+		
+		// Submit the requests in order.
+		m_progress.assign(requests.size(), 0);
+		m_pending.clear();
+		std::size_t completed{};
+		for (std::size_t i(requests.size()); i; --i)
+		{
+			if (requests[i - 1].length)
+				m_pending.push_back(i - 1);
+			else
+				++completed;
+		}
+		
+		std::size_t in_flight{};
+		int error{};
+		bool did_reach_eof{};
+		while (in_flight || (!(error || did_reach_eof) && completed < requests.size()))
+		{
+			// Fill the submission queue. Only this thread writes the tail.
+			auto tail(*ring.sq_tail);
+			while (!(error || did_reach_eof || m_pending.empty()) && in_flight < ring.sq_entries)
+			{
+				auto const idx(m_pending.back());
+				m_pending.pop_back();
+				
+				auto const &req(requests[idx]);
+				libbio_assert_lt(req.file_index, m_fds.size());
+				auto const progress(m_progress[idx]);
+				auto *dst(req.buffer + progress);
+				auto const length(std::min(req.length - progress, IO_URING_READ_LENGTH_MAX));
+				
+				auto const sqe_idx(tail & *ring.sq_mask);
+				auto &sqe(ring.sqes[sqe_idx]);
+				std::memset(&sqe, 0, sizeof(sqe));
+				if (ring.registered_buffer && ring.registered_buffer <= dst && dst + length <= ring.registered_buffer + ring.registered_buffer_size)
+				{
+					sqe.opcode = IORING_OP_READ_FIXED;
+					sqe.buf_index = 0;
+				}
+				else
+				{
+					sqe.opcode = IORING_OP_READ;
+				}
+				
+				if (ring.has_registered_files)
+				{
+					sqe.fd = req.file_index;
+					sqe.flags = IOSQE_FIXED_FILE;
+				}
+				else
+				{
+					sqe.fd = m_fds[req.file_index];
+				}
+				
+				sqe.addr = reinterpret_cast <std::uintptr_t>(dst);
+				sqe.len = length;
+				sqe.off = req.offset + progress;
+				sqe.user_data = idx;
+				ring.sq_array[sqe_idx] = sqe_idx;
+				
+				++tail;
+				++in_flight;
+			}
+			__atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
+			
+			// Submit the entries not yet consumed by the kernel and wait for at least one completion.
+			while (true)
+			{
+				auto const to_submit(tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE));
+				if (0 <= io_uring_enter(ring.fd, to_submit, 1, IORING_ENTER_GETEVENTS))
+					break;
+				
+				if (! (EINTR == errno || EAGAIN == errno || EBUSY == errno))
+					throw std::runtime_error(std::strerror(errno));
+			}
+			
+			// Reap the completions.
+			auto head(*ring.cq_head);
+			auto const cq_tail(__atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE));
+			while (head != cq_tail)
+			{
+				auto const &cqe(ring.cqes[head & *ring.cq_mask]);
+				auto const idx(cqe.user_data);
+				auto const res(cqe.res);
+				++head;
+				--in_flight;
+				
+				if (res < 0)
+				{
+					if (-EAGAIN == res || -EINTR == res)
+						m_pending.push_back(idx);
+					else
+						error = -res;
+					continue;
+				}
+				
+				if (0 == res)
+				{
+					did_reach_eof = true;
+					continue;
+				}
+				
+				m_progress[idx] += res;
+				if (m_progress[idx] < requests[idx].length)
+					m_pending.push_back(idx);
+				else
+					++completed;
+			}
+			__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+		}
+		
+		// Report errors only after the requests in flight have been completed, since they refer to the buffers.
+		if (error)
+			throw std::runtime_error(std::strerror(error));
+		if (did_reach_eof)
+			throw std::runtime_error("Unexpected end of file.");
+#else
+		read_pread(requests);
+#endif
+	}
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <founder_graphs/bgzip_block_cache.hh>
+
+
+namespace founder_graphs {
+	
+	auto bgzip_block_cache::get(std::size_t const file_id, std::size_t const block_idx, std::size_t const size) -> block_ptr
+	{
+		key_type const key(file_id, block_idx);
+		std::lock_guard const lock(m_mutex);
+		
+		// Move the block to the front if found.
+		if (auto const it(m_entries_by_key.find(key)); m_entries_by_key.end() != it)
+		{
+			++m_hit_count;
+			m_entries.splice(m_entries.begin(), m_entries, it->second);
+			return it->second->second;
+		}
+		
+		++m_miss_count;
+		auto retval(std::make_shared <block>(size));
+		m_entries.emplace_front(key, retval);
+		m_entries_by_key.emplace(key, m_entries.begin());
+		m_size += size;
+		evict();
+		return retval;
+	}
+	
+	
+	void bgzip_block_cache::evict()
+	{
+		// Keep at least the most recently added block.
+		while (m_capacity < m_size && 1 < m_entries.size())
+		{
+			auto const &[key, ptr] = m_entries.back();
+			m_size -= ptr->data.size();
+			m_entries_by_key.erase(key);
+			m_entries.pop_back();
+		}
+	}
+	
+	
+	void bgzip_block_cache::clear()
+	{
+		// File identifiers remain valid.
+		std::lock_guard const lock(m_mutex);
+		m_entries.clear();
+		m_entries_by_key.clear();
+		m_size = 0;
+		m_hit_count = 0;
+		m_miss_count = 0;
+	}
+}
@@ -6,14 +6,13 @@
 #include <array>
 #include <boost/endian/conversion.hpp>
 #include <boost/format.hpp>
-#include <boost/iostreams/copy.hpp>
-#include <boost/iostreams/device/array.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
-#include <boost/iostreams/filtering_streambuf.hpp>
 #include <cstring>
 #include <founder_graphs/bgzip_reader.hh>
 #include <founder_graphs/utility.hh>
 #include <libbio/file_handling.hh>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <zlib.h>
 
 namespace lb		= libbio;
 namespace ios		= boost::iostreams;
@@ -53,6 +52,131 @@ namespace {
 	)};
 	
 	
+	// Sizes from the specification, see Section 4.1. The BGZF compression format in https://samtools.github.io/hts-specs/SAMv1.pdf
+	constexpr static inline std::size_t const BGZF_HEADER_SIZE{12};	// Up to and including XLEN.
+	constexpr static inline std::size_t const BGZF_FOOTER_SIZE{8};	// CRC32 and ISIZE.
+	
+	
+	// zlib stream for inflating raw deflate data. Reused for all the blocks inflated in one thread.
+	class inflate_stream
+	{
+	protected:
+		z_stream	m_stream{};
+		
+	public:
+		inflate_stream()
+		{
+			// Negative window bits for raw deflate, i.e. no zlib or gzip header.
+			if (Z_OK != inflateInit2(&m_stream, -15))
+				throw std::runtime_error("Unable to initialise zlib.");
+		}
+		
+		~inflate_stream() { inflateEnd(&m_stream); }
+		
+		inflate_stream(inflate_stream const &) = delete;
+		inflate_stream &operator=(inflate_stream const &) = delete;
+		
+		void inflate(std::span <char const> input, std::span <char> output);
+	};
+	
+	
+	void inflate_stream::inflate(std::span <char const> input, std::span <char> output)
+	{
+		if (Z_OK != inflateReset(&m_stream))
+			throw std::runtime_error("Unable to reset the zlib stream.");
+		
+		// zlib does not modify the input even though next_in is not const.
+		m_stream.next_in = reinterpret_cast <Bytef *>(const_cast <char *>(input.data()));
+		m_stream.avail_in = input.size();
+		m_stream.next_out = reinterpret_cast <Bytef *>(output.data());
+		m_stream.avail_out = output.size();
+		
+		auto const res(::inflate(&m_stream, Z_FINISH));
+		if (Z_STREAM_END != res)
+			throw std::runtime_error(boost::str(boost::format("Unable to inflate a BGZF block (%d)") % res));
+		
+		libbio_always_assert_eq(0, m_stream.avail_out);
+	}
+	
+	
+	template <typename t_uint>
+	inline t_uint read_little_endian(char const *data)
+	{
+		t_uint val{};
+		std::memcpy(&val, data, sizeof(t_uint));
+		return endian::little_to_native(val);
+	}
+	
+	
+	// Inflate consecutive BGZF blocks from input to output. The sizes of the blocks are determined from the
+	// BSIZE subfield, so the blocks need not be separated by a gzip stream parser.
+	std::size_t inflate_bgzf_blocks(std::span <char const> input, std::span <char> output, bool const should_verify_checksums)
+	{
+		thread_local inflate_stream stream;
+		
+		std::size_t retval{};
+		while (!input.empty())
+		{
+			// Check the header.
+			libbio_always_assert_lte(BGZF_HEADER_SIZE, input.size());
+			auto const *header(input.data());
+			if (! (0x1f == std::uint8_t(header[0]) && 0x8b == std::uint8_t(header[1]) && 8 == header[2] && (0x4 & header[3])))
+				throw std::runtime_error("Unexpected BGZF block header.");
+			
+			// Find the BC subfield.
+			auto const xlen(read_little_endian <std::uint16_t>(header + 10));
+			libbio_always_assert_lte(BGZF_HEADER_SIZE + xlen, input.size());
+			std::size_t block_size{};
+			{
+				auto const *extra(header + BGZF_HEADER_SIZE);
+				std::size_t pos{};
+				while (pos + 4 <= xlen)
+				{
+					auto const slen(read_little_endian <std::uint16_t>(extra + pos + 2));
+					if ('B' == extra[pos] && 'C' == extra[pos + 1] && 2 == slen)
+					{
+						block_size = 1 + read_little_endian <std::uint16_t>(extra + pos + 4);
+						break;
+					}
+					
+					pos += 4 + slen;
+				}
+				
+				if (!block_size)
+					throw std::runtime_error("BSIZE subfield not found in BGZF block.");
+			}
+			
+			libbio_always_assert_lte(BGZF_HEADER_SIZE + xlen + BGZF_FOOTER_SIZE, block_size);
+			libbio_always_assert_lte(block_size, input.size());
+			
+			// Read the footer.
+			auto const *footer(header + block_size - BGZF_FOOTER_SIZE);
+			auto const expected_crc(read_little_endian <std::uint32_t>(footer));
+			auto const uncompressed_size(read_little_endian <std::uint32_t>(footer + 4));
+			libbio_always_assert_lte(uncompressed_size, output.size());
+			
+			// Inflate.
+			auto const cdata(input.subspan(BGZF_HEADER_SIZE + xlen, block_size - BGZF_HEADER_SIZE - xlen - BGZF_FOOTER_SIZE));
+			auto const block_output(output.first(uncompressed_size));
+			if (uncompressed_size)
+				stream.inflate(cdata, block_output);
+			
+			if (should_verify_checksums)
+			{
+				auto const crc(crc32(crc32(0, nullptr, 0), reinterpret_cast <Bytef const *>(block_output.data()), block_output.size()));
+				if (crc != expected_crc)
+					throw std::runtime_error("CRC32 mismatch in BGZF block.");
+			}
+			
+			input = input.subspan(block_size);
+			output = output.subspan(uncompressed_size);
+			retval += uncompressed_size;
+		}
+		
+		return retval;
+	}
+	
+	
 	inline std::uint64_t read_uint64(lb::file_istream &stream)
 	{
 		std::uint64_t val{};
@@ -126,6 +250,78 @@ namespace {
 
 namespace founder_graphs {
 	
+	memory_mapping::memory_mapping(lb::file_handle const &handle, std::size_t const size)
+	{
+		if (!size)
+			return;
+		
+		auto const res(::mmap(nullptr, size, PROT_READ, MAP_SHARED, handle.get(), 0));
+		if (MAP_FAILED == res)
+			throw std::runtime_error(std::strerror(errno));
+		
+		m_data = static_cast <char const *>(res);
+		m_size = size;
+	}
+	
+	
+	void memory_mapping::unmap()
+	{
+		if (m_data)
+		{
+			::munmap(const_cast <char *>(m_data), m_size);
+			m_data = nullptr;
+			m_size = 0;
+		}
+	}
+	
+	
+	void memory_mapping::advise(std::size_t const offset, std::size_t const length, int const advice) const
+	{
+		if (!m_data)
+			return;
+		
+		// The address needs to be page-aligned.
+		static std::size_t const page_size(::sysconf(_SC_PAGESIZE));
+		libbio_assert_lte(offset + length, m_size);
+		auto const aligned_offset(offset - offset % page_size);
+		// The advice is only a hint, so the return value is ignored.
+		::madvise(const_cast <char *>(m_data) + aligned_offset, length + (offset - aligned_offset), advice);
+	}
+	
+	
+	void bgzip_reader::advise_access_pattern(bgzip_access_pattern const pattern) const
+	{
+		switch (pattern)
+		{
+			case bgzip_access_pattern::normal:
+				m_mapping.advise(0, m_mapping.size(), MADV_NORMAL);
+				break;
+			
+			case bgzip_access_pattern::sequential:
+				m_mapping.advise(0, m_mapping.size(), MADV_SEQUENTIAL);
+				break;
+			
+			case bgzip_access_pattern::reverse:
+				// There is no advice for reading backwards. Disable the read-ahead (which would read the wrong pages)
+				// and rely on advise_will_need() instead.
+				m_mapping.advise(0, m_mapping.size(), MADV_RANDOM);
+				break;
+		}
+	}
+	
+	
+	void bgzip_reader::advise_will_need(std::size_t const block, std::size_t const count) const
+	{
+		if (m_mapping.empty())
+			return;
+		
+		libbio_assert_lt(count + block, m_index_entries.size());
+		auto const offset(m_index_entries[block].compressed_offset);
+		auto const next_offset(m_index_entries[count + block].compressed_offset);
+		m_mapping.advise(offset, next_offset - offset, MADV_WILLNEED);
+	}
+	
+	
 	void bgzip_reader::open(std::string const &path)
 	{
 		auto const index_path(boost::str(boost::format("%s.gzi") % path));
@@ -147,6 +343,8 @@ namespace founder_graphs {
 		
 		m_handle = std::move(handle);
 		m_preferred_block_size = preferred_block_size;
+		if (bgzip_access_mode::mmap == m_access_mode)
+			m_mapping = memory_mapping(m_handle, compressed_size);
 		
 		// Read the contents of the index.
 		lb::file_istream index_stream(index_handle.get(), ios::never_close_handle);
@@ -160,8 +358,9 @@ namespace founder_graphs {
 			m_index_entries.emplace_back(compressed_offset, uncompressed_offset);
 		}
 		
+		// Sentinel. If the file only contains the EOF marker, the first entry already marks the end.
+		if (BGZIP_EOF_MARKER.size() < compressed_size)
 		{
-			// Sentinel
 			auto const sentinel_compressed_offset(compressed_size - BGZIP_EOF_MARKER.size());
 			auto const sentinel_uncompressed_offset(
 				4 <= sentinel_compressed_offset
@@ -181,52 +380,51 @@ namespace founder_graphs {
 	
 	
 	void bgzip_reader::read_blocks(std::size_t const count)
+	{
+		m_input = read_blocks(m_current_block, count, m_input_buffer);
+		m_last_read_count = count;
+	}
+	
+	
+	auto bgzip_reader::read_blocks(std::size_t const block, std::size_t const count, std::vector <char> &input_buffer) const -> input_span_type
 	{
 		// Read the compressed block.
-		libbio_assert_lt(count + m_current_block, m_index_entries.size());
-		auto const offset(m_index_entries[m_current_block].compressed_offset);
-		auto const next_offset(m_index_entries[count + m_current_block].compressed_offset);
+		libbio_assert_lt(count + block, m_index_entries.size());
+		auto const offset(m_index_entries[block].compressed_offset);
+		auto const next_offset(m_index_entries[count + block].compressed_offset);
 		libbio_assert_lt(offset, next_offset);
 		auto const length(next_offset - offset);
-		m_input_buffer.resize(length);
-		read_from_file(m_handle, offset, length, m_input_buffer.data());
-		m_last_read_count = count;
+		
+		// Use the mapped data directly if possible.
+		if (!m_mapping.empty())
+		{
+			libbio_assert_lte(next_offset, m_mapping.size());
+			return input_span_type(m_mapping.data() + offset, length);
+		}
+		
+		input_buffer.resize(length);
+		read_from_file(m_handle, offset, length, input_buffer.data());
+		return input_span_type(input_buffer.data(), length);
 	}
 	
 	
 	std::size_t bgzip_reader::decompress(std::span <char> output_buffer) const
 	{
-		ios::filtering_streambuf <ios::input> in;
-		in.push(ios::gzip_decompressor());
-		in.push(ios::array_source(m_input_buffer.data(), m_input_buffer.size()));
-		
-		auto const retval(ios::read(in, output_buffer.data(), output_buffer.size()));
-		// There should be no more compressed data available.
-		// The filtering stream buffer is not seekable (but this seems to be the easiest way to 
-		// decompress a gzip block), so we use the uncompressed size stored in the input.
-		libbio_always_assert_eq(block_uncompressed_size(m_last_read_count), retval);
-		
-		return retval;
+		return decompress(m_current_block, m_last_read_count, m_input, output_buffer);
 	}
 	
 	
-	void check_matching_bgzip_index_entries(std::vector <bgzip_reader> const &readers)
+	std::size_t bgzip_reader::decompress(
+		std::size_t const block,
+		std::size_t const count,
+		input_span_type const input,
+		std::span <char> output_buffer
+	) const
 	{
-		// FIXME: at least the assumption that the indices have the same numbers of blocks does not seem to be valid. This might affect reverse_msa_reader. I could just replace it with msa_reader.
-		// Check for matching index entries.
-		auto const &first_handle(readers.front());
-		auto const &first_entries(first_handle.index_entries());
-		auto const first_count(first_handle.block_count());
-		for (std::size_t i(1); i < readers.size(); ++i)
-			libbio_always_assert_eq(readers[i].block_count(), first_count);
+		auto const retval(inflate_bgzf_blocks(input, output_buffer, m_should_verify_checksums));
+		libbio_always_assert_lt(count + block, m_index_entries.size());
+		libbio_always_assert_eq(m_index_entries[count + block].uncompressed_offset - m_index_entries[block].uncompressed_offset, retval);
 		
-		for (std::size_t i(0); i < first_count; ++i)
-		{
-			for (std::size_t j(1); j < readers.size(); ++j)
-			{
-				auto const &entries(readers[j].index_entries());
-				libbio_always_assert_eq(first_entries[i].uncompressed_offset, entries[i].uncompressed_offset);
-			}
-		}
+		return retval;
 	}
 }
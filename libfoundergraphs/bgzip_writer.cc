@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <array>
+#include <boost/endian/conversion.hpp>
+#include <boost/format.hpp>
+#include <cstdint>
+#include <cstring>
+#include <founder_graphs/bgzip_writer.hh>
+#include <libbio/assert.hh>
+#include <stdexcept>
+#include <zlib.h>
+
+namespace endian	= boost::endian;
+
+
+namespace {
+	
+	// Header with the BC subfield, see Section 4.1. The BGZF compression format in https://samtools.github.io/hts-specs/SAMv1.pdf
+	// BSIZE is filled in when the block has been compressed.
+	constexpr static inline std::array <std::uint8_t, 18> const BGZF_HEADER{
+		0x1f, 0x8b, 0x08, 0x04,	// ID1, ID2, CM, FLG
+		0x00, 0x00, 0x00, 0x00,	// MTIME
+		0x00, 0xff,				// XFL, OS
+		0x06, 0x00,				// XLEN
+		'B', 'C', 0x02, 0x00,	// SI1, SI2, SLEN
+		0x00, 0x00				// BSIZE
+	};
+	constexpr static inline std::size_t const BGZF_BSIZE_OFFSET{16};
+	constexpr static inline std::size_t const BGZF_FOOTER_SIZE{8};	// CRC32 and ISIZE.
+	constexpr static inline std::size_t const BGZF_EOF_MARKER_SIZE{28};
+	
+	
+	// zlib stream for producing raw deflate data. Reused for all the blocks compressed in one thread.
+	class deflate_stream
+	{
+	protected:
+		z_stream	m_stream{};
+		int			m_compression_level{Z_DEFAULT_COMPRESSION};
+		
+	public:
+		deflate_stream()
+		{
+			// Negative window bits for raw deflate, i.e. no zlib or gzip header.
+			if (Z_OK != deflateInit2(&m_stream, m_compression_level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY))
+				throw std::runtime_error("Unable to initialise zlib.");
+		}
+		
+		~deflate_stream() { deflateEnd(&m_stream); }
+		
+		deflate_stream(deflate_stream const &) = delete;
+		deflate_stream &operator=(deflate_stream const &) = delete;
+		
+		std::size_t deflate(std::span <char const> input, std::span <char> output, int const compression_level);
+	};
+	
+	
+	std::size_t deflate_stream::deflate(std::span <char const> input, std::span <char> output, int const compression_level)
+	{
+		if (Z_OK != deflateReset(&m_stream))
+			throw std::runtime_error("Unable to reset the zlib stream.");
+		
+		// deflateParams() may be called right after deflateReset() without flushing anything.
+		if (compression_level != m_compression_level)
+		{
+			if (Z_OK != deflateParams(&m_stream, compression_level, Z_DEFAULT_STRATEGY))
+				throw std::runtime_error("Unable to set the compression level.");
+			m_compression_level = compression_level;
+		}
+		
+		// zlib does not modify the input even though next_in is not const.
+		m_stream.next_in = reinterpret_cast <Bytef *>(const_cast <char *>(input.data()));
+		m_stream.avail_in = input.size();
+		m_stream.next_out = reinterpret_cast <Bytef *>(output.data());
+		m_stream.avail_out = output.size();
+		
+		auto const res(::deflate(&m_stream, Z_FINISH));
+		if (Z_STREAM_END != res)
+			throw std::runtime_error(boost::str(boost::format("Unable to deflate a BGZF block (%d)") % res));
+		
+		return output.size() - m_stream.avail_out;
+	}
+	
+	
+	template <typename t_uint>
+	inline void write_little_endian(t_uint val, char *dst)
+	{
+		val = endian::native_to_little(val);
+		std::memcpy(dst, &val, sizeof(t_uint));
+	}
+}
+
+
+namespace founder_graphs {
+	
+	std::size_t compress_bgzf_block(std::span <char const> const input, std::span <char> const output, int const compression_level)
+	{
+		thread_local deflate_stream stream;
+		
+		libbio_always_assert_lte(input.size(), BGZF_BLOCK_UNCOMPRESSED_MAX_SIZE);
+		libbio_always_assert_lte(BGZF_BLOCK_MAX_SIZE, output.size());
+		
+		std::copy(BGZF_HEADER.begin(), BGZF_HEADER.end(), output.begin());
+		auto const cdata_size(stream.deflate(input, output.subspan(BGZF_HEADER.size(), BGZF_BLOCK_MAX_SIZE - BGZF_HEADER.size() - BGZF_FOOTER_SIZE), compression_level));
+		auto const block_size(BGZF_HEADER.size() + cdata_size + BGZF_FOOTER_SIZE);
+		libbio_assert_lte(block_size, BGZF_BLOCK_MAX_SIZE);
+		
+		// BSIZE is the total block size minus one.
+		auto const crc(crc32(crc32(0, nullptr, 0), reinterpret_cast <Bytef const *>(input.data()), input.size()));
+		write_little_endian(std::uint16_t(block_size - 1), output.data() + BGZF_BSIZE_OFFSET);
+		write_little_endian(std::uint32_t(crc), output.data() + BGZF_HEADER.size() + cdata_size);
+		write_little_endian(std::uint32_t(input.size()), output.data() + BGZF_HEADER.size() + cdata_size + 4);
+		
+		return block_size;
+	}
+	
+	
+	void write_bgzf_eof_marker(std::ostream &os)
+	{
+		// The marker is an empty block compressed with the default settings.
+		std::array <char, BGZF_BLOCK_MAX_SIZE> buffer;
+		auto const size(compress_bgzf_block(std::span <char const>{}, buffer, Z_DEFAULT_COMPRESSION));
+		libbio_always_assert_eq(BGZF_EOF_MARKER_SIZE, size);
+		os.write(buffer.data(), size);
+	}
+	
+	
+	void write_bgzip_index(std::ostream &os, index_entry_vector const &entries)
+	{
+		libbio_always_assert(!entries.empty());
+		libbio_always_assert_eq(0, entries.front().compressed_offset);
+		libbio_always_assert_eq(0, entries.front().uncompressed_offset);
+		
+		auto const write_uint64([&os](std::uint64_t const val){
+			char buffer[8];
+			write_little_endian(val, buffer);
+			os.write(buffer, 8);
+		});
+		
+		write_uint64(entries.size() - 1);
+		for (std::size_t i(1); i < entries.size(); ++i)
+		{
+			write_uint64(entries[i].compressed_offset);
+			write_uint64(entries[i].uncompressed_offset);
+		}
+	}
+}
@@ -315,19 +315,53 @@ namespace founder_graphs::founder_graph_indices {
 	void read_optimized_segmentation(
 		char const *sequence_list_path,
 		char const *segmentation_path,
-		bool const input_is_bgzipped,
+		msa_format const input_format,
+		std::size_t const read_ahead_block_count,
+		std::size_t const block_cache_size,
+		bgzip_access_mode const access_mode,
 		block_graph &gr
 	)
 	{
-		if (input_is_bgzipped)
+		switch (input_format)
 		{
-			bgzip_msa_reader reader;
-			read_optimized_segmentation_(reader, sequence_list_path, segmentation_path, gr);
-		}
-		else
-		{
-			text_msa_reader reader;
-			read_optimized_segmentation_(reader, sequence_list_path, segmentation_path, gr);
+			case msa_format::text:
+			{
+				text_msa_reader reader;
+				read_optimized_segmentation_(reader, sequence_list_path, segmentation_path, gr);
+				break;
+			}
+			
+			case msa_format::bgzip:
+			{
+				if (block_cache_size)
+				{
+					bgzip_random_access_msa_reader reader;
+					reader.set_cache(std::make_shared <bgzip_block_cache>(block_cache_size));
+					reader.set_access_mode(access_mode);
+					read_optimized_segmentation_(reader, sequence_list_path, segmentation_path, gr);
+					break;
+				}
+				
+				bgzip_msa_reader reader;
+				reader.set_read_ahead_block_count(read_ahead_block_count);
+				reader.set_access_mode(access_mode);
+				read_optimized_segmentation_(reader, sequence_list_path, segmentation_path, gr);
+				break;
+			}
+			
+			case msa_format::packed:
+			{
+				packed_msa_reader reader;
+				read_optimized_segmentation_(reader, sequence_list_path, segmentation_path, gr);
+				break;
+			}
+			
+			case msa_format::fasta:
+			{
+				fasta_msa_reader reader;
+				read_optimized_segmentation_(reader, sequence_list_path, segmentation_path, gr);
+				break;
+			}
 		}
 	}
 	
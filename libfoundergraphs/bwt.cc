@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <cstdint>
+#include <founder_graphs/bwt.hh>
+#include <founder_graphs/partition.hh>
+#include <libbio/assert.hh>
+
+
+namespace founder_graphs {
+	
+	void construct_bwt_parallel(
+		sdsl::int_vector <8> const &text_,
+		sdsl::int_vector <0> const &sa,
+		sdsl::int_vector <8> &bwt_,
+		std::size_t const partition_count
+	)
+	{
+		libbio_always_assert_lt(0, partition_count);
+		libbio_always_assert_eq(text_.size(), sa.size());
+		
+		auto const size(text_.size());
+		bwt_ = sdsl::int_vector <8>(size, 0);
+		if (0 == size)
+			return;
+		
+		libbio_always_assert_eq(0, text_[size - 1]);
+		
+		// The characters are stored in separate bytes, so the tasks may write to any position.
+		auto const *text(reinterpret_cast <std::uint8_t const *>(text_.data()));
+		auto *bwt(reinterpret_cast <std::uint8_t *>(bwt_.data()));
+		for_each_partition(size, partition_count, 1, [&](std::size_t const lb, std::size_t const rb){
+			for (std::size_t i(lb); i < rb; ++i)
+			{
+				std::size_t const pos(sa[i]);
+				bwt[i] = text[pos ? pos - 1 : size - 1];
+			}
+		});
+	}
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <cereal/archives/portable_binary.hpp>
+#include <founder_graphs/cst.hh>
+#include <libbio/file_handling.hh>
+
+namespace lb = libbio;
+
+
+namespace founder_graphs {
+	
+	void read_cst(char const *path, cst_variant &cst)
+	{
+		{
+			lb::file_istream stream;
+			lb::open_file_for_reading(path, stream);
+			cereal::PortableBinaryInputArchive archive(stream);
+			
+			// Unversioned CSTs begin with the data of the CSA, the first eight bytes of which
+			// are not equal to CST_MAGIC in practice.
+			std::uint64_t header{};
+			archive(header);
+			
+			if (CST_MAGIC == header)
+			{
+				std::uint64_t version{};
+				std::uint8_t flavour_{};
+				archive(version);
+				if (CST_FORMAT_VERSION < version)
+					throw std::runtime_error("Unsupported CST format version");
+				
+				archive(CEREAL_NVP(flavour_));
+				emplace_cst(cst, cst_flavour(flavour_));
+				std::visit([&archive](auto &cst_){ archive(cst_); }, cst);
+				return;
+			}
+		}
+		
+		// Read the file again from the beginning.
+		lb::file_istream stream;
+		lb::open_file_for_reading(path, stream);
+		cereal::PortableBinaryInputArchive archive(stream);
+		archive(cst.emplace <cst_type>());
+	}
+}
@@ -0,0 +1,671 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <founder_graphs/external_suffix_array.hh>
+#include <founder_graphs/partition.hh>
+#include <founder_graphs/utility.hh>
+#include <libbio/assert.hh>
+#include <libbio/dispatch.hh>
+#include <libbio/file_handle.hh>
+#include <libbio/file_handling.hh>
+#include <optional>
+#include <sdsl/int_vector.hpp>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace fg	= founder_graphs;
+namespace fs	= std::filesystem;
+namespace lb	= libbio;
+
+
+namespace {
+	
+	typedef std::uint64_t	word_type;
+	
+	constexpr static inline std::size_t const WORD_BITS{64};
+	constexpr static inline std::size_t const IO_BUFFER_WORDS{128 * 1024};
+	constexpr static inline std::size_t const OCC_SAMPLE_RATE{64};
+	
+	
+	// Writes the values in the format of sdsl::int_vector <0>, i.e. the size in bits, the width and the packed values.
+	class packed_writer
+	{
+	protected:
+		std::ostream				*m_os{};
+		std::vector <word_type>		m_buffer;
+		word_type					m_word{};
+		std::size_t					m_expected_count{};
+		std::size_t					m_count{};
+		std::uint8_t				m_width{};
+		std::uint8_t				m_used_bits{};
+		
+	public:
+		packed_writer(std::ostream &os, std::size_t const count, std::uint8_t const width):
+			m_os(&os),
+			m_expected_count(count),
+			m_width(width)
+		{
+			libbio_assert_lte(1, width);
+			libbio_assert_lte(width, WORD_BITS);
+			
+			std::uint64_t const bit_count(count * width);
+			m_os->write(reinterpret_cast <char const *>(&bit_count), sizeof(bit_count));
+			m_os->write(reinterpret_cast <char const *>(&m_width), sizeof(m_width));
+			m_buffer.reserve(IO_BUFFER_WORDS);
+		}
+		
+		void push_back(word_type const val);
+		void finish();
+		
+	protected:
+		void push_word(word_type const word);
+	};
+	
+	
+	void packed_writer::push_word(word_type const word)
+	{
+		m_buffer.push_back(word);
+		if (m_buffer.size() == IO_BUFFER_WORDS)
+		{
+			m_os->write(reinterpret_cast <char const *>(m_buffer.data()), m_buffer.size() * sizeof(word_type));
+			m_buffer.clear();
+		}
+	}
+	
+	
+	void packed_writer::push_back(word_type const val)
+	{
+		libbio_assert_lt(m_count, m_expected_count);
+		libbio_assert(WORD_BITS == m_width || 0 == (val >> m_width));
+		++m_count;
+		
+		m_word |= val << m_used_bits;
+		m_used_bits += m_width;
+		if (WORD_BITS <= m_used_bits)
+		{
+			push_word(m_word);
+			m_used_bits -= WORD_BITS;
+			m_word = (m_used_bits ? val >> (m_width - m_used_bits) : 0);
+		}
+	}
+	
+	
+	void packed_writer::finish()
+	{
+		libbio_always_assert_eq(m_count, m_expected_count);
+		if (m_used_bits)
+			push_word(m_word);
+		
+		m_os->write(reinterpret_cast <char const *>(m_buffer.data()), m_buffer.size() * sizeof(word_type));
+		m_buffer.clear();
+		*m_os << std::flush;
+	}
+	
+	
+	// Reads the values written by packed_writer in order.
+	class packed_reader
+	{
+	protected:
+		lb::file_handle				m_handle;
+		std::vector <word_type>		m_buffer;
+		std::size_t					m_file_pos{};
+		std::size_t					m_file_size{};
+		std::size_t					m_buffer_pos{};
+		std::size_t					m_bit_pos{};	// Within the current word.
+		std::uint8_t				m_width{};
+		
+	public:
+		explicit packed_reader(std::string const &path);
+		
+		word_type next();
+		
+	protected:
+		void fill_buffer();
+	};
+	
+	
+	packed_reader::packed_reader(std::string const &path):
+		m_handle(lb::open_file_for_reading(path))
+	{
+		std::uint64_t bit_count{};
+		fg::read_from_file(m_handle, 0, sizeof(bit_count), reinterpret_cast <char *>(&bit_count));
+		fg::read_from_file(m_handle, sizeof(bit_count), sizeof(m_width), reinterpret_cast <char *>(&m_width));
+		libbio_always_assert_lte(1, m_width);
+		
+		m_file_pos = sizeof(bit_count) + sizeof(m_width);
+		m_file_size = m_file_pos + (bit_count + WORD_BITS - 1) / WORD_BITS * sizeof(word_type);
+		fill_buffer();
+	}
+	
+	
+	void packed_reader::fill_buffer()
+	{
+		auto const count(std::min(IO_BUFFER_WORDS, (m_file_size - m_file_pos) / sizeof(word_type)));
+		m_buffer.resize(count);
+		fg::read_from_file(m_handle, m_file_pos, count * sizeof(word_type), reinterpret_cast <char *>(m_buffer.data()));
+		m_file_pos += count * sizeof(word_type);
+		m_buffer_pos = 0;
+	}
+	
+	
+	word_type packed_reader::next()
+	{
+		if (m_buffer_pos == m_buffer.size())
+			fill_buffer();
+		
+		libbio_assert_lt(m_buffer_pos, m_buffer.size());
+		auto const mask(WORD_BITS == m_width ? ~word_type(0) : (word_type(1) << m_width) - 1);
+		word_type retval(m_buffer[m_buffer_pos] >> m_bit_pos);
+		m_bit_pos += m_width;
+		if (WORD_BITS <= m_bit_pos)
+		{
+			++m_buffer_pos;
+			m_bit_pos -= WORD_BITS;
+			if (m_bit_pos)
+			{
+				if (m_buffer_pos == m_buffer.size())
+					fill_buffer();
+				retval |= m_buffer[m_buffer_pos] << (m_width - m_bit_pos);
+			}
+		}
+		
+		return retval & mask;
+	}
+	
+	
+	// Writes bits in order.
+	class bit_file_writer
+	{
+	protected:
+		lb::file_ostream			m_stream;
+		std::vector <word_type>		m_buffer;
+		word_type					m_word{};
+		std::size_t					m_bit_pos{};
+		
+	public:
+		explicit bit_file_writer(std::string const &path)
+		{
+			lb::open_file_for_writing(path, m_stream, lb::writing_open_mode::CREATE);
+			m_buffer.reserve(IO_BUFFER_WORDS);
+		}
+		
+		void push_back(bool const bit)
+		{
+			m_word |= word_type(bit) << m_bit_pos;
+			if (WORD_BITS == ++m_bit_pos)
+				flush_word();
+		}
+		
+		void finish();
+		
+	protected:
+		void flush_word();
+	};
+	
+	
+	void bit_file_writer::flush_word()
+	{
+		m_buffer.push_back(m_word);
+		m_word = 0;
+		m_bit_pos = 0;
+		if (m_buffer.size() == IO_BUFFER_WORDS)
+		{
+			m_stream.write(reinterpret_cast <char const *>(m_buffer.data()), m_buffer.size() * sizeof(word_type));
+			m_buffer.clear();
+		}
+	}
+	
+	
+	void bit_file_writer::finish()
+	{
+		if (m_bit_pos)
+			flush_word();
+		
+		m_stream.write(reinterpret_cast <char const *>(m_buffer.data()), m_buffer.size() * sizeof(word_type));
+		m_buffer.clear();
+		m_stream << std::flush;
+	}
+	
+	
+	// Reads the bits written by bit_file_writer. Caches the words around the most
+	// recently read position, so sequential access is efficient in either direction.
+	class bit_file_reader
+	{
+	protected:
+		lb::file_handle				m_handle;
+		std::vector <word_type>		m_buffer;
+		std::size_t					m_word_count{};
+		std::size_t					m_buffer_start{SIZE_MAX};	// In words.
+		
+	public:
+		explicit bit_file_reader(std::string const &path):
+			m_handle(lb::open_file_for_reading(path))
+		{
+			auto const [file_size, preferred_block_size] = fg::check_file_size(m_handle);
+			m_word_count = file_size / sizeof(word_type);
+		}
+		
+		bool operator[](std::size_t const idx);
+	};
+	
+	
+	bool bit_file_reader::operator[](std::size_t const idx)
+	{
+		auto const word_idx(idx / WORD_BITS);
+		libbio_assert_lt(word_idx, m_word_count);
+		if (! (m_buffer_start <= word_idx && word_idx < m_buffer_start + m_buffer.size()))
+		{
+			m_buffer_start = word_idx / IO_BUFFER_WORDS * IO_BUFFER_WORDS;
+			m_buffer.resize(std::min(IO_BUFFER_WORDS, m_word_count - m_buffer_start));
+			fg::read_from_file(m_handle, m_buffer_start * sizeof(word_type), m_buffer.size() * sizeof(word_type), reinterpret_cast <char *>(m_buffer.data()));
+		}
+		
+		return (m_buffer[word_idx - m_buffer_start] >> (idx % WORD_BITS)) & 0x1;
+	}
+	
+	
+	// The text with the zero character appended, as character ranks.
+	class ranked_text
+	{
+	protected:
+		std::span <char const>							m_text;
+		fg::external_suffix_array_builder::rank_array	const *m_ranks{};
+		
+	public:
+		ranked_text(std::span <char const> const text, fg::external_suffix_array_builder::rank_array const &ranks):
+			m_text(text),
+			m_ranks(&ranks)
+		{
+		}
+		
+		std::size_t size() const { return 1 + m_text.size(); }
+		std::uint8_t operator[](std::size_t const pos) const { return pos < m_text.size() ? (*m_ranks)[std::uint8_t(m_text[pos])] : 0; }
+	};
+	
+	
+	// Compute the Z-function of text[pattern_lb, pattern_lb + pattern_length).
+	void z_function(ranked_text const &text, std::size_t const pattern_lb, std::size_t const pattern_length, std::vector <std::uint32_t> &z)
+	{
+		z.resize(pattern_length);
+		if (0 == pattern_length)
+			return;
+		
+		z[0] = pattern_length;
+		std::size_t lb(0), rb(0);
+		for (std::size_t k(1); k < pattern_length; ++k)
+		{
+			std::size_t ll(0);
+			if (k < rb)
+				ll = std::min(std::size_t(z[k - lb]), rb - k);
+			
+			while (k + ll < pattern_length && text[pattern_lb + k + ll] == text[pattern_lb + ll])
+				++ll;
+			
+			z[k] = ll;
+			if (rb < k + ll)
+			{
+				lb = k;
+				rb = k + ll;
+			}
+		}
+	}
+	
+	
+	// Call fn(pos, lcp) for each pos in [lb, rb), where lcp is the length of the longest
+	// common prefix of text[pos..] and the pattern text[pattern_lb, pattern_lb + z.size()).
+	// Text positions are accessed in increasing order except within the current match,
+	// the length of which is limited by the pattern length.
+	template <typename t_fn>
+	void match_pattern(ranked_text const &text, std::size_t const pattern_lb, std::vector <std::uint32_t> const &z, std::size_t const lb, std::size_t const rb, t_fn &&fn)
+	{
+		auto const pattern_length(z.size());
+		auto const text_size(text.size());
+		std::size_t match_lb(0), match_rb(0); // text[match_lb, match_rb) equals a prefix of the pattern.
+		for (std::size_t pos(lb); pos < rb; ++pos)
+		{
+			std::size_t ll(0);
+			if (pos < match_rb)
+			{
+				ll = std::min(std::size_t(z[pos - match_lb]), match_rb - pos);
+				if (ll < match_rb - pos)
+				{
+					fn(pos, ll);
+					continue;
+				}
+			}
+			
+			while (ll < pattern_length && pos + ll < text_size && text[pos + ll] == text[pattern_lb + ll])
+				++ll;
+			
+			if (match_rb < pos + ll)
+			{
+				match_lb = pos;
+				match_rb = pos + ll;
+			}
+			
+			fn(pos, ll);
+		}
+	}
+	
+	
+	std::string temporary_path(std::string const &directory, char const *kind, std::size_t const idx)
+	{
+		return (fs::path(directory) / ("founder-graphs-sa-" + std::to_string(::getpid()) + "-" + std::to_string(idx) + kind)).string();
+	}
+	
+	
+	// State for handling one block.
+	struct block_context
+	{
+		ranked_text const				&text;
+		std::size_t						block_lb{};
+		std::size_t						block_rb{};
+		std::size_t						alphabet_size{};
+		std::string const				*gt_path{};				// Order w.r.t. text[block_rb..]; null for the rightmost block.
+		std::string const				*tail_sa_path{};		// Suffix array of the suffixes that start after the block.
+		
+		std::size_t block_size() const { return block_rb - block_lb; }
+		bool is_rightmost() const { return !gt_path; }
+		
+		void prepare_block_string(std::vector <std::uint8_t> &dst) const;
+		void count_gaps(std::vector <std::int32_t> const &block_sa, std::vector <std::uint64_t> &gaps) const;
+		void merge(std::vector <std::int32_t> const &block_sa, std::vector <std::uint64_t> const &gaps, packed_writer &writer) const;
+		void write_gt(std::string const &path) const;
+	};
+	
+	
+	void block_context::prepare_block_string(std::vector <std::uint8_t> &dst) const
+	{
+		auto const size(block_size());
+		dst.resize(size);
+		
+		if (is_rightmost())
+		{
+			// The block ends with the unique zero character.
+			for (std::size_t i(0); i < size; ++i)
+				dst[i] = text[block_lb + i];
+			return;
+		}
+		
+		// Replace each character c followed by the suffix at p with 3c + h(p), where h(p) is 0 or 2 depending
+		// on whether the suffix at p is smaller or greater than the one at block_rb, and h(block_rb) = 1.
+		// Comparing the modified suffixes then gives the order of the complete suffixes, and none of them
+		// is a prefix of another.
+		for (std::size_t i(0); i < size; ++i)
+			dst[i] = 3 * text[block_lb + i];
+		dst[size - 1] += 1;
+		
+		// Compare the suffixes within the block to the suffix at block_rb. If text[p, block_rb) matches
+		// text[block_rb, 2 block_rb - p), the order is that of the suffixes at block_rb and 2 block_rb - p.
+		std::vector <std::uint32_t> z;
+		z_function(text, block_rb, std::min(size, text.size() - block_rb), z);
+		bit_file_reader gt(*gt_path);
+		match_pattern(text, block_rb, z, block_lb + 1, block_rb, [&](std::size_t const pos, std::size_t const lcp){
+			bool is_greater{};
+			if (lcp < block_rb - pos)
+				is_greater = (text[block_rb + lcp] < text[pos + lcp]);
+			else
+				is_greater = !gt[block_rb - pos];
+			
+			if (is_greater)
+				dst[pos - block_lb - 1] += 2;
+		});
+	}
+	
+	
+	void block_context::count_gaps(std::vector <std::int32_t> const &block_sa, std::vector <std::uint64_t> &gaps) const
+	{
+		auto const size(block_size());
+		auto const none(alphabet_size);
+		
+		// BWT of the block and the counts of the characters.
+		std::vector <std::uint8_t> bwt(size);
+		std::vector <std::uint64_t> cumulative_counts(1 + alphabet_size, 0);
+		for (std::size_t i(0); i < size; ++i)
+		{
+			auto const pos(block_sa[i]);
+			bwt[i] = (pos ? text[block_lb + pos - 1] : none);
+			++cumulative_counts[1 + text[block_lb + i]];
+		}
+		
+		for (std::size_t i(1); i < cumulative_counts.size(); ++i)
+			cumulative_counts[i] += cumulative_counts[i - 1];
+		
+		// Sample the occurrences.
+		auto const sample_count(1 + size / OCC_SAMPLE_RATE);
+		std::vector <std::uint32_t> occ_samples(sample_count * alphabet_size, 0);
+		{
+			std::vector <std::uint32_t> counts(1 + alphabet_size, 0);
+			for (std::size_t i(0); i < size; ++i)
+			{
+				if (0 == i % OCC_SAMPLE_RATE)
+					std::copy_n(counts.begin(), alphabet_size, occ_samples.begin() + i / OCC_SAMPLE_RATE * alphabet_size);
+				++counts[bwt[i]];
+			}
+			
+			if (0 == size % OCC_SAMPLE_RATE)
+				std::copy_n(counts.begin(), alphabet_size, occ_samples.begin() + size / OCC_SAMPLE_RATE * alphabet_size);
+		}
+		
+		auto const occ([&](std::uint8_t const cc, std::size_t const idx) -> std::size_t {
+			auto const sample_idx(idx / OCC_SAMPLE_RATE);
+			auto retval(occ_samples[sample_idx * alphabet_size + cc]);
+			for (std::size_t i(sample_idx * OCC_SAMPLE_RATE); i < idx; ++i)
+				retval += (bwt[i] == cc);
+			return retval;
+		});
+		
+		// Determine the rank of each tail suffix among the suffixes of the block with backward search.
+		// The last character of the block precedes the first tail suffix, so it is handled separately.
+		gaps.clear();
+		gaps.resize(1 + size, 0);
+		auto const last_cc(text[block_rb - 1]);
+		bit_file_reader gt(*gt_path);
+		std::size_t rank(0); // The zero character is the smallest.
+		++gaps[rank];
+		for (std::size_t pos(text.size() - 1); block_rb < pos--;)
+		{
+			auto const cc(text[pos]);
+			rank = cumulative_counts[cc] + occ(cc, rank) + (last_cc == cc && gt[pos + 1 - block_rb]);
+			++gaps[rank];
+		}
+	}
+	
+	
+	void block_context::merge(std::vector <std::int32_t> const &block_sa, std::vector <std::uint64_t> const &gaps, packed_writer &writer) const
+	{
+		auto const size(block_size());
+		if (is_rightmost())
+		{
+			for (auto const pos : block_sa)
+				writer.push_back(block_lb + pos);
+			return;
+		}
+		
+		packed_reader tail_sa(*tail_sa_path);
+		for (std::size_t i(0); i <= size; ++i)
+		{
+			for (std::size_t j(0); j < gaps[i]; ++j)
+				writer.push_back(tail_sa.next());
+			
+			if (i < size)
+				writer.push_back(block_lb + block_sa[i]);
+		}
+	}
+	
+	
+	void block_context::write_gt(std::string const &path) const
+	{
+		// Compare the suffixes after block_lb to the one at block_lb. If text[pos, pos + block_size())
+		// matches the block, the order is that of the suffixes at pos + block_size() and block_rb.
+		auto const size(block_size());
+		std::vector <std::uint32_t> z;
+		z_function(text, block_lb, size, z);
+		
+		std::optional <bit_file_reader> gt;
+		if (!is_rightmost())
+			gt.emplace(*gt_path);
+		
+		bit_file_writer writer(path);
+		writer.push_back(false); // block_lb itself.
+		match_pattern(text, block_lb, z, block_lb + 1, text.size(), [&](std::size_t const pos, std::size_t const lcp){
+			if (lcp < size)
+				writer.push_back(text[block_lb + lcp] < text[pos + lcp]);
+			else
+			{
+				// The rightmost block ends with the zero character, so it cannot match elsewhere.
+				libbio_assert(gt);
+				writer.push_back((*gt)[pos + size - block_rb]);
+			}
+		});
+		writer.finish();
+	}
+}
+
+
+namespace founder_graphs {
+	
+	external_suffix_array_builder::external_suffix_array_builder(
+		std::span <char const> const text,
+		std::string temporary_directory,
+		external_suffix_array_block_sorter &sorter
+	):
+		m_text(text),
+		m_temporary_directory(std::move(temporary_directory)),
+		m_sorter(&sorter)
+	{
+		// Determine the alphabet.
+		std::array <std::atomic_bool, 256> is_present{};
+		for_each_partition(m_text.size(), std::max(1U, std::thread::hardware_concurrency()), 1, [this, &is_present](std::size_t const lb, std::size_t const rb){
+			std::array <bool, 256> is_present_{};
+			for (std::size_t i(lb); i < rb; ++i)
+				is_present_[std::uint8_t(m_text[i])] = true;
+			
+			for (std::size_t i(0); i < is_present_.size(); ++i)
+			{
+				if (is_present_[i])
+					is_present[i].store(true, std::memory_order_relaxed);
+			}
+		});
+		
+		if (is_present[0])
+			throw std::runtime_error("The input contains a zero character.");
+		
+		m_alphabet_size = 1;
+		for (std::size_t i(1); i < is_present.size(); ++i)
+		{
+			if (is_present[i])
+				m_ranks[i] = m_alphabet_size++;
+		}
+		
+		// The modified alphabet needs to fit in a byte.
+		if (256 < 3 * m_alphabet_size)
+			throw std::runtime_error("The input contains more than 84 distinct characters.");
+	}
+	
+	
+	std::size_t external_suffix_array_builder::block_size_for_memory_budget(std::size_t const memory_budget) const
+	{
+		// The block string and the BWT take one byte per character, the block suffix array
+		// and the Z-function four bytes, the gap array eight bytes and the occurrence samples
+		// four bytes per character of the alphabet and OCC_SAMPLE_RATE characters.
+		auto const bytes_per_character(1 + 1 + 4 + 4 + 8 + (4 * m_alphabet_size + OCC_SAMPLE_RATE - 1) / OCC_SAMPLE_RATE);
+		return std::clamp(memory_budget / bytes_per_character, std::size_t(1), std::size_t(INT32_MAX));
+	}
+	
+	
+	void external_suffix_array_builder::build(std::size_t const block_size, std::ostream &os)
+	{
+		libbio_always_assert_lt(0, block_size);
+		libbio_always_assert_lte(block_size, INT32_MAX);
+		
+		ranked_text const text(m_text, m_ranks);
+		auto const text_size(text.size());
+		auto const width(sdsl::bits::hi(text_size) + 1); // As in sdsl::construct_sa.
+		
+		std::string tail_sa_path;
+		std::string gt_path;
+		std::vector <std::uint8_t> block_string;
+		std::vector <std::int32_t> block_sa;
+		std::vector <std::uint64_t> gaps;
+		std::size_t block_idx(0);
+		
+		auto const queue(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
+		lb::dispatch_ptr <dispatch_group_t> group(dispatch_group_create());
+		
+		std::size_t block_rb(text_size);
+		while (block_rb)
+		{
+			auto const block_lb(block_rb < block_size ? 0 : block_rb - block_size);
+			block_context const ctx{
+				text,
+				block_lb,
+				block_rb,
+				m_alphabet_size,
+				(gt_path.empty() ? nullptr : &gt_path),
+				(tail_sa_path.empty() ? nullptr : &tail_sa_path)
+			};
+			
+			// Sort the suffixes of the block.
+			ctx.prepare_block_string(block_string);
+			block_sa.resize(ctx.block_size());
+			m_sorter->sort_block(block_string, block_sa);
+			block_string.clear();
+			
+			// Determine the order w.r.t. the suffix at block_lb for the next block in the background.
+			std::string next_gt_path;
+			if (block_lb)
+			{
+				next_gt_path = temporary_path(m_temporary_directory, ".gt", block_idx);
+				lb::dispatch_group_async_fn(*group, queue, [&ctx, &next_gt_path](){
+					ctx.write_gt(next_gt_path);
+				});
+			}
+			
+			// Merge with the suffixes that start after the block.
+			if (!ctx.is_rightmost())
+				ctx.count_gaps(block_sa, gaps);
+			
+			if (block_lb)
+			{
+				auto const next_tail_sa_path(temporary_path(m_temporary_directory, ".sa", block_idx));
+				lb::file_ostream stream;
+				lb::open_file_for_writing(next_tail_sa_path, stream, lb::writing_open_mode::CREATE);
+				packed_writer writer(stream, text_size - block_lb, width);
+				ctx.merge(block_sa, gaps, writer);
+				writer.finish();
+				
+				dispatch_group_wait(*group, DISPATCH_TIME_FOREVER);
+				
+				if (!tail_sa_path.empty())
+					fs::remove(tail_sa_path);
+				if (!gt_path.empty())
+					fs::remove(gt_path);
+				
+				tail_sa_path = next_tail_sa_path;
+				gt_path = next_gt_path;
+			}
+			else
+			{
+				packed_writer writer(os, text_size, width);
+				ctx.merge(block_sa, gaps, writer);
+				writer.finish();
+				
+				if (!tail_sa_path.empty())
+					fs::remove(tail_sa_path);
+				if (!gt_path.empty())
+					fs::remove(gt_path);
+			}
+			
+			block_rb = block_lb;
+			++block_idx;
+		}
+	}
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <array>
+#include <boost/format.hpp>
+#include <charconv>
+#include <founder_graphs/fasta_msa.hh>
+#include <founder_graphs/utility.hh>
+#include <libbio/file_handling.hh>
+#include <stdexcept>
+#include <string_view>
+#include <sys/mman.h>
+
+namespace fg	= founder_graphs;
+namespace lb	= libbio;
+
+
+namespace {
+	
+	std::size_t parse_field(std::string_view const field, std::size_t const line_number)
+	{
+		std::size_t retval{};
+		auto const res(std::from_chars(field.data(), field.data() + field.size(), retval));
+		if (std::errc{} != res.ec || res.ptr != field.data() + field.size())
+			throw std::runtime_error(boost::str(boost::format("Unable to parse the FASTA index on line %d") % line_number));
+		return retval;
+	}
+}
+
+
+namespace founder_graphs {
+	
+	void fasta_msa::open(std::string const &path)
+	{
+		open(path, boost::str(boost::format("%s.fai") % path));
+	}
+	
+	
+	void fasta_msa::open(std::string const &path, std::string const &index_path)
+	{
+		read_index(index_path);
+		
+		m_handle = lb::open_file_for_reading(path);
+		auto const [file_size, preferred_block_size] = check_file_size(m_handle);
+		
+		// Check that the rows are inside the file.
+		for (auto const &entry : m_rows)
+		{
+			if (entry.length && file_size <= entry.byte_offset(entry.length - 1))
+				throw std::runtime_error(boost::str(boost::format("Row “%s” extends past the end of the FASTA file") % entry.name));
+		}
+		
+		m_mapping = memory_mapping(m_handle, file_size);
+	}
+	
+	
+	void fasta_msa::read_index(std::string const &index_path)
+	{
+		lb::file_istream stream;
+		lb::open_file_for_reading(index_path, stream);
+		
+		m_rows.clear();
+		std::string line;
+		std::size_t line_number{};
+		while (std::getline(stream, line))
+		{
+			++line_number;
+			if (line.empty())
+				continue;
+			
+			// Split.
+			std::array <std::string_view, 5> fields;
+			std::string_view rest(line);
+			for (std::size_t i(0); i < fields.size(); ++i)
+			{
+				auto const pos(rest.find('\t'));
+				if (std::string_view::npos == pos && i + 1 < fields.size())
+					throw std::runtime_error(boost::str(boost::format("Expected five fields on line %d of the FASTA index") % line_number));
+				
+				fields[i] = rest.substr(0, pos);
+				rest = (std::string_view::npos == pos ? std::string_view() : rest.substr(1 + pos));
+			}
+			
+			auto &entry(m_rows.emplace_back());
+			entry.name = fields[0];
+			entry.length = parse_field(fields[1], line_number);
+			entry.offset = parse_field(fields[2], line_number);
+			entry.line_bases = parse_field(fields[3], line_number);
+			entry.line_width = parse_field(fields[4], line_number);
+			if (0 == entry.line_bases || entry.line_width < entry.line_bases)
+				throw std::runtime_error(boost::str(boost::format("Unexpected line length on line %d of the FASTA index") % line_number));
+		}
+		
+		if (m_rows.empty())
+			throw std::runtime_error("The FASTA index is empty.");
+		
+		// All the rows need to have the same length.
+		m_aligned_size = m_rows.front().length;
+		for (auto const &entry : m_rows)
+		{
+			if (entry.length != m_aligned_size)
+				throw std::runtime_error(boost::str(boost::format("Row “%s” has length %d while the first row has length %d") % entry.name % entry.length % m_aligned_size));
+		}
+	}
+	
+	
+	void fasta_msa::advise_access_pattern(bgzip_access_pattern const pattern) const
+	{
+		switch (pattern)
+		{
+			case bgzip_access_pattern::normal:
+				m_mapping.advise(0, m_mapping.size(), MADV_NORMAL);
+				break;
+			
+			case bgzip_access_pattern::sequential:
+				// The rows are read in parallel, so the access pattern is not sequential within the file.
+				// Rely on advise_will_need() instead.
+			case bgzip_access_pattern::reverse:
+				m_mapping.advise(0, m_mapping.size(), MADV_RANDOM);
+				break;
+		}
+	}
+	
+	
+	void fasta_msa::advise_will_need(std::size_t const lb, std::size_t const rb) const
+	{
+		libbio_assert_lte(lb, rb);
+		libbio_assert_lte(rb, m_aligned_size);
+		if (lb == rb)
+			return;
+		
+		for (auto const &entry : m_rows)
+		{
+			auto const offset(entry.byte_offset(lb));
+			m_mapping.advise(offset, entry.byte_offset(rb - 1) + 1 - offset, MADV_WILLNEED);
+		}
+	}
+}
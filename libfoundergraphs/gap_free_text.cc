@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <algorithm>
+#include <founder_graphs/gap_free_text.hh>
+#include <founder_graphs/msa_index_builder.hh>
+#include <libbio/assert.hh>
+#include <libbio/file_handling.hh>
+#include <string>
+#include <vector>
+
+namespace fg	= founder_graphs;
+namespace lb	= libbio;
+
+
+namespace {
+	
+	class gap_free_text_writer final : public fg::msa_index_builder_delegate
+	{
+	protected:
+		sdsl::int_vector <8>	*m_text{};
+		std::size_t				m_sequence_count{};
+		std::size_t				m_size{};
+		
+	public:
+		gap_free_text_writer(sdsl::int_vector <8> &text, std::size_t const sequence_count):
+			m_text(&text),
+			m_sequence_count(sequence_count)
+		{
+		}
+		
+		void output_sequence(fg::msa_index_sequence const &seq) override;
+		void finish() { m_text->resize(m_size); }
+	};
+	
+	
+	void gap_free_text_writer::output_sequence(fg::msa_index_sequence const &seq)
+	{
+		// The aligned sequences have the same length, so the size of the first one gives an upper bound for the text length.
+		if (0 == m_size)
+			m_text->resize(m_sequence_count * (1 + seq.size));
+		
+		auto *dst(reinterpret_cast <char *>(m_text->data()) + m_size);
+		*dst++ = '#';
+		for (auto const &chunk : seq.gap_free_chunks)
+			dst = std::copy(chunk.begin(), chunk.end(), dst);
+		
+		m_size = dst - reinterpret_cast <char *>(m_text->data());
+		libbio_assert_lte(m_size, m_text->size());
+	}
+}
+
+
+namespace founder_graphs {
+	
+	std::size_t read_gap_free_text(
+		char const *sequence_list_path,
+		bool const input_is_gzipped,
+		std::size_t const buffer_count,
+		sdsl::int_vector <8> &text
+	)
+	{
+		std::vector <std::string> paths;
+		{
+			lb::file_istream stream;
+			lb::open_file_for_reading(sequence_list_path, stream);
+			
+			std::string line;
+			while (std::getline(stream, line))
+				paths.push_back(line);
+		}
+		
+		gap_free_text_writer writer(text, paths.size());
+		msa_index_builder builder(writer, buffer_count, 0.0, input_is_gzipped, true, false);
+		for (auto const &path : paths)
+			builder.submit(path);
+		builder.finish();
+		writer.finish();
+		
+		return paths.size();
+	}
+}
@@ -74,33 +74,28 @@ namespace {
 			
 			if (!bwt_path)
 			{
-				// FIXME: The BWT transform below produces incorrect results under some conditions.
-				// Same as with the suffix array.
+				// Same as with the suffix array. SDSL expects the BWT to be stored as an int_vector, so it is written
+				// with int_vector_buffer. The text is memory-mapped and the suffix array streamed s.t. neither is
+				// loaded into memory.
 				lb::log_time(std::cerr) << "Building BWT…\n"; 
 				sdsl::read_only_mapper <8> text(text_path, true, false);
 				auto const text_size(text.size());
 				
 				std::size_t const buffer_size(1024U * 1024U * 512U); // Same as in SDSL, multiple of 8.
 				sdsl::int_vector_buffer <> sa_buf(sa_path, std::ios::in, buffer_size);
+				libbio_always_assert_eq(sa_buf.size(), text_size);
 				
 				auto const fname(sdsl::cache_file_name(sdsl::conf::KEY_BWT, config));
 				lb::log_time(std::cerr) << "Writing to " << fname << '\n';
-				std::vector <char> bwt(text_size, 0);
-				
-				for (std::size_t i(0); i < text_size; ++i)
-				{
-					auto const pos(sa_buf[i]);
-					auto const idx(pos ? pos - 1 : text.size() - 1);
-					libbio_assert_lt(idx, text.size());
-					//libbio_assert_lt(i, bwt.size()); // Not true for int_vector_buffer.
-					auto const cc(text[idx]);
-					bwt[i] = cc;
-					//std::cerr << i << '\t' << pos << '\t' << text[idx] << '\t' << int(text[idx]) << '\n';
-				}
-
 				{
-					std::ofstream bwt_stream(fname);
-					std::copy(bwt.begin(), bwt.end(), std::ostream_iterator <char>(bwt_stream));
+					sdsl::int_vector_buffer <8> bwt_buf(fname, std::ios::out, buffer_size);
+					for (std::size_t i(0); i < text_size; ++i)
+					{
+						auto const pos(sa_buf[i]);
+						auto const idx(pos ? pos - 1 : text_size - 1);
+						libbio_assert_lt(idx, text_size);
+						bwt_buf.push_back(text[idx]);
+					}
 				}
 				
 				config.file_map[sdsl::conf::KEY_BWT] = fname;
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <founder_graphs/lcp.hh>
+#include <founder_graphs/partition.hh>
+#include <libbio/assert.hh>
+#include <sdsl/io.hpp>
+#include <stdexcept>
+#include <vector>
+
+namespace fg	= founder_graphs;
+
+
+namespace {
+	
+	template <typename t_phi>
+	void construct_lcp_parallel_(
+		sdsl::int_vector <8> const &text_,
+		sdsl::int_vector <0> const &sa,
+		sdsl::int_vector <0> &lcp,
+		std::size_t const partition_count
+	)
+	{
+		auto const size(text_.size());
+		auto const *text(reinterpret_cast <std::uint8_t const *>(text_.data()));
+		
+		// Store the preceding suffix of each suffix in lexicographic order.
+		// Since the suffix array is a permutation, the tasks write to distinct positions.
+		std::vector <t_phi> phi(size);
+		fg::for_each_partition(size, partition_count, 1, [&](std::size_t const lb, std::size_t const rb){
+			for (std::size_t i(lb); i < rb; ++i)
+				phi[sa[i]] = (0 == i ? size : sa[i - 1]);
+		});
+		
+		// Replace Φ with the permuted LCP array. Each part starts from zero, after
+		// which PLCP[i + 1] ≥ PLCP[i] - 1 holds. The text is zero-terminated, so the
+		// comparison stops at the end.
+		std::atomic <std::size_t> max_lcp{};
+		fg::for_each_partition(size, partition_count, 1, [&](std::size_t const lb, std::size_t const rb){
+			std::size_t ll{};
+			std::size_t max_ll{};
+			for (std::size_t i(lb); i < rb; ++i)
+			{
+				std::size_t const j(phi[i]);
+				if (size == j)
+					ll = 0;
+				else
+				{
+					while (text[i + ll] == text[j + ll])
+						++ll;
+				}
+				
+				phi[i] = ll;
+				max_ll = std::max(max_ll, ll);
+				if (ll)
+					--ll;
+			}
+			
+			auto expected(max_lcp.load(std::memory_order_relaxed));
+			while (expected < max_ll && !max_lcp.compare_exchange_weak(expected, max_ll, std::memory_order_relaxed))
+				;
+		});
+		
+		// Permute to suffix array order.
+		lcp = sdsl::int_vector <0>(size, 0, sdsl::bits::hi(std::max(std::size_t(1), max_lcp.load())) + 1);
+		fg::for_each_partition(size, partition_count, 64, [&](std::size_t const lb, std::size_t const rb){
+			for (std::size_t i(lb); i < rb; ++i)
+				lcp[i] = phi[sa[i]];
+		});
+	}
+}
+
+
+namespace founder_graphs {
+	
+	void construct_lcp_parallel(
+		sdsl::int_vector <8> const &text,
+		sdsl::int_vector <0> const &sa,
+		sdsl::int_vector <0> &lcp,
+		std::size_t const partition_count
+	)
+	{
+		libbio_always_assert_lt(0, partition_count);
+		libbio_always_assert_eq(text.size(), sa.size());
+		libbio_always_assert(0 == text.size() || 0 == text[text.size() - 1]);
+		
+		// The comparison in the Φ loop relies on the terminator being the only zero character.
+		if (text.size())
+		{
+			auto const *data(reinterpret_cast <std::uint8_t const *>(text.data()));
+			auto const *last(data + text.size() - 1);
+			if (std::find(data, last, 0) != last)
+				throw std::runtime_error("The text contains a zero character before the terminator.");
+		}
+		
+		// Use 32-bit values for Φ if possible. The value equal to the text length denotes the first suffix.
+		if (text.size() < UINT32_MAX)
+			construct_lcp_parallel_ <std::uint32_t>(text, sa, lcp, partition_count);
+		else
+			construct_lcp_parallel_ <std::uint64_t>(text, sa, lcp, partition_count);
+	}
+	
+	
+	void construct_lcp_parallel(sdsl::cache_config &config, std::size_t const partition_count)
+	{
+		sdsl::int_vector <0> lcp;
+		
+		{
+			sdsl::int_vector <8> text;
+			sdsl::int_vector <0> sa;
+			libbio_always_assert(sdsl::load_from_cache(text, sdsl::conf::KEY_TEXT, config));
+			libbio_always_assert(sdsl::load_from_cache(sa, sdsl::conf::KEY_SA, config));
+			construct_lcp_parallel(text, sa, lcp, partition_count);
+		}
+		
+		sdsl::store_to_cache(lcp, sdsl::conf::KEY_LCP, config);
+	}
+}
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <founder_graphs/msa_index.hh>
+
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+
+namespace {
+	
+	constexpr static inline std::size_t const WORD_BITS{64};
+	
+	
+	inline std::uint64_t gap_mask(char const *text, std::size_t const count)
+	{
+		std::uint64_t retval{};
+		for (std::size_t i(0); i < count; ++i)
+			retval |= std::uint64_t('-' == text[i]) << i;
+		return retval;
+	}
+	
+	
+	// Compare 64 characters at a time; bit i of the result corresponds to text[i].
+	inline std::uint64_t gap_mask_word(char const *text)
+	{
+#if defined(__SSE2__)
+		auto const gap(_mm_set1_epi8('-'));
+		std::uint64_t retval{};
+		for (std::size_t i(0); i < 4; ++i)
+		{
+			auto const xx(_mm_loadu_si128(reinterpret_cast <__m128i const *>(text + 16 * i)));
+			std::uint64_t const mask(std::uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(xx, gap))));
+			retval |= mask << (16 * i);
+		}
+		return retval;
+#else
+		return gap_mask(text, WORD_BITS);
+#endif
+	}
+	
+	
+	inline void set_bits_atomic(std::uint64_t &word, std::uint64_t const mask)
+	{
+		if (mask)
+			std::atomic_ref(word).fetch_or(mask, std::memory_order_relaxed);
+	}
+	
+	
+	// Find the first position at or after pos with the given bit value, or vec.size() if there is none.
+	template <bool t_value>
+	std::size_t find_next(sdsl::bit_vector const &vec, std::size_t const pos)
+	{
+		auto const size(vec.size());
+		if (size <= pos)
+			return size;
+		
+		auto const *data(vec.data());
+		auto word_idx(pos / WORD_BITS);
+		auto word(t_value ? data[word_idx] : ~data[word_idx]);
+		word &= ~std::uint64_t(0) << (pos % WORD_BITS);
+		while (!word)
+		{
+			++word_idx;
+			if (size <= word_idx * WORD_BITS)
+				return size;
+			word = (t_value ? data[word_idx] : ~data[word_idx]);
+		}
+		
+		return std::min(size, word_idx * WORD_BITS + std::countr_zero(word));
+	}
+	
+	
+	// Call cb with the starting position and the length of each run of set bits.
+	template <typename t_cb>
+	void for_each_run(sdsl::bit_vector const &vec, t_cb &&cb)
+	{
+		std::size_t pos{};
+		while (true)
+		{
+			auto const run_start(find_next <true>(vec, pos));
+			if (run_start == vec.size())
+				break;
+			
+			pos = find_next <false>(vec, run_start);
+			cb(run_start, pos - run_start);
+		}
+	}
+}
+
+
+namespace founder_graphs {
+	
+	std::size_t mark_gaps(std::span <char const> const text, std::uint64_t *words, std::size_t pos)
+	{
+		std::size_t retval{};
+		auto it(text.data());
+		auto const end(it + text.size());
+		
+		// Partially covered word at the beginning.
+		if (auto const offset(pos % WORD_BITS); offset && it != end)
+		{
+			auto const count(std::min(std::size_t(end - it), WORD_BITS - offset));
+			auto const mask(gap_mask(it, count));
+			set_bits_atomic(words[pos / WORD_BITS], mask << offset);
+			retval += std::popcount(mask);
+			it += count;
+			pos += count;
+		}
+		
+		// Whole words are not shared with other ranges.
+		while (WORD_BITS <= std::size_t(end - it))
+		{
+			auto const mask(gap_mask_word(it));
+			words[pos / WORD_BITS] |= mask;
+			retval += std::popcount(mask);
+			it += WORD_BITS;
+			pos += WORD_BITS;
+		}
+		
+		// Partially covered word at the end.
+		if (it != end)
+		{
+			auto const mask(gap_mask(it, end - it));
+			set_bits_atomic(words[pos / WORD_BITS], mask);
+			retval += std::popcount(mask);
+		}
+		
+		return retval;
+	}
+	
+	
+	run_length_gap_vector::run_length_gap_vector(sdsl::bit_vector const &vec)
+	{
+		for_each_run(vec, [this](std::size_t const, std::size_t const length){
+			++run_count;
+			gap_count += length;
+		});
+		
+		// Each run is preceded by a distinct number of non-gap characters.
+		sdsl::sd_vector_builder run_starts_builder(vec.size(), run_count);
+		sdsl::sd_vector_builder run_offsets_builder(1 + vec.size() - gap_count, run_count);
+		std::size_t gaps_before{};
+		for_each_run(vec, [&](std::size_t const run_start, std::size_t const length){
+			run_starts_builder.set(run_start);
+			run_offsets_builder.set(run_start - gaps_before);
+			gaps_before += length;
+		});
+		
+		run_starts = bit_vector_type(run_starts_builder);
+		run_offsets = bit_vector_type(run_offsets_builder);
+		prepare_rank_and_select_support();
+	}
+
+	
+	std::size_t run_length_gap_vector::size_in_bytes() const
+	{
+		return
+			sdsl::size_in_bytes(run_starts) +
+			sdsl::size_in_bytes(run_offsets) +
+			sdsl::size_in_bytes(run_starts_rank1_support) +
+			sdsl::size_in_bytes(run_starts_select1_support) +
+			sdsl::size_in_bytes(run_offsets_rank1_support) +
+			sdsl::size_in_bytes(run_offsets_select1_support) +
+			sizeof(run_count) +
+			sizeof(gap_count);
+	}
+	
+	
+	aligned_sequence_index::aligned_sequence_index(sdsl::bit_vector const &vec, double const size_slack)
+	{
+		// Build all the candidates and measure their sizes.
+		run_length_gap_vector run_length(vec);
+		rrr_gap_vector rrr(vec);
+		sd_gap_vector sd(vec);
+		rrr.prepare_rank_and_select_support();
+		sd.prepare_rank_and_select_support();
+		
+		auto const run_length_size(run_length.size_in_bytes());
+		auto const rrr_size(rrr.size_in_bytes());
+		auto const sd_size(sd.size_in_bytes());
+		auto const size_limit((1.0 + size_slack) * std::min({run_length_size, rrr_size, sd_size}));
+		
+		// Check in the order of the expected speed of select0, which is called the most.
+		// (The run-length encoded vector only needs select1 and rank1 on sd_vectors, and the
+		// select0 support of sd_vector is based on binary search.)
+		if (run_length_size <= size_limit)
+			gap_vector = std::move(run_length);
+		else if (rrr_size <= size_limit)
+			gap_vector = std::move(rrr);
+		else
+			gap_vector = std::move(sd);
+		
+		// The support structures need to be updated after moving.
+		prepare_rank_and_select_support();
+	}
+	
+	
+	aligned_sequence_index::aligned_sequence_index(sdsl::bit_vector const &vec, gap_vector_type const type)
+	{
+		switch (type)
+		{
+			case gap_vector_type::rrr:
+				gap_vector.emplace <rrr_gap_vector>(vec);
+				break;
+			
+			case gap_vector_type::sd:
+				gap_vector.emplace <sd_gap_vector>(vec);
+				break;
+			
+			case gap_vector_type::run_length:
+				gap_vector.emplace <run_length_gap_vector>(vec);
+				break;
+		}
+		
+		prepare_rank_and_select_support();
+	}
+}
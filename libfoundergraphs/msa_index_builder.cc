@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <algorithm>
+#include <filesystem>
+#include <founder_graphs/msa_index_builder.hh>
+#include <founder_graphs/sequence_reader.hh>
+#include <founder_graphs/utility.hh>
+#include <libbio/assert.hh>
+#include <libbio/file_handling.hh>
+
+namespace lb	= libbio;
+
+
+namespace founder_graphs {
+	
+	msa_index_builder::msa_index_builder(
+		msa_index_builder_delegate &delegate,
+		std::size_t const buffer_count,
+		double const size_slack,
+		bool const input_is_gzipped,
+		bool const should_remove_gaps,
+		bool const should_build_index
+	):
+		m_delegate(&delegate),
+		m_sequences(buffer_count),
+		m_concurrent_queue(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), true),
+		m_serial_queue(dispatch_queue_create("fi.iki.tsnorri.founder-graphs-semi-repeat-free.output-queue", DISPATCH_QUEUE_SERIAL)),
+		m_group(dispatch_group_create()),
+		m_sema(dispatch_semaphore_create(buffer_count)),
+		m_size_slack(size_slack),
+		m_input_is_gzipped(input_is_gzipped),
+		m_should_remove_gaps(should_remove_gaps),
+		m_should_build_index(should_build_index)
+	{
+		libbio_always_assert_lt(0, buffer_count);
+		libbio_always_assert(should_remove_gaps || should_build_index);
+	}
+	
+	
+	void msa_index_builder::submit(std::string const &path)
+	{
+		dispatch_semaphore_wait(*m_sema, DISPATCH_TIME_FOREVER);
+		auto &seq(m_sequences[m_submitted_count % m_sequences.size()]);
+		++m_submitted_count;
+		
+		seq.path = path;
+		seq.gap_count = 0;
+		
+		if (!m_input_is_gzipped)
+			submit_uncompressed(seq);
+		else if (std::filesystem::exists(path + ".gzi"))
+			submit_bgzip(seq);
+		else
+			submit_gzip(seq);
+	}
+	
+	
+	void msa_index_builder::finish()
+	{
+		dispatch_group_wait(*m_group, DISPATCH_TIME_FOREVER);
+		libbio_always_assert_eq(m_submitted_count, m_output_count);
+	}
+	
+	
+	void msa_index_builder::set_chunk_count(msa_index_sequence &seq, std::size_t const count)
+	{
+		if (m_should_remove_gaps)
+			seq.gap_free_chunks.resize(count);
+		
+		seq.remaining_chunks = count;
+		if (0 == count)
+			lb::dispatch_group_async_fn(*m_group, *m_concurrent_queue, [this, &seq](){ finish_sequence(seq); });
+	}
+	
+	
+	void msa_index_builder::handle_chunk(msa_index_sequence &seq, std::size_t const chunk_idx, std::size_t const pos, std::span <char const> const chunk)
+	{
+		if (!m_should_build_index)
+		{
+			// Count the gaps while removing them.
+			auto &dst(seq.gap_free_chunks[chunk_idx]);
+			dst.resize(chunk.size());
+			auto const end(std::remove_copy(chunk.begin(), chunk.end(), dst.begin(), '-'));
+			dst.resize(end - dst.begin());
+			seq.gap_count.fetch_add(chunk.size() - dst.size(), std::memory_order_relaxed);
+			return;
+		}
+		
+		auto const gap_count(mark_gaps(chunk, seq.gaps.data(), pos));
+		seq.gap_count.fetch_add(gap_count, std::memory_order_relaxed);
+		
+		if (m_should_remove_gaps)
+		{
+			auto &dst(seq.gap_free_chunks[chunk_idx]);
+			dst.resize(chunk.size() - gap_count);
+			std::remove_copy(chunk.begin(), chunk.end(), dst.begin(), '-');
+		}
+	}
+	
+	
+	void msa_index_builder::submit_uncompressed(msa_index_sequence &seq)
+	{
+		seq.handle = lb::file_handle(lb::open_file_for_reading(seq.path));
+		auto const [size, preferred_block_size] = check_file_size(seq.handle);
+		libbio_always_assert_lt(0, size);
+		seq.size = size;
+		if (m_should_build_index)
+			seq.gaps.assign(size, 0);
+		
+		// Read the chunks with pread so that they may be handled in any order.
+		auto const chunk_count((size + MSA_INDEX_BUILDER_CHUNK_SIZE - 1) / MSA_INDEX_BUILDER_CHUNK_SIZE);
+		set_chunk_count(seq, chunk_count);
+		for (std::size_t i(0); i < chunk_count; ++i)
+		{
+			auto const chunk_lb(i * MSA_INDEX_BUILDER_CHUNK_SIZE);
+			auto const chunk_rb(std::min(size, chunk_lb + MSA_INDEX_BUILDER_CHUNK_SIZE));
+			lb::dispatch_group_async_fn(*m_group, *m_concurrent_queue, [this, &seq, i, chunk_lb, chunk_rb](){
+				thread_local std::vector <char> buffer;
+				buffer.resize(chunk_rb - chunk_lb);
+				read_from_file(seq.handle, chunk_lb, buffer.size(), buffer.data());
+				handle_chunk(seq, i, chunk_lb, buffer);
+				chunk_done(seq);
+			});
+		}
+	}
+	
+	
+	void msa_index_builder::submit_bgzip(msa_index_sequence &seq)
+	{
+		auto &reader(seq.bgzip_input.emplace());
+		reader.open(seq.path);
+		auto const &index_entries(reader.index_entries());
+		auto const size(reader.uncompressed_size());
+		seq.size = size;
+		if (m_should_build_index)
+			seq.gaps.assign(size, 0);
+		
+		// Group the blocks s.t. each chunk has at least MSA_INDEX_BUILDER_CHUNK_SIZE characters if possible.
+		std::vector <std::size_t> chunk_bounds{0};
+		auto const block_count(reader.block_count());
+		for (std::size_t block(1); block <= block_count; ++block)
+		{
+			if (block == block_count || MSA_INDEX_BUILDER_CHUNK_SIZE <= index_entries[block].uncompressed_offset - index_entries[chunk_bounds.back()].uncompressed_offset)
+				chunk_bounds.push_back(block);
+		}
+		
+		// bgzip_reader’s const member functions do not modify its state, so the blocks may be decompressed in parallel.
+		set_chunk_count(seq, chunk_bounds.size() - 1);
+		for (std::size_t i(1); i < chunk_bounds.size(); ++i)
+		{
+			auto const block_lb(chunk_bounds[i - 1]);
+			auto const block_rb(chunk_bounds[i]);
+			lb::dispatch_group_async_fn(*m_group, *m_concurrent_queue, [this, &seq, &reader, i, block_lb, block_rb](){
+				thread_local std::vector <char> input_buffer;
+				thread_local std::vector <char> buffer;
+				auto const &index_entries(reader.index_entries());
+				auto const chunk_lb(index_entries[block_lb].uncompressed_offset);
+				buffer.resize(index_entries[block_rb].uncompressed_offset - chunk_lb);
+				auto const input(reader.read_blocks(block_lb, block_rb - block_lb, input_buffer));
+				reader.decompress(block_lb, block_rb - block_lb, input, std::span(buffer));
+				handle_chunk(seq, i - 1, chunk_lb, buffer);
+				chunk_done(seq);
+			});
+		}
+	}
+	
+	
+	void msa_index_builder::submit_gzip(msa_index_sequence &seq)
+	{
+		// Without an index, the input needs to be decompressed sequentially.
+		seq.remaining_chunks = 1;
+		lb::dispatch_group_async_fn(*m_group, *m_concurrent_queue, [this, &seq](){
+			thread_local std::vector <char> buffer;
+			buffer.resize(MSA_INDEX_BUILDER_CHUNK_SIZE);
+			
+			sequence_reader reader(seq.path);
+			std::size_t size{};
+			std::size_t chunk_idx{};
+			if (m_should_build_index)
+				seq.gaps.assign(MSA_INDEX_BUILDER_CHUNK_SIZE, 0);
+			while (auto const count = reader.read(buffer))
+			{
+				// Grow the bit vector geometrically.
+				if (m_should_build_index && seq.gaps.size() < size + count)
+					seq.gaps.resize(std::max(2 * seq.gaps.size(), size + count), 0);
+				
+				if (m_should_remove_gaps)
+					seq.gap_free_chunks.resize(1 + chunk_idx);
+				
+				handle_chunk(seq, chunk_idx, size, std::span(buffer.data(), count));
+				size += count;
+				++chunk_idx;
+			}
+			
+			if (m_should_build_index)
+				seq.gaps.resize(size);
+			seq.size = size;
+			chunk_done(seq);
+		});
+	}
+	
+	
+	void msa_index_builder::chunk_done(msa_index_sequence &seq)
+	{
+		// The last chunk builds the index.
+		if (1 == seq.remaining_chunks.fetch_sub(1, std::memory_order_acq_rel))
+			finish_sequence(seq);
+	}
+	
+	
+	void msa_index_builder::finish_sequence(msa_index_sequence &seq)
+	{
+		// Create a compressed index. The rank and select support is prepared by the move assignment.
+		if (m_should_build_index)
+			seq.index = aligned_sequence_index(seq.gaps, m_size_slack);
+		
+		// Release the resources that are no longer needed.
+		sdsl::util::clear(seq.gaps);
+		seq.handle = lb::file_handle();
+		seq.bgzip_input.reset();
+		
+		lb::dispatch_group_async_fn(*m_group, *m_serial_queue, [this, &seq](){
+			seq.is_done = true;
+			output_done();
+		});
+	}
+	
+	
+	void msa_index_builder::output_done()
+	{
+		// Output the consecutive sequences that have been handled.
+		while (true)
+		{
+			auto &seq(m_sequences[m_output_count % m_sequences.size()]);
+			if (!seq.is_done)
+				break;
+			
+			if (SIZE_MAX == m_sequence_size)
+				m_sequence_size = seq.size;
+			else
+				libbio_always_assert_eq(m_sequence_size, seq.size);
+			
+			m_delegate->output_sequence(seq);
+			
+			seq.index = aligned_sequence_index();
+			seq.gap_free_chunks.clear();
+			seq.is_done = false;
+			++m_output_count;
+			dispatch_semaphore_signal(*m_sema);
+		}
+	}
+}
@@ -3,9 +3,11 @@
  * This code is licensed under MIT license (see LICENSE for details).
  */
 
+#include <algorithm>
 #include <cstdio> // strerror
 #include <founder_graphs/msa_reader.hh>
 #include <founder_graphs/utility.hh>
+#include <libbio/dispatch/dispatch_fn.hh>
 #include <libbio/file_handling.hh>
 #include <range/v3/view/enumerate.hpp>
 #include <range/v3/view/tail.hpp>
@@ -18,6 +20,10 @@ namespace rsv	= ranges::views;
 
 namespace {
 	
+	// Number of rows handled in one task by bgzip_random_access_msa_reader.
+	constexpr static inline std::size_t const RANDOM_ACCESS_ROW_BATCH_SIZE{16};
+	
+	
 	// Check overlap w.r.t. the first range.
 	fg::range_overlap_type range_overlap(std::size_t const lb1, std::size_t const rb1, std::size_t const lb2, std::size_t const rb2)
 	{
@@ -63,6 +69,15 @@ namespace founder_graphs {
 	
 	void text_msa_reader::prepare()
 	{
+		if (m_should_use_io_uring && m_batched_reader.setup_io_uring(std::min(std::size_t(batched_file_reader::QUEUE_DEPTH_DEFAULT), std::max(std::size_t(1), m_handles.size()))))
+		{
+			std::vector <int> fds(m_handles.size());
+			std::transform(m_handles.begin(), m_handles.end(), fds.begin(), [](auto const &handle){ return handle.get(); });
+			m_batched_reader.set_files(fds);
+			m_read_requests.resize(m_handles.size());
+			return;
+		}
+		
 		m_buffers.resize(m_handles.size());
 		for (auto &buffer : m_buffers)
 		{
@@ -72,11 +87,41 @@ namespace founder_graphs {
 	}
 	
 	
+	bool text_msa_reader::fill_buffer_batched(std::size_t const lb, std::size_t const rb, fill_buffer_callback_type &cb)
+	{
+		libbio_assert_lt(lb, rb);
+		libbio_assert_lte(rb, m_aligned_size);
+		
+		// Read the range of every row directly to its final position.
+		auto const row_count(m_handles.size());
+		auto const range_len(rb - lb);
+		if (m_data.size() < row_count * range_len)
+		{
+			// The buffer needs to be registered again if reallocated.
+			m_data.resize(row_count * range_len);
+			m_batched_reader.register_buffer(m_data);
+		}
+		
+		for (std::size_t i(0); i < row_count; ++i)
+		{
+			auto *dst(m_data.data() + i * range_len);
+			m_read_requests[i] = read_request{dst, lb, range_len, std::uint32_t(i)};
+			m_spans[i] = span_type(dst, range_len);
+		}
+		
+		m_batched_reader.read(m_read_requests);
+		return cb(m_spans);
+	}
+	
+	
 	bool text_msa_reader::fill_buffer(std::size_t const lb, std::size_t const rb, fill_buffer_callback_type &cb)
 	{
 		if (m_handles.empty())
 			return false;
 		
+		if (m_batched_reader.uses_io_uring())
+			return fill_buffer_batched(lb, rb, cb);
+		
 		auto const range_len(rb - lb);
 		auto characters_left(range_len);
 		auto buffer_size(m_buffers.front().size());
@@ -141,10 +186,20 @@ namespace founder_graphs {
 	}
 	
 	
+	bgzip_msa_reader::~bgzip_msa_reader()
+	{
+		// The tasks refer to the buffers.
+		if (m_read_ahead_group)
+			dispatch_group_wait(*m_read_ahead_group, DISPATCH_TIME_FOREVER);
+	}
+	
+	
 	void bgzip_msa_reader::add_file(std::string const &path)
 	{
 		auto &handle(m_handles.emplace_back());
+		handle.set_access_mode(m_access_mode);
 		handle.open(path);
+		handle.advise_access_pattern(bgzip_access_pattern::sequential);
 	}
 	
 	
@@ -155,6 +210,11 @@ namespace founder_graphs {
 		
 		// Prepare the decompression group.
 		m_decompress_group.reset(dispatch_group_create());
+		if (m_read_ahead_block_count)
+		{
+			m_read_ahead_group.reset(dispatch_group_create());
+			m_read_ahead_buffers.resize(m_handles.size());
+		}
 		
 		// Initialize the other vectors.
 		m_current_block_ranges.resize(m_handles.size());
@@ -163,6 +223,77 @@ namespace founder_graphs {
 	}
 	
 	
+	void bgzip_msa_reader::decompress_blocks(std::size_t const handle_idx, std::size_t block_lb, std::size_t const block_rb, std::span <char> buffer)
+	{
+		libbio_assert_lt(block_lb, block_rb);
+		auto &handle(m_handles[handle_idx]);
+		
+		// Use the blocks that have been read in advance if possible.
+		if (m_read_ahead_block_count)
+		{
+			auto const &ra_buffer(m_read_ahead_buffers[handle_idx]);
+			if (ra_buffer.block_lb == block_lb && ra_buffer.block_lb < ra_buffer.block_rb)
+			{
+				auto const &index_entries(handle.index_entries());
+				auto const copy_rb(std::min(block_rb, ra_buffer.block_rb));
+				auto const size(index_entries[copy_rb].uncompressed_offset - index_entries[block_lb].uncompressed_offset);
+				libbio_assert_lte(size, buffer.size());
+				libbio_assert_lte(size, ra_buffer.buffer.size());
+				std::copy_n(ra_buffer.buffer.begin(), size, buffer.begin());
+				buffer = buffer.subspan(size);
+				block_lb = copy_rb;
+			}
+		}
+		
+		// Read the rest.
+		if (block_lb < block_rb)
+		{
+			handle.block_seek(block_lb);
+			handle.read_blocks(block_rb - block_lb);
+			handle.decompress(buffer);
+		}
+	}
+	
+	
+	void bgzip_msa_reader::start_read_ahead()
+	{
+		// Read the blocks that follow the current range, since the ranges are typically requested from left to right.
+		auto const queue(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
+		for (std::size_t i(0); i < m_handles.size(); ++i)
+		{
+			auto const &handle(m_handles[i]);
+			auto const &current_range(m_current_block_ranges[i]);
+			auto &ra_buffer(m_read_ahead_buffers[i]);
+			auto const block_lb(current_range.block_rb);
+			auto const block_rb(std::min(block_lb + m_read_ahead_block_count, handle.block_count()));
+			if (block_rb <= block_lb)
+				continue;
+			
+			// Check if the blocks have already been read.
+			if (ra_buffer.block_lb == block_lb && block_rb <= ra_buffer.block_rb)
+				continue;
+			
+			auto const &index_entries(handle.index_entries());
+			ra_buffer.block_lb = block_lb;
+			ra_buffer.block_rb = block_rb;
+			ra_buffer.buffer.resize(index_entries[block_rb].uncompressed_offset - index_entries[block_lb].uncompressed_offset);
+			
+			// We only write to the i-th read-ahead buffer, and bgzip_reader’s const member functions do not modify its state, so no locking needed.
+			lb::dispatch_group_async_fn(*m_read_ahead_group, queue, [&handle, &ra_buffer, block_lb, block_rb](){
+				auto const input(handle.read_blocks(block_lb, block_rb - block_lb, ra_buffer.input_buffer));
+				handle.decompress(block_lb, block_rb - block_lb, input, std::span <char>(ra_buffer.buffer.data(), ra_buffer.buffer.size()));
+			});
+		}
+	}
+	
+	
+	void bgzip_msa_reader::wait_for_read_ahead()
+	{
+		if (0 != dispatch_group_wait(*m_read_ahead_group, DISPATCH_TIME_FOREVER))
+			throw std::runtime_error("dispatch_group_wait failed even though DISPATCH_TIME_FOREVER was specified as timeout.");
+	}
+	
+	
 	template <range_overlap_type t_overlap_type>
 	void bgzip_msa_reader::update_decompressed(
 		std::size_t const handle_idx,
@@ -199,7 +330,7 @@ namespace founder_graphs {
 			buffer.resize(uncompressed_size);
 			
 			// Decompress.
-			handle.decompress(std::span <char>(buffer.data(), buffer.size()));
+			decompress_blocks(handle_idx, block_lb, block_rb, std::span <char>(buffer.data(), buffer.size()));
 		}
 		else // LEFT_OVERLAP, RIGHT_OVERLAP
 		{
@@ -219,7 +350,7 @@ namespace founder_graphs {
 					std::move_backward(buffer.begin(), buffer.begin() + shift_amt, buffer.end());
 				
 				// Decompress.
-				handle.decompress(std::span <char>(buffer.data(), buffer.size() - shift_amt));
+				decompress_blocks(handle_idx, block_lb, range.block_lb, std::span <char>(buffer.data(), buffer.size() - shift_amt));
 			}
 			else  // RIGHT_OVERLAP
 			{
@@ -233,7 +364,7 @@ namespace founder_graphs {
 				// Decompress.
 				auto const buffer_left_pad(current_aln_rb - aln_lb);
 				buffer.resize(uncompressed_size);
-				handle.decompress(std::span <char>(buffer.data() + buffer_left_pad, buffer.size() - buffer_left_pad));
+				decompress_blocks(handle_idx, range.block_rb, block_rb, std::span <char>(buffer.data() + buffer_left_pad, buffer.size() - buffer_left_pad));
 			}
 		}
 		
@@ -249,6 +380,266 @@ namespace founder_graphs {
 	}
 	
 	
+	bgzip_random_access_msa_reader::~bgzip_random_access_msa_reader()
+	{
+		// The prefetch tasks refer to the handles.
+		if (m_prefetch_group)
+			dispatch_group_wait(*m_prefetch_group, DISPATCH_TIME_FOREVER);
+	}
+	
+	
+	void bgzip_random_access_msa_reader::add_file(std::string const &path)
+	{
+		auto &handle(m_handles.emplace_back());
+		handle.set_access_mode(m_access_mode);
+		handle.open(path);
+	}
+	
+	
+	void bgzip_random_access_msa_reader::prepare()
+	{
+		if (!m_cache)
+			m_cache = std::make_shared <bgzip_block_cache>();
+		
+		m_prefetch_group.reset(dispatch_group_create());
+		m_spans.resize(m_handles.size());
+		m_file_ids.clear();
+		
+		auto const size(aligned_size());
+		for (auto const &handle : m_handles)
+		{
+			libbio_always_assert_eq(handle.uncompressed_size(), size);
+			m_file_ids.push_back(m_cache->add_file());
+		}
+	}
+	
+	
+	bgzip_block_cache::block_ptr bgzip_random_access_msa_reader::decompressed_block(std::size_t const row, std::size_t const block) const
+	{
+		auto const &handle(m_handles[row]);
+		auto const &index_entries(handle.index_entries());
+		auto const size(index_entries[block + 1].uncompressed_offset - index_entries[block].uncompressed_offset);
+		auto retval(m_cache->get(m_file_ids[row], block, size));
+		
+		// If another thread is decompressing the block, wait for it to finish.
+		// bgzip_reader’s const member functions do not modify its state, so no other locking needed.
+		std::call_once(retval->is_decompressed, [&handle, &retval, block](){
+			thread_local std::vector <char> input_buffer;
+			auto const input(handle.read_blocks(block, 1, input_buffer));
+			handle.decompress(block, 1, input, std::span(retval->data));
+		});
+		
+		return retval;
+	}
+	
+	
+	void bgzip_random_access_msa_reader::copy_row(std::size_t const row, std::size_t const column_lb, std::size_t const column_rb, char *dst) const
+	{
+		auto const &handle(m_handles[row]);
+		auto const &index_entries(handle.index_entries());
+		auto const [block_lb, block_rb](handle.find_uncompressed_range(column_lb, column_rb));
+		for (std::size_t block(block_lb); block < block_rb; ++block)
+		{
+			auto const ptr(decompressed_block(row, block));
+			auto const block_offset(index_entries[block].uncompressed_offset);
+			auto const copy_lb(std::max(column_lb, block_offset));
+			auto const copy_rb(std::min(column_rb, index_entries[block + 1].uncompressed_offset));
+			std::copy(ptr->data.begin() + (copy_lb - block_offset), ptr->data.begin() + (copy_rb - block_offset), dst + (copy_lb - column_lb));
+		}
+	}
+	
+	
+	void bgzip_random_access_msa_reader::read(
+		std::size_t const row_lb,
+		std::size_t const row_rb,
+		std::size_t const column_lb,
+		std::size_t const column_rb,
+		std::span <char> const dst
+	)
+	{
+		libbio_assert_lte(row_lb, row_rb);
+		libbio_assert_lte(row_rb, m_handles.size());
+		libbio_assert_lte(column_lb, column_rb);
+		libbio_assert_lte(column_rb, aligned_size());
+		
+		auto const range_len(column_rb - column_lb);
+		libbio_always_assert_lte((row_rb - row_lb) * range_len, dst.size());
+		if (! (row_lb < row_rb && column_lb < column_rb))
+			return;
+		
+		// A local group makes it possible to call read() from multiple threads.
+		lb::dispatch_ptr <dispatch_group_t> group(dispatch_group_create());
+		auto const queue(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0));
+		for (std::size_t batch_lb(row_lb); batch_lb < row_rb; batch_lb += RANDOM_ACCESS_ROW_BATCH_SIZE)
+		{
+			auto const batch_rb(std::min(row_rb, batch_lb + RANDOM_ACCESS_ROW_BATCH_SIZE));
+			lb::dispatch_group_async_fn(*group, queue, [this, row_lb, column_lb, column_rb, dst, range_len, batch_lb, batch_rb](){
+				for (std::size_t row(batch_lb); row < batch_rb; ++row)
+					copy_row(row, column_lb, column_rb, dst.data() + (row - row_lb) * range_len);
+			});
+		}
+		
+		if (0 != dispatch_group_wait(*group, DISPATCH_TIME_FOREVER))
+			throw std::runtime_error("dispatch_group_wait failed even though DISPATCH_TIME_FOREVER was specified as timeout.");
+	}
+	
+	
+	void bgzip_random_access_msa_reader::prefetch(
+		std::size_t const row_lb,
+		std::size_t const row_rb,
+		std::size_t const column_lb,
+		std::size_t const column_rb
+	)
+	{
+		libbio_assert_lte(row_rb, m_handles.size());
+		libbio_assert_lte(column_rb, aligned_size());
+		if (! (row_lb < row_rb && column_lb < column_rb))
+			return;
+		
+		auto const queue(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
+		for (std::size_t batch_lb(row_lb); batch_lb < row_rb; batch_lb += RANDOM_ACCESS_ROW_BATCH_SIZE)
+		{
+			auto const batch_rb(std::min(row_rb, batch_lb + RANDOM_ACCESS_ROW_BATCH_SIZE));
+			lb::dispatch_group_async_fn(*m_prefetch_group, queue, [this, column_lb, column_rb, batch_lb, batch_rb](){
+				for (std::size_t row(batch_lb); row < batch_rb; ++row)
+				{
+					auto const [block_lb, block_rb](m_handles[row].find_uncompressed_range(column_lb, column_rb));
+					for (std::size_t block(block_lb); block < block_rb; ++block)
+						decompressed_block(row, block);
+				}
+			});
+		}
+	}
+	
+	
+	bool bgzip_random_access_msa_reader::fill_buffer(std::size_t const lb, std::size_t const rb, fill_buffer_callback_type &cb)
+	{
+		libbio_assert_lt(lb, rb);
+		
+		if (m_handles.empty())
+			return false;
+		
+		auto const row_count(m_handles.size());
+		auto const range_len(rb - lb);
+		m_data.resize(row_count * range_len);
+		read(0, row_count, lb, rb, m_data);
+		
+		// The ranges are typically requested from left to right, so decompress the blocks of the following range in the background.
+		if (m_should_prefetch_next_range)
+		{
+			// Skip the part that was already prefetched unless the reader has moved outside of it.
+			auto const next_rb(std::min(aligned_size(), rb + range_len));
+			auto const continues_prefetched_range(m_prefetched_lb <= rb && rb <= m_prefetched_rb);
+			auto const prefetch_lb(continues_prefetched_range ? m_prefetched_rb : rb);
+			if (!continues_prefetched_range)
+				m_prefetched_lb = rb;
+			
+			if (prefetch_lb < next_rb)
+			{
+				prefetch(0, row_count, prefetch_lb, next_rb);
+				m_prefetched_rb = next_rb;
+			}
+			else if (!continues_prefetched_range)
+			{
+				m_prefetched_rb = rb;
+			}
+		}
+		
+		for (std::size_t i(0); i < row_count; ++i)
+			m_spans[i] = span_type(m_data.data() + i * range_len, range_len);
+		
+		return cb(m_spans);
+	}
+	
+	
+	void packed_msa_reader::add_file(std::string const &path)
+	{
+		libbio_always_assert_msg(!m_is_open, "Only one packed MSA file may be given.");
+		m_msa.open(path);
+		m_msa.advise_access_pattern(bgzip_access_pattern::sequential);
+		m_is_open = true;
+	}
+	
+	
+	void packed_msa_reader::prepare()
+	{
+		m_spans.resize(m_msa.row_count());
+	}
+	
+	
+	bool packed_msa_reader::fill_buffer(std::size_t const lb, std::size_t const rb, fill_buffer_callback_type &cb)
+	{
+		libbio_assert_lt(lb, rb);
+		libbio_assert_lte(rb, m_msa.aligned_size());
+		
+		if (!m_is_open)
+			return false;
+		
+		// Decode the tiles that overlap with [lb, rb) directly to the rows.
+		auto const row_count(m_msa.row_count());
+		auto const range_len(rb - lb);
+		m_data.resize(row_count * range_len);
+		auto const first_tile(m_msa.tile_for_column(lb));
+		auto const last_tile(m_msa.tile_for_column(rb - 1));
+		for (std::size_t tile(first_tile); tile <= last_tile; ++tile)
+		{
+			auto const tile_lb(m_msa.tile_lb(tile));
+			auto const column_lb(std::max(lb, tile_lb) - tile_lb);
+			auto const column_rb(std::min(rb, tile_lb + m_msa.tile_size(tile)) - tile_lb);
+			m_msa.decode(tile, column_lb, column_rb, m_data.data() + (tile_lb + column_lb - lb), range_len, 1);
+		}
+		
+		for (std::size_t i(0); i < row_count; ++i)
+			m_spans[i] = span_type(m_data.data() + i * range_len, range_len);
+		
+		return cb(m_spans);
+	}
+	
+	
+	void fasta_msa_reader::add_file(std::string const &path)
+	{
+		libbio_always_assert_msg(!m_is_open, "Only one FASTA file may be given.");
+		m_msa.open(path);
+		m_msa.advise_access_pattern(bgzip_access_pattern::sequential);
+		m_is_open = true;
+	}
+	
+	
+	void fasta_msa_reader::prepare()
+	{
+		m_spans.resize(m_msa.row_count());
+	}
+	
+	
+	bool fasta_msa_reader::fill_buffer(std::size_t const lb, std::size_t const rb, fill_buffer_callback_type &cb)
+	{
+		libbio_assert_lt(lb, rb);
+		libbio_assert_lte(rb, m_msa.aligned_size());
+		
+		if (!m_is_open)
+			return false;
+		
+		// Let the kernel read all the rows in parallel, and also the following range in case the input is read sequentially.
+		auto const range_len(rb - lb);
+		if (! (m_advised_lb <= lb && rb <= m_advised_rb))
+			m_msa.advise_will_need(lb, rb);
+		m_advised_lb = rb;
+		m_advised_rb = std::min(m_msa.aligned_size(), rb + range_len);
+		m_msa.advise_will_need(m_advised_lb, m_advised_rb);
+		
+		auto const row_count(m_msa.row_count());
+		m_data.resize(row_count * range_len);
+		for (std::size_t i(0); i < row_count; ++i)
+		{
+			auto *dst(m_data.data() + i * range_len);
+			m_msa.copy(i, lb, rb, dst);
+			m_spans[i] = span_type(dst, range_len);
+		}
+		
+		return cb(m_spans);
+	}
+	
+	
 	bool bgzip_msa_reader::fill_buffer(std::size_t const lb, std::size_t const rb, fill_buffer_callback_type &cb)
 	{
 		libbio_assert_lt(lb, rb);
@@ -260,6 +651,10 @@ namespace founder_graphs {
 		libbio_assert_eq(m_handles.size(), m_spans.size());
 		libbio_assert_eq(m_handles.size(), m_buffers.size());
 		
+		// The read-ahead tasks use the handles.
+		if (m_read_ahead_block_count)
+			wait_for_read_ahead();
+		
 		// Handle each bgzip_reader separately b.c. the block boundaries can be arbitrary.
 		bool did_start_decompress{false};
 		auto const queue(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0));
@@ -295,8 +690,6 @@ namespace founder_graphs {
 					case range_overlap_type::LEFT_OVERLAP:
 					{
 						did_start_decompress = true;
-						handle.block_seek(block_lb);
-						handle.read_blocks(current_range.block_lb - block_lb);
 						dispatch_group_async(*m_decompress_group, queue, ^{
 							// Make sure everything can be copied or const-referenced, since we’re using a ^{} block.
 							update_decompressed <range_overlap_type::LEFT_OVERLAP>(i_, lb, rb, block_lb, block_rb);
@@ -307,8 +700,6 @@ namespace founder_graphs {
 					case range_overlap_type::RIGHT_OVERLAP:
 					{
 						did_start_decompress = true;
-						handle.block_seek(current_range.block_rb);
-						handle.read_blocks(block_rb - current_range.block_rb);
 						dispatch_group_async(*m_decompress_group, queue, ^{
 							// Make sure everything can be copied or const-referenced, since we’re using a ^{} block.
 							update_decompressed <range_overlap_type::RIGHT_OVERLAP>(i_, lb, rb, block_lb, block_rb);
@@ -319,8 +710,6 @@ namespace founder_graphs {
 					case range_overlap_type::DISJOINT:
 					{
 						did_start_decompress = true;
-						handle.block_seek(block_lb);
-						handle.read_blocks(block_rb - block_lb);
 						dispatch_group_async(*m_decompress_group, queue, ^{
 							// Make sure everything can be copied or const-referenced, since we’re using a ^{} block.
 							update_decompressed <range_overlap_type::DISJOINT>(i_, lb, rb, block_lb, block_rb);
@@ -344,9 +733,13 @@ namespace founder_graphs {
 			}
 		}
 		
-		if ((!did_start_decompress) || 0 == dispatch_group_wait(*m_decompress_group, DISPATCH_TIME_FOREVER))
-			return cb(m_spans);
-		else
+		if (did_start_decompress && 0 != dispatch_group_wait(*m_decompress_group, DISPATCH_TIME_FOREVER))
 			throw std::runtime_error("dispatch_group_wait failed even though DISPATCH_TIME_FOREVER was specified as timeout.");
+		
+		// Read the following blocks while the callback is being run.
+		if (m_read_ahead_block_count)
+			start_read_ahead();
+		
+		return cb(m_spans);
 	}
 }
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <algorithm>
+#include <boost/endian/conversion.hpp>
+#include <cstring>
+#include <founder_graphs/packed_msa.hh>
+#include <founder_graphs/utility.hh>
+#include <libbio/assert.hh>
+#include <libbio/file_handling.hh>
+#include <stdexcept>
+#include <sys/mman.h>
+
+namespace endian	= boost::endian;
+namespace fg		= founder_graphs;
+namespace lb		= libbio;
+
+
+namespace {
+	
+	// Characters of both nibbles of each byte.
+	struct decode_table
+	{
+		std::array <std::array <char, 2>, 256>	pairs{};
+		
+		constexpr decode_table()
+		{
+			for (std::size_t i(0); i < 256; ++i)
+			{
+				pairs[i][0] = decode(i & 0xf);
+				pairs[i][1] = decode(i >> 4);
+			}
+		}
+		
+		// The escaped characters are replaced afterwards.
+		constexpr static char decode(std::size_t const code) { return (code < fg::PACKED_MSA_ALPHABET.size() ? fg::PACKED_MSA_ALPHABET[code] : '?'); }
+	};
+	
+	constexpr static decode_table const DECODE_TABLE;
+	
+	
+	inline std::uint64_t read_uint64(char const *data)
+	{
+		std::uint64_t val{};
+		std::memcpy(&val, data, 8);
+		return endian::little_to_native(val);
+	}
+}
+
+
+namespace founder_graphs {
+	
+	void packed_msa_writer::write_uint64(std::uint64_t const val)
+	{
+		auto const val_(endian::native_to_little(val));
+		write_bytes(reinterpret_cast <char const *>(&val_), 8);
+	}
+	
+	
+	void packed_msa_writer::write_bytes(char const *data, std::size_t const size)
+	{
+		if (!m_stream->write(data, size))
+			throw std::runtime_error("Unable to write to the output stream.");
+		m_stream_position += size;
+	}
+	
+	
+	void packed_msa_writer::write_header()
+	{
+		libbio_always_assert_lt(0, m_tile_width);
+		write_bytes(PACKED_MSA_MAGIC.data(), PACKED_MSA_MAGIC.size());
+		write_uint64(m_row_count);
+		write_uint64(m_aligned_size);
+		write_uint64(m_tile_width);
+		write_uint64(tile_count());
+		m_tile_offsets.reserve(1 + tile_count());
+	}
+	
+	
+	void packed_msa_writer::write_tile(std::span <row_span_type const> const rows)
+	{
+		libbio_always_assert_eq(rows.size(), m_row_count);
+		libbio_always_assert_lt(m_position, m_aligned_size);
+		auto const width(std::min(m_tile_width, m_aligned_size - m_position));
+		auto const bytes_per_column((m_row_count + 1) / 2);
+		
+		m_tile_offsets.push_back(m_stream_position);
+		m_tile_buffer.clear();
+		m_tile_buffer.resize(width * bytes_per_column, 0);
+		m_escapes.clear();
+		
+		// Fill the tile row by row so that the input is read sequentially.
+		for (std::size_t j(0); j < m_row_count; ++j)
+		{
+			auto const row(rows[j]);
+			libbio_always_assert_eq(row.size(), width);
+			auto const shift(4 * (j % 2));
+			for (std::size_t i(0); i < width; ++i)
+			{
+				auto const cc(row[i]);
+				auto const code(packed_msa_code(cc));
+				m_tile_buffer[i * bytes_per_column + j / 2] |= code << shift;
+				if (PACKED_MSA_ESCAPE_CODE == code)
+					m_escapes.push_back(((i * m_row_count + j) << 8) | std::uint8_t(cc));
+			}
+		}
+		
+		// Sort the escaped characters by position.
+		std::sort(m_escapes.begin(), m_escapes.end());
+		
+		write_bytes(reinterpret_cast <char const *>(m_tile_buffer.data()), m_tile_buffer.size());
+		write_uint64(m_escapes.size());
+		for (auto const val : m_escapes)
+			write_uint64(val);
+		
+		m_position += width;
+	}
+	
+	
+	void packed_msa_writer::finish()
+	{
+		libbio_always_assert_eq(m_position, m_aligned_size);
+		libbio_always_assert_eq(m_tile_offsets.size(), tile_count());
+		
+		// Tile index.
+		auto const index_offset(m_stream_position);
+		m_tile_offsets.push_back(index_offset);
+		for (auto const offset : m_tile_offsets)
+			write_uint64(offset);
+		
+		// Footer.
+		write_uint64(index_offset);
+		write_bytes(PACKED_MSA_MAGIC.data(), PACKED_MSA_MAGIC.size());
+		m_stream->flush();
+	}
+	
+	
+	void packed_msa::open(std::string const &path)
+	{
+		m_handle = lb::open_file_for_reading(path);
+		auto const [file_size, preferred_block_size] = check_file_size(m_handle);
+		if (file_size < PACKED_MSA_HEADER_SIZE + PACKED_MSA_FOOTER_SIZE)
+			throw std::runtime_error("The packed MSA file is too small.");
+		
+		m_mapping = memory_mapping(m_handle, file_size);
+		auto const *data(m_mapping.data());
+		
+		// Check the magic values.
+		auto const check_magic([data, file_size](auto const &magic){
+			return (
+				std::equal(magic.begin(), magic.end(), data) &&
+				std::equal(magic.begin(), magic.end(), data + file_size - magic.size())
+			);
+		});
+		if (! (check_magic(PACKED_MSA_MAGIC) || check_magic(PACKED_MSA_MAGIC_V1)))
+			throw std::runtime_error("Unexpected magic value in the packed MSA file.");
+		
+		// Read the header.
+		m_row_count = read_uint64(data + 8);
+		m_aligned_size = read_uint64(data + 16);
+		m_tile_width = read_uint64(data + 24);
+		m_tile_count = read_uint64(data + 32);
+		libbio_always_assert_lt(0, m_tile_width);
+		libbio_always_assert_eq(m_tile_count, (m_aligned_size + m_tile_width - 1) / m_tile_width);
+		
+		// Read the tile index. The offsets are copied since they are not necessarily aligned.
+		auto const index_offset(read_uint64(data + file_size - PACKED_MSA_FOOTER_SIZE));
+		libbio_always_assert_lte(index_offset + 8 * (1 + m_tile_count), file_size - PACKED_MSA_FOOTER_SIZE);
+		m_tile_offsets.resize(1 + m_tile_count);
+		for (std::size_t i(0); i <= m_tile_count; ++i)
+		{
+			m_tile_offsets[i] = read_uint64(data + index_offset + 8 * i);
+			if (i)
+				libbio_always_assert_lt(m_tile_offsets[i - 1], m_tile_offsets[i]);
+		}
+		libbio_always_assert_eq(index_offset, m_tile_offsets.back());
+	}
+	
+	
+	void packed_msa::advise_access_pattern(bgzip_access_pattern const pattern) const
+	{
+		switch (pattern)
+		{
+			case bgzip_access_pattern::normal:
+				m_mapping.advise(0, m_mapping.size(), MADV_NORMAL);
+				break;
+			
+			case bgzip_access_pattern::sequential:
+				m_mapping.advise(0, m_mapping.size(), MADV_SEQUENTIAL);
+				break;
+			
+			case bgzip_access_pattern::reverse:
+				m_mapping.advise(0, m_mapping.size(), MADV_RANDOM);
+				break;
+		}
+	}
+	
+	
+	void packed_msa::advise_will_need(std::size_t const tile) const
+	{
+		libbio_assert_lt(tile, m_tile_count);
+		m_mapping.advise(m_tile_offsets[tile], m_tile_offsets[tile + 1] - m_tile_offsets[tile], MADV_WILLNEED);
+	}
+	
+	
+	void packed_msa::decode(
+		std::size_t const tile,
+		std::size_t const column_lb,
+		std::size_t const column_rb,
+		char *dst,
+		std::ptrdiff_t const row_stride,
+		std::ptrdiff_t const column_stride
+	) const
+	{
+		libbio_assert_lt(tile, m_tile_count);
+		libbio_assert_lte(column_lb, column_rb);
+		libbio_assert_lte(column_rb, tile_size(tile));
+		
+		auto const bytes_per_column((m_row_count + 1) / 2);
+		auto const *tile_data(reinterpret_cast <std::uint8_t const *>(m_mapping.data() + m_tile_offsets[tile]));
+		
+		// Decode the 4-bit codes.
+		for (std::size_t i(column_lb); i < column_rb; ++i)
+		{
+			auto const *column(tile_data + i * bytes_per_column);
+			auto *column_dst(dst + std::ptrdiff_t(i - column_lb) * column_stride);
+			if (1 == row_stride)
+			{
+				// Consecutive output; copy both characters at once.
+				for (std::size_t j(0); j < m_row_count / 2; ++j)
+					std::memcpy(column_dst + 2 * j, DECODE_TABLE.pairs[column[j]].data(), 2);
+				
+				if (m_row_count % 2)
+					column_dst[m_row_count - 1] = DECODE_TABLE.pairs[column[m_row_count / 2]][0];
+			}
+			else
+			{
+				for (std::size_t j(0); j < m_row_count; ++j)
+					column_dst[std::ptrdiff_t(j) * row_stride] = DECODE_TABLE.pairs[column[j / 2]][j % 2];
+			}
+		}
+		
+		// Replace the escaped characters. They are sorted by position, so the first one in the range
+		// can be located with binary search.
+		auto const *escape_data(reinterpret_cast <char const *>(tile_data + tile_size(tile) * bytes_per_column));
+		auto const escape_count(read_uint64(escape_data));
+		auto const escape_position([escape_data](std::size_t const k){ return read_uint64(escape_data + 8 * (1 + k)) >> 8; });
+		auto const position_lb(column_lb * m_row_count);
+		auto const position_rb(column_rb * m_row_count);
+		std::size_t escape_lb(0);
+		{
+			std::size_t escape_rb(escape_count);
+			while (escape_lb < escape_rb)
+			{
+				auto const mid(escape_lb + (escape_rb - escape_lb) / 2);
+				if (escape_position(mid) < position_lb)
+					escape_lb = mid + 1;
+				else
+					escape_rb = mid;
+			}
+		}
+		
+		for (std::size_t k(escape_lb); k < escape_count; ++k)
+		{
+			auto const val(read_uint64(escape_data + 8 * (1 + k)));
+			auto const position(val >> 8);
+			if (position_rb <= position)
+				break;
+			
+			auto const column(position / m_row_count);
+			auto const row(position % m_row_count);
+			dst[std::ptrdiff_t(row) * row_stride + std::ptrdiff_t(column - column_lb) * column_stride] = char(val & 0xff);
+		}
+	}
+}
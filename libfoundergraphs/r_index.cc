@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <algorithm>
+#include <founder_graphs/r_index.hh>
+#include <libbio/assert.hh>
+
+
+namespace {
+	
+	typedef founder_graphs::r_index::size_type	size_type;
+	
+	
+	// Store the values in a bit-compressed vector.
+	sdsl::int_vector <0> compressed_vector(std::vector <size_type> const &values)
+	{
+		auto const max_value(values.empty() ? 1 : std::max(size_type(1), *std::max_element(values.begin(), values.end())));
+		sdsl::int_vector <0> retval(values.size(), 0, sdsl::bits::hi(max_value) + 1);
+		std::copy(values.begin(), values.end(), retval.begin());
+		return retval;
+	}
+	
+	
+	// Store the positions of the given samples in an sd_vector and the values in a bit-compressed vector,
+	// both in the order of the positions.
+	void store_samples(
+		std::vector <std::pair <size_type, size_type>> &samples,
+		size_type const universe_size,
+		founder_graphs::r_index::bit_vector_type &positions,
+		sdsl::int_vector <0> &values
+	)
+	{
+		std::sort(samples.begin(), samples.end());
+		
+		sdsl::sd_vector_builder builder(universe_size, samples.size());
+		std::vector <size_type> values_;
+		values_.reserve(samples.size());
+		for (auto const &[pos, val] : samples)
+		{
+			builder.set(pos);
+			values_.push_back(val);
+		}
+		
+		positions = founder_graphs::r_index::bit_vector_type(builder);
+		values = compressed_vector(values_);
+	}
+}
+
+
+namespace founder_graphs {
+	
+	r_index::size_type r_index::rank(size_type const pos, char_type const comp) const
+	{
+		if (pos == m_size)
+			return C[1 + comp] - C[comp];
+		
+		auto const run(run_containing(pos));
+		auto const retval(run_length_sum(runs_before(run, comp), comp));
+		if (m_run_heads[run] == comp)
+			return retval + pos - run_start(run);
+		return retval;
+	}
+	
+	
+	r_index::size_type r_index::backward_search(range_type &range, char_type const cc) const
+	{
+		libbio_assert(!range.empty());
+		char_type const comp(char2comp[cc]);
+		if (0 == comp && 0 != cc)
+		{
+			range.lb = 1;
+			range.rb = 0;
+			return 0;
+		}
+		
+		auto const lb(C[comp] + rank(range.lb, comp));
+		auto const rb(C[comp] + rank(1 + range.rb, comp) - 1);
+		if (rb + 1 == lb)
+		{
+			range.lb = lb;
+			range.rb = rb;
+			return 0;
+		}
+		
+		// The first occurrence of cc in BWT[range.lb, range.rb] is either at range.lb or at the start of a run,
+		// and the last one either at range.rb or at the end of a run.
+		{
+			auto const run(run_containing(range.lb));
+			if (m_run_heads[run] == comp)
+				range.sa_lb = preceding_position(range.sa_lb);
+			else
+				range.sa_lb = preceding_position(m_sa_run_starts[nth_run(runs_before(run, comp), comp)]);
+		}
+		
+		{
+			auto const run(run_containing(range.rb));
+			if (m_run_heads[run] == comp)
+				range.sa_rb = preceding_position(range.sa_rb);
+			else
+			{
+				auto const count(runs_before(run, comp));
+				libbio_assert_lt(0, count);
+				range.sa_rb = preceding_position(m_sa_run_ends[nth_run(count - 1, comp)]);
+			}
+		}
+		
+		range.lb = lb;
+		range.rb = rb;
+		return rb + 1 - lb;
+	}
+	
+	
+	r_index::size_type r_index::phi_inverse(size_type const pos) const
+	{
+		// If the suffix at pos is not the last one of its run, the ones at pos - 1 and at Φ⁻¹(pos) - 1 are
+		// adjacent in lexicographic order, i.e. Φ⁻¹(pos) = Φ⁻¹(pos - 1) + 1. Hence use the preceding sample.
+		// (The suffix preceded by the terminator is sampled, since its run has only one character.)
+		auto const idx(m_run_end_positions_rank1_support(1 + pos) - 1);
+		auto const sample_pos(m_run_end_positions_select1_support(1 + idx));
+		return m_phi_inverse_samples[idx] + (pos - sample_pos);
+	}
+	
+	
+	r_index::size_type r_index::plcp(size_type const pos) const
+	{
+		// If the suffix at pos is not the first one of its run, PLCP[pos] = PLCP[pos - 1] - 1.
+		auto const idx(m_run_start_positions_rank1_support(1 + pos) - 1);
+		auto const sample_pos(m_run_start_positions_select1_support(1 + idx));
+		return m_plcp_samples[idx] - (pos - sample_pos);
+	}
+	
+	
+	r_index::size_type r_index::size_in_bytes() const
+	{
+		return
+			sdsl::size_in_bytes(char2comp) +
+			sdsl::size_in_bytes(comp2char) +
+			sdsl::size_in_bytes(C) +
+			sdsl::size_in_bytes(m_run_starts) +
+			sdsl::size_in_bytes(m_runs_by_char) +
+			sdsl::size_in_bytes(m_run_lf_starts) +
+			sdsl::size_in_bytes(m_run_start_positions) +
+			sdsl::size_in_bytes(m_run_end_positions) +
+			sdsl::size_in_bytes(m_run_starts_rank1_support) +
+			sdsl::size_in_bytes(m_run_starts_select1_support) +
+			sdsl::size_in_bytes(m_runs_by_char_rank1_support) +
+			sdsl::size_in_bytes(m_runs_by_char_select1_support) +
+			sdsl::size_in_bytes(m_run_lf_starts_select1_support) +
+			sdsl::size_in_bytes(m_run_start_positions_rank1_support) +
+			sdsl::size_in_bytes(m_run_start_positions_select1_support) +
+			sdsl::size_in_bytes(m_run_end_positions_rank1_support) +
+			sdsl::size_in_bytes(m_run_end_positions_select1_support) +
+			sdsl::size_in_bytes(m_run_heads) +
+			sdsl::size_in_bytes(m_char_run_offsets) +
+			sdsl::size_in_bytes(m_sa_run_starts) +
+			sdsl::size_in_bytes(m_sa_run_ends) +
+			sdsl::size_in_bytes(m_plcp_samples) +
+			sdsl::size_in_bytes(m_phi_inverse_samples) +
+			sizeof(sigma) +
+			sizeof(m_size) +
+			sizeof(m_max_lcp);
+	}
+	
+	
+	void r_index::prepare_rank_and_select_support()
+	{
+		m_run_starts_rank1_support = rank1_support_type(&m_run_starts);
+		m_run_starts_select1_support = select1_support_type(&m_run_starts);
+		m_runs_by_char_rank1_support = rank1_support_type(&m_runs_by_char);
+		m_runs_by_char_select1_support = select1_support_type(&m_runs_by_char);
+		m_run_lf_starts_select1_support = select1_support_type(&m_run_lf_starts);
+		m_run_start_positions_rank1_support = rank1_support_type(&m_run_start_positions);
+		m_run_start_positions_select1_support = select1_support_type(&m_run_start_positions);
+		m_run_end_positions_rank1_support = rank1_support_type(&m_run_end_positions);
+		m_run_end_positions_select1_support = select1_support_type(&m_run_end_positions);
+	}
+	
+	
+	void r_index_builder::add(char_type const bwt_char, size_type const sa_value, size_type const lcp_value)
+	{
+		if (m_run_heads.empty() || m_run_heads.back() != bwt_char)
+		{
+			if (!m_run_heads.empty())
+				m_sa_run_ends.push_back(m_previous_sa_value);
+			
+			m_run_starts.push_back(m_size);
+			m_run_heads.push_back(bwt_char);
+			m_sa_run_starts.push_back(sa_value);
+			m_lcp_run_starts.push_back(lcp_value);
+		}
+		
+		// The maximum LCP value occurs at the start of a run, since LCP[LF(i)] = LCP[i] + 1 if BWT[i - 1] = BWT[i].
+		m_max_lcp = std::max(m_max_lcp, lcp_value);
+		m_previous_sa_value = sa_value;
+		++m_char_counts[bwt_char];
+		++m_size;
+	}
+	
+	
+	void r_index_builder::finish(r_index &index)
+	{
+		libbio_always_assert_lt(0, m_size);
+		libbio_always_assert_eq(1, m_char_counts[0]); // The text should be terminated with a unique zero character.
+		m_sa_run_ends.push_back(m_previous_sa_value);
+		
+		auto const run_count(m_run_heads.size());
+		index.m_size = m_size;
+		index.m_max_lcp = m_max_lcp;
+		
+		// Determine the alphabet.
+		index.sigma = std::count_if(m_char_counts.begin(), m_char_counts.end(), [](auto const count){ return 0 < count; });
+		index.char2comp = sdsl::int_vector <8>(256, 0);
+		index.comp2char = sdsl::int_vector <8>(256, 0);
+		index.C = sdsl::int_vector <64>(257, 0);
+		{
+			size_type comp(0);
+			for (std::size_t cc(0); cc < m_char_counts.size(); ++cc)
+			{
+				auto const count(m_char_counts[cc]);
+				if (!count)
+					continue;
+				
+				index.char2comp[cc] = comp;
+				index.comp2char[comp] = cc;
+				index.C[1 + comp] = index.C[comp] + count;
+				++comp;
+			}
+			
+			for (; comp < 256; ++comp)
+				index.C[1 + comp] = m_size;
+		}
+		
+		// Run heads and starts.
+		index.m_run_heads = sdsl::int_vector <8>(run_count, 0);
+		for (std::size_t i(0); i < run_count; ++i)
+			index.m_run_heads[i] = index.char2comp[m_run_heads[i]];
+		
+		{
+			sdsl::sd_vector_builder builder(m_size, run_count);
+			for (auto const pos : m_run_starts)
+				builder.set(pos);
+			index.m_run_starts = r_index::bit_vector_type(builder);
+		}
+		
+		// Group the runs by head.
+		std::vector <size_type> runs_by_char(run_count);
+		index.m_char_run_offsets = sdsl::int_vector <64>(1 + index.sigma, 0);
+		{
+			std::vector <size_type> offsets(1 + index.sigma, 0);
+			for (std::size_t i(0); i < run_count; ++i)
+				++offsets[1 + index.m_run_heads[i]];
+			for (std::size_t comp(0); comp < index.sigma; ++comp)
+				offsets[1 + comp] += offsets[comp];
+			for (std::size_t comp(0); comp <= index.sigma; ++comp)
+				index.m_char_run_offsets[comp] = offsets[comp];
+			
+			for (std::size_t i(0); i < run_count; ++i)
+				runs_by_char[offsets[index.m_run_heads[i]]++] = i;
+		}
+		
+		{
+			sdsl::sd_vector_builder runs_by_char_builder(index.sigma * run_count, run_count);
+			sdsl::sd_vector_builder run_lf_starts_builder(m_size, run_count);
+			for (std::size_t comp(0); comp < index.sigma; ++comp)
+			{
+				size_type lf_start(index.C[comp]);
+				for (std::size_t i(index.m_char_run_offsets[comp]); i < index.m_char_run_offsets[1 + comp]; ++i)
+				{
+					auto const run(runs_by_char[i]);
+					auto const run_end(1 + run < run_count ? m_run_starts[1 + run] : m_size);
+					runs_by_char_builder.set(comp * run_count + run);
+					run_lf_starts_builder.set(lf_start);
+					lf_start += run_end - m_run_starts[run];
+				}
+			}
+			
+			index.m_runs_by_char = r_index::bit_vector_type(runs_by_char_builder);
+			index.m_run_lf_starts = r_index::bit_vector_type(run_lf_starts_builder);
+		}
+		
+		// Suffix array and PLCP samples.
+		index.m_sa_run_starts = compressed_vector(m_sa_run_starts);
+		index.m_sa_run_ends = compressed_vector(m_sa_run_ends);
+		
+		{
+			std::vector <std::pair <size_type, size_type>> samples(run_count);
+			for (std::size_t i(0); i < run_count; ++i)
+				samples[i] = {m_sa_run_starts[i], m_lcp_run_starts[i]};
+			store_samples(samples, m_size, index.m_run_start_positions, index.m_plcp_samples);
+		}
+		
+		{
+			// Φ⁻¹ is not defined for the last suffix.
+			std::vector <std::pair <size_type, size_type>> samples(run_count);
+			for (std::size_t i(0); i < run_count; ++i)
+				samples[i] = {m_sa_run_ends[i], (1 + i < run_count ? m_sa_run_starts[1 + i] : 0)};
+			store_samples(samples, m_size, index.m_run_end_positions, index.m_phi_inverse_samples);
+		}
+		
+		index.prepare_rank_and_select_support();
+	}
+	
+	
+	void batched_backward_search(r_index const &index, std::span <backward_search_query <r_index>> const queries)
+	{
+		for (auto &query : queries)
+			index.backward_search(query.range, query.cc);
+	}
+}
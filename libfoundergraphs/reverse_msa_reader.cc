@@ -3,6 +3,9 @@
  * This code is licensed under MIT license (see LICENSE for details).
  */
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <cstdio> // strerror
 #include <founder_graphs/reverse_msa_reader.hh>
 #include <founder_graphs/utility.hh>
@@ -12,12 +15,164 @@
 #include <range/v3/view/enumerate.hpp>
 #include <tuple>
 
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+namespace fg	= founder_graphs;
 namespace lb	= libbio;
 namespace rsv	= ranges::views;
 
 
+namespace {
+	
+	constexpr static inline std::size_t const TILE_SIZE{16};
+	
+	// Minimum amount of compressed data decompressed in one task.
+	constexpr static inline std::size_t const DECOMPRESS_TASK_MIN_SIZE{256 * 1024};
+	
+	
+	// Call fn(lb, rb) for consecutive half-open ranges of handles s.t. the total compressed size of
+	// the blocks that overlap the given column range is at least DECOMPRESS_TASK_MIN_SIZE in each range
+	// of handles (apart from the last one), so that the small blocks do not cause a task each.
+	template <typename t_fn>
+	void for_each_handle_batch(std::vector <fg::bgzip_reader> const &handles, std::size_t const column_lb, std::size_t const column_rb, t_fn &&fn)
+	{
+		std::size_t handle_lb{};
+		std::size_t compressed_size{};
+		for (std::size_t i(0); i < handles.size(); ++i)
+		{
+			auto const &handle(handles[i]);
+			auto const &entries(handle.index_entries());
+			auto const [block_lb, block_rb](handle.find_uncompressed_range(column_lb, column_rb));
+			compressed_size += entries[block_rb].compressed_offset - entries[block_lb].compressed_offset;
+			if (DECOMPRESS_TASK_MIN_SIZE <= compressed_size)
+			{
+				fn(handle_lb, i + 1);
+				handle_lb = i + 1;
+				compressed_size = 0;
+			}
+		}
+		
+		if (handle_lb < handles.size())
+			fn(handle_lb, handles.size());
+	}
+	
+	
+	
+	// Copy the given part of the tile without vectorisation.
+	// dst[i * row_count + j] = src[j * block_size + block_size - i - 1].
+	inline void transpose_reversed_tile_scalar(
+		char const *src,
+		std::size_t const row_count,
+		std::size_t const block_size,
+		std::size_t const row_lb,
+		std::size_t const row_rb,
+		std::size_t const col_lb,
+		std::size_t const col_rb,
+		char *dst
+	)
+	{
+		for (std::size_t j(row_lb); j < row_rb; ++j)
+		{
+			auto const *src_row(src + j * block_size);
+			for (std::size_t k(col_lb); k < col_rb; ++k)
+				dst[(block_size - k - 1) * row_count + j] = src_row[k];
+		}
+	}
+
+
+#if defined(__SSE2__)
+	// Transpose one 16 × 16 tile. Applying the perfect shuffle four times with doubling lane widths
+	// produces the columns of the tile in bit-reversed order.
+	inline void transpose_reversed_tile_sse2(
+		char const *src,
+		std::size_t const row_count,
+		std::size_t const block_size,
+		std::size_t const row_lb,
+		std::size_t const col_lb,
+		char *dst
+	)
+	{
+		constexpr std::array <std::uint8_t, TILE_SIZE> const bit_reversed{0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15};
+		
+		__m128i xx[TILE_SIZE], yy[TILE_SIZE];
+		for (std::size_t i(0); i < TILE_SIZE; ++i)
+			xx[i] = _mm_loadu_si128(reinterpret_cast <__m128i const *>(src + (row_lb + i) * block_size + col_lb));
+		
+		for (std::size_t i(0); i < TILE_SIZE / 2; ++i)
+		{
+			yy[i] = _mm_unpacklo_epi8(xx[2 * i], xx[2 * i + 1]);
+			yy[i + TILE_SIZE / 2] = _mm_unpackhi_epi8(xx[2 * i], xx[2 * i + 1]);
+		}
+		
+		for (std::size_t i(0); i < TILE_SIZE / 2; ++i)
+		{
+			xx[i] = _mm_unpacklo_epi16(yy[2 * i], yy[2 * i + 1]);
+			xx[i + TILE_SIZE / 2] = _mm_unpackhi_epi16(yy[2 * i], yy[2 * i + 1]);
+		}
+		
+		for (std::size_t i(0); i < TILE_SIZE / 2; ++i)
+		{
+			yy[i] = _mm_unpacklo_epi32(xx[2 * i], xx[2 * i + 1]);
+			yy[i + TILE_SIZE / 2] = _mm_unpackhi_epi32(xx[2 * i], xx[2 * i + 1]);
+		}
+		
+		for (std::size_t i(0); i < TILE_SIZE / 2; ++i)
+		{
+			xx[i] = _mm_unpacklo_epi64(yy[2 * i], yy[2 * i + 1]);
+			xx[i + TILE_SIZE / 2] = _mm_unpackhi_epi64(yy[2 * i], yy[2 * i + 1]);
+		}
+		
+		for (std::size_t i(0); i < TILE_SIZE; ++i)
+		{
+			auto const k(col_lb + bit_reversed[i]);
+			_mm_storeu_si128(reinterpret_cast <__m128i *>(dst + (block_size - k - 1) * row_count + row_lb), xx[i]);
+		}
+	}
+#endif
+
+
+	// Transpose the row-major block in src to dst s.t. the columns are stored from right to left.
+	// The block is processed in tiles so that both the reads and the writes stay in a small number of cache lines.
+	void transpose_reversed(char const *src, std::size_t const row_count, std::size_t const block_size, char *dst)
+	{
+		auto const row_limit(row_count - row_count % TILE_SIZE);
+		auto const col_limit(block_size - block_size % TILE_SIZE);
+		for (std::size_t row_lb(0); row_lb < row_limit; row_lb += TILE_SIZE)
+		{
+			for (std::size_t col_lb(0); col_lb < col_limit; col_lb += TILE_SIZE)
+			{
+#if defined(__SSE2__)
+				transpose_reversed_tile_sse2(src, row_count, block_size, row_lb, col_lb, dst);
+#else
+				transpose_reversed_tile_scalar(src, row_count, block_size, row_lb, row_lb + TILE_SIZE, col_lb, col_lb + TILE_SIZE, dst);
+#endif
+			}
+			
+			// Remaining columns.
+			transpose_reversed_tile_scalar(src, row_count, block_size, row_lb, row_lb + TILE_SIZE, col_limit, block_size, dst);
+		}
+		
+		// Remaining rows.
+		transpose_reversed_tile_scalar(src, row_count, block_size, row_limit, row_count, 0, block_size, dst);
+	}
+}
+
+
 namespace founder_graphs {
 	
+	void reverse_msa_reader::finish_reading_block()
+	{
+		if (msa_buffer_layout::column_major != m_layout)
+			return;
+		
+		libbio_assert_lte(m_row_count * m_current_block_size, m_row_major_buffer.size());
+		m_buffer.resize(m_row_count * m_current_block_size);
+		transpose_reversed(m_row_major_buffer.data(), m_row_count, m_current_block_size, m_buffer.data());
+	}
+	
+	
 	void text_reverse_msa_reader::add_file(std::string const &path)
 	{
 		bool const is_empty(m_handles.empty());
@@ -38,8 +193,21 @@ namespace founder_graphs {
 	
 	void text_reverse_msa_reader::prepare()
 	{
+		m_row_count = m_handles.size();
 		m_buffer.resize(m_handles.size() * m_preferred_block_size, 0);
+		if (msa_buffer_layout::column_major == m_layout)
+			m_row_major_buffer.resize(m_handles.size() * m_preferred_block_size, 0);
 		m_file_position = m_aligned_size;
+		
+		// read_buffer() is not reallocated after this, so it can be registered.
+		if (m_should_use_io_uring && m_batched_reader.setup_io_uring(std::min(std::size_t(batched_file_reader::QUEUE_DEPTH_DEFAULT), std::max(std::size_t(1), m_handles.size()))))
+		{
+			std::vector <int> fds(m_handles.size());
+			std::transform(m_handles.begin(), m_handles.end(), fds.begin(), [](auto const &handle){ return handle.get(); });
+			m_batched_reader.set_files(fds);
+			m_batched_reader.register_buffer(read_buffer());
+			m_read_requests.resize(m_handles.size());
+		}
 	}
 	
 	
@@ -53,93 +221,331 @@ namespace founder_graphs {
 		
 		m_current_block_size = std::min(m_file_position, m_preferred_block_size);
 		m_file_position -= m_current_block_size;
-		for (auto const &[i, handle] : rsv::enumerate(m_handles))
-			read_from_file(handle, m_file_position, m_current_block_size, m_buffer.data() + i * m_current_block_size);
+		auto &buffer(read_buffer());
+		if (m_batched_reader.uses_io_uring())
+		{
+			for (std::size_t i(0); i < m_handles.size(); ++i)
+				m_read_requests[i] = read_request{buffer.data() + i * m_current_block_size, m_file_position, m_current_block_size, std::uint32_t(i)};
+			m_batched_reader.read(m_read_requests);
+		}
+		else
+		{
+			for (auto const &[i, handle] : rsv::enumerate(m_handles))
+				read_from_file(handle, m_file_position, m_current_block_size, buffer.data() + i * m_current_block_size);
+		}
 		
+		finish_reading_block();
 		return cb(true);
 	}
 	
 	
+	auto bgzip_reverse_msa_reader::block_cache::find(std::size_t const block) -> decompressed_block_ptr
+	{
+		std::lock_guard const lock(mutex);
+		for (auto const &[cached_block, ptr] : entries)
+		{
+			if (cached_block == block)
+				return ptr;
+		}
+		
+		return {};
+	}
+	
+	
+	void bgzip_reverse_msa_reader::block_cache::insert(std::size_t const block, decompressed_block_ptr ptr)
+	{
+		std::lock_guard const lock(mutex);
+		entries[next_entry] = {block, std::move(ptr)};
+		next_entry = (1 + next_entry) % entries.size();
+	}
+	
+	
+	bgzip_reverse_msa_reader::~bgzip_reverse_msa_reader()
+	{
+		// The tasks refer to the slots.
+		for (auto &slot : m_read_ahead_slots)
+		{
+			if (slot.group)
+				dispatch_group_wait(*slot.group, DISPATCH_TIME_FOREVER);
+		}
+	}
+	
+	
 	void bgzip_reverse_msa_reader::add_file(std::string const &path)
 	{
 		auto &handle(m_handles.emplace_back());
+		handle.set_access_mode(m_access_mode);
 		handle.open(path);
+		handle.advise_access_pattern(bgzip_access_pattern::reverse);
+	}
+	
+	
+	void bgzip_reverse_msa_reader::prepare_column_ranges()
+	{
+		// Merge the block boundaries of all the rows.
+		auto const size(aligned_size());
+		std::size_t max_uncompressed_block_size{};
+		m_column_ranges.clear();
+		for (auto const &handle : m_handles)
+		{
+			libbio_always_assert_eq(handle.uncompressed_size(), size);
+			auto const &entries(handle.index_entries());
+			for (std::size_t i(1); i < entries.size(); ++i)
+			{
+				max_uncompressed_block_size = std::max(max_uncompressed_block_size, entries[i].uncompressed_offset - entries[i - 1].uncompressed_offset);
+				m_column_ranges.push_back(entries[i - 1].uncompressed_offset);
+			}
+		}
+		m_column_ranges.push_back(size);
+		std::sort(m_column_ranges.begin(), m_column_ranges.end());
+		m_column_ranges.erase(std::unique(m_column_ranges.begin(), m_column_ranges.end()), m_column_ranges.end());
+		
+		// Coalesce the ranges from right to left s.t. none of them is longer than the longest block.
+		// Since the distance between consecutive merged boundaries is at most the length of some block,
+		// each range is non-empty. If the rows have matching boundaries, the ranges are the blocks.
+		std::vector <std::size_t> boundaries{size};
+		auto rb(size);
+		while (rb)
+		{
+			auto const target(rb - std::min(rb, max_uncompressed_block_size));
+			auto const it(std::lower_bound(m_column_ranges.begin(), m_column_ranges.end(), target));
+			libbio_assert_neq(it, m_column_ranges.end());
+			libbio_assert_lt(*it, rb);
+			rb = *it;
+			boundaries.push_back(rb);
+		}
+		
+		std::reverse(boundaries.begin(), boundaries.end());
+		m_column_ranges = std::move(boundaries);
 	}
 	
 	
 	void bgzip_reverse_msa_reader::prepare()
 	{
+		m_row_count = m_handles.size();
 		if (m_handles.empty())
 			return;
 		
-		// Prepare the decompression group.
-		m_decompress_group.reset(dispatch_group_create());
+		prepare_column_ranges();
+		m_block_caches = std::vector <block_cache>(m_handles.size());
 		
-		// Check the index entries.
-		check_matching_bgzip_index_entries(m_handles);
+		// Determine the max. range size.
+		std::size_t max_range_size{};
+		for (std::size_t i(1); i < m_column_ranges.size(); ++i)
+			max_range_size = std::max(max_range_size, m_column_ranges[i] - m_column_ranges[i - 1]);
 		
-		// Determine the max. block size.
-		auto const &first_handle(m_handles.front());
-		auto const &first_entries(first_handle.index_entries());
-		auto const first_count(first_handle.block_count());
-		std::size_t max_uncompressed_block_size{};
-		for (std::size_t i(1); i < first_count; ++i)
+		// Reserve memory.
+		m_buffer.resize(m_handles.size() * max_range_size, 0);
+		if (msa_buffer_layout::column_major == m_layout)
+			m_row_major_buffer.resize(m_handles.size() * max_range_size, 0);
+		
+		// Without read-ahead, one slot is used for reading the current range.
+		m_remaining_range_count = range_count();
+		m_read_ahead_slots.resize(std::max(std::size_t(1), m_read_ahead_block_count));
+		for (auto &slot : m_read_ahead_slots)
+		{
+			slot.input_buffers.resize(m_handles.size());
+			slot.buffer.reserve(m_handles.size() * max_range_size);
+			slot.group.reset(dispatch_group_create());
+		}
+			
+		// Start reading the last ranges.
+		for (std::size_t i(0); i < std::min(m_read_ahead_block_count, m_remaining_range_count); ++i)
 		{
-			auto const prev_offset(first_entries[i - 1].uncompressed_offset);
-			auto const offset(first_entries[i].uncompressed_offset);
-			max_uncompressed_block_size = std::max(max_uncompressed_block_size, offset - prev_offset);
+			auto const range(m_remaining_range_count - i - 1);
+			schedule_range(m_read_ahead_slots[range % m_read_ahead_slots.size()], range);
 		}
+	}
+	
+	
+	void bgzip_reverse_msa_reader::decompress_range(std::size_t const row, std::size_t const column_lb, std::size_t const column_rb, std::vector <char> &input_buffer, char *dst)
+	{
+		auto const &handle(m_handles[row]);
+		auto const &entries(handle.index_entries());
+		auto const [block_lb, block_rb](handle.find_uncompressed_range(column_lb, column_rb));
+		libbio_assert_lt(block_lb, block_rb);
 		
-		// Reserve memory.
-		m_buffer.resize(m_handles.size() * max_uncompressed_block_size, 0);
+		auto &cache(m_block_caches[row]);
+		for (std::size_t block(block_lb); block < block_rb; ++block)
+		{
+			auto const block_offset(entries[block].uncompressed_offset);
+			auto const next_offset(entries[block + 1].uncompressed_offset);
+			
+			// Decompress the blocks that are contained in the range directly to the destination.
+			if (column_lb <= block_offset && next_offset <= column_rb)
+			{
+				auto const input(handle.read_blocks(block, 1, input_buffer));
+				handle.decompress(block, 1, input, std::span(dst + (block_offset - column_lb), next_offset - block_offset));
+				continue;
+			}
+			
+			// The block spans a range boundary, so it is needed for the adjacent range, too.
+			auto ptr(cache.find(block));
+			if (!ptr)
+			{
+				auto decompressed(std::make_shared <std::vector <char>>(next_offset - block_offset));
+				auto const input(handle.read_blocks(block, 1, input_buffer));
+				handle.decompress(block, 1, input, std::span(*decompressed));
+				ptr = std::move(decompressed);
+				cache.insert(block, ptr);
+			}
+			
+			auto const copy_lb(std::max(column_lb, block_offset));
+			auto const copy_rb(std::min(column_rb, next_offset));
+			std::copy(ptr->begin() + (copy_lb - block_offset), ptr->begin() + (copy_rb - block_offset), dst + (copy_lb - column_lb));
+		}
+	}
+	
+	
+	void bgzip_reverse_msa_reader::schedule_range(read_ahead_slot &slot, std::size_t const range)
+	{
+		// Called from the thread that calls fill_buffer(). The slot is not in use.
+		auto const column_lb(m_column_ranges[range]);
+		auto const column_rb(m_column_ranges[range + 1]);
+		auto const range_size(column_rb - column_lb);
+		slot.range = range;
+		slot.buffer.resize(m_handles.size() * range_size);
 		
-		// Move past the last block.
-		for (std::size_t i(0); i < m_handles.size(); ++i)
+		for (auto const &handle : m_handles)
 		{
-			auto &handle(m_handles[i]);
-			handle.block_seek(first_count);
+			auto const [block_lb, block_rb](handle.find_uncompressed_range(column_lb, column_rb));
+			handle.advise_will_need(block_lb, block_rb - block_lb);
 		}
+		
+		auto const queue(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
+		for_each_handle_batch(m_handles, column_lb, column_rb, [this, queue, &slot, column_lb, column_rb, range_size](std::size_t const handle_lb, std::size_t const handle_rb){
+			// Only the i-th input buffers and the i-th parts of the output buffer are written to, bgzip_reader’s
+			// const member functions do not modify its state, and the block caches are locked, so no other locking needed.
+			lb::dispatch_group_async_fn(*slot.group, queue, [this, &slot, column_lb, column_rb, range_size, handle_lb, handle_rb](){
+				for (std::size_t i(handle_lb); i < handle_rb; ++i)
+					decompress_range(i, column_lb, column_rb, slot.input_buffers[i], slot.buffer.data() + i * range_size);
+			});
+		});
 	}
 	
 	
 	bool bgzip_reverse_msa_reader::fill_buffer(fill_buffer_callback_type &cb)
 	{
-		if (0 == m_handles.front().current_block())
+		if (0 == m_remaining_range_count)
 		{
 			cb(false);
 			return false;
 		}
 		
-		// Seek.
-		for (auto &handle : m_handles)
+		--m_remaining_range_count;
+		auto const range(m_remaining_range_count);
+		auto &slot(m_read_ahead_slots[range % m_read_ahead_slots.size()]);
+		if (!m_read_ahead_block_count)
+			schedule_range(slot, range);
+		
+		libbio_assert_eq(range, slot.range);
+		if (0 != dispatch_group_wait(*slot.group, DISPATCH_TIME_FOREVER))
+			throw std::runtime_error("dispatch_group_wait failed even though DISPATCH_TIME_FOREVER was specified as timeout.");
+		
+		// Take the decompressed range. The previous buffer is reused for reading.
+		m_current_block_size = m_column_ranges[range + 1] - m_column_ranges[range];
 		{
-			bool const status(handle.block_seek_previous());
-			libbio_assert(status);
+			using std::swap;
+			swap(read_buffer(), slot.buffer);
 		}
+		finish_reading_block();
 		
-		// Update the uncompressed size.
-		auto const &first_handle(m_handles.front());
-		m_current_block_size = first_handle.current_block_uncompressed_size();
-		m_buffer.resize(m_handles.size() * m_current_block_size);
+		// Read the next range in the background while the callback processes this one.
+		if (m_read_ahead_block_count && m_read_ahead_slots.size() <= range)
+			schedule_range(slot, range - m_read_ahead_slots.size());
 		
-		// Fill the buffers and decompress.
+		return cb(true);
+	}
+	
+	
+	void packed_reverse_msa_reader::add_file(std::string const &path)
+	{
+		libbio_always_assert_msg(!m_is_open, "Only one packed MSA file may be given.");
+		m_msa.open(path);
+		m_msa.advise_access_pattern(bgzip_access_pattern::reverse);
+		m_is_open = true;
+	}
+
+	
+	void packed_reverse_msa_reader::prepare()
+	{
+		m_row_count = m_msa.row_count();
+		m_remaining_tile_count = m_msa.tile_count();
+		if (m_remaining_tile_count)
+			m_msa.advise_will_need(m_remaining_tile_count - 1);
+	}
+	
+	
+	bool packed_reverse_msa_reader::fill_buffer(fill_buffer_callback_type &cb)
+	{
+		if (0 == m_remaining_tile_count)
 		{
-			auto const queue(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0));
-			for (std::size_t i(0); i < m_handles.size(); ++i)
-			{
-				auto &handle(m_handles[i]);
-				handle.read_current_block();
-				lb::dispatch_group_async_fn(*m_decompress_group, queue, [this, i, &handle](){
-					auto const it(m_buffer.data() + i * m_current_block_size);
-					auto const end(it + m_current_block_size);
-					handle.decompress(std::span(it, end));
-				});
-			}
-			
-			if (0 == dispatch_group_wait(*m_decompress_group, DISPATCH_TIME_FOREVER))
-				return cb(true);
-			else
-				throw std::runtime_error("dispatch_group_wait failed even though DISPATCH_TIME_FOREVER was specified as timeout.");
+			cb(false);
+			return false;
+		}
+		
+		--m_remaining_tile_count;
+		auto const tile(m_remaining_tile_count);
+		if (tile)
+			m_msa.advise_will_need(tile - 1);
+		
+		// Decode the tile directly in the requested layout.
+		m_current_block_size = m_msa.tile_size(tile);
+		m_buffer.resize(m_row_count * m_current_block_size);
+		if (msa_buffer_layout::column_major == m_layout)
+		{
+			// Store the rightmost column first.
+			auto const row_count_(static_cast <std::ptrdiff_t>(m_row_count));
+			m_msa.decode(tile, 0, m_current_block_size, m_buffer.data() + (m_current_block_size - 1) * m_row_count, 1, -row_count_);
 		}
+		else
+		{
+			m_msa.decode(tile, 0, m_current_block_size, m_buffer.data(), m_current_block_size, 1);
+		}
+		
+		return cb(true);
+	}
+	
+	
+	void fasta_reverse_msa_reader::add_file(std::string const &path)
+	{
+		libbio_always_assert_msg(!m_is_open, "Only one FASTA file may be given.");
+		m_msa.open(path);
+		m_msa.advise_access_pattern(bgzip_access_pattern::reverse);
+		m_is_open = true;
+	}
+
+	
+	void fasta_reverse_msa_reader::prepare()
+	{
+		m_row_count = m_msa.row_count();
+		m_buffer.resize(m_row_count * m_block_size, 0);
+		if (msa_buffer_layout::column_major == m_layout)
+			m_row_major_buffer.resize(m_row_count * m_block_size, 0);
+		m_file_position = m_msa.aligned_size();
+		m_msa.advise_will_need(m_file_position - std::min(m_file_position, m_block_size), m_file_position);
+	}
+	
+	
+	bool fasta_reverse_msa_reader::fill_buffer(fill_buffer_callback_type &cb)
+	{
+		if (0 == m_file_position)
+		{
+			cb(false);
+			return false;
+		}
+		
+		m_current_block_size = std::min(m_file_position, m_block_size);
+		m_file_position -= m_current_block_size;
+		auto &buffer(read_buffer());
+		buffer.resize(m_row_count * m_current_block_size);
+		for (std::size_t i(0); i < m_row_count; ++i)
+			m_msa.copy(i, m_file_position, m_file_position + m_current_block_size, buffer.data() + i * m_current_block_size);
+		
+		// Let the kernel read the preceding block while the current one is being processed.
+		m_msa.advise_will_need(m_file_position - std::min(m_file_position, m_block_size), m_file_position);
+		
+		finish_reading_block();
+		return cb(true);
 	}
 }
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <array>
+#include <boost/format.hpp>
+#include <cerrno>
+#include <cstring>
+#include <founder_graphs/sequence_reader.hh>
+#include <libbio/file_handling.hh>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace lb	= libbio;
+
+
+namespace {
+	
+	constexpr static inline std::size_t const INPUT_BUFFER_SIZE{1024 * 1024};
+}
+
+
+namespace founder_graphs {
+	
+	sequence_reader::sequence_reader(std::string const &path):
+		m_handle(lb::open_file_for_reading(path))
+	{
+		std::array <unsigned char, 2> magic{};
+		auto const res(::pread(m_handle.get(), magic.data(), magic.size(), 0));
+		if (-1 == res)
+			throw std::runtime_error(std::strerror(errno));
+		
+		if (2 == res && 0x1f == magic[0] && 0x8b == magic[1])
+		{
+			// Add 32 to the window bits to expect a gzip header.
+			if (Z_OK != inflateInit2(&m_stream, 32 + 15))
+				throw std::runtime_error("Unable to initialise zlib.");
+			
+			m_is_compressed = true;
+			m_input_buffer.resize(INPUT_BUFFER_SIZE);
+		}
+	}
+	
+	
+	std::size_t sequence_reader::read_uncompressed(char *dst, std::size_t size)
+	{
+		std::size_t retval{};
+		while (size)
+		{
+			auto const res(::read(m_handle.get(), dst, size));
+			if (-1 == res)
+			{
+				if (EINTR == errno)
+					continue;
+				throw std::runtime_error(std::strerror(errno));
+			}
+			
+			if (0 == res)
+				break;
+			
+			dst += res;
+			size -= res;
+			retval += res;
+		}
+		
+		return retval;
+	}
+	
+	
+	std::size_t sequence_reader::read_compressed(std::span <char> const buffer)
+	{
+		std::size_t filled{};
+		while (filled < buffer.size())
+		{
+			if (0 == m_stream.avail_in)
+			{
+				if (m_reached_eof)
+					break;
+				
+				auto const count(read_uncompressed(m_input_buffer.data(), m_input_buffer.size()));
+				if (0 == count)
+				{
+					m_reached_eof = true;
+					break;
+				}
+				
+				m_stream.next_in = reinterpret_cast <Bytef *>(m_input_buffer.data());
+				m_stream.avail_in = count;
+			}
+			
+			m_stream.next_out = reinterpret_cast <Bytef *>(buffer.data() + filled);
+			m_stream.avail_out = buffer.size() - filled;
+			auto const res(::inflate(&m_stream, Z_NO_FLUSH));
+			filled = buffer.size() - m_stream.avail_out;
+			switch (res)
+			{
+				case Z_OK:
+					m_is_in_member = true;
+					break;
+				
+				case Z_STREAM_END:
+					// Both bgzip and concatenated gzip files consist of multiple members.
+					m_is_in_member = false;
+					if (Z_OK != inflateReset(&m_stream))
+						throw std::runtime_error("Unable to reset the zlib stream.");
+					break;
+				
+				default:
+					throw std::runtime_error(boost::str(boost::format("Unable to inflate the input (%d)") % res));
+			}
+		}
+		
+		if (m_reached_eof && m_is_in_member)
+			throw std::runtime_error("Unexpected end of file.");
+		
+		return filled;
+	}
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021 Tuukka Norri
+ * Copyright (c) 2021-2022 Tuukka Norri
  * This code is licensed under MIT license (see LICENSE for details).
  */
 
@@ -26,6 +26,33 @@ namespace {
 	}
 	
 	
+	bool compare_gap_positions(fg::aligned_sequence_index const &lhs_seq_idx, fg::aligned_sequence_index const &rhs_seq_idx)
+	{
+		// Compare the gap positions regardless of the representation.
+		auto const lhs_gp_size(lhs_seq_idx.size());
+		auto const rhs_gp_size(rhs_seq_idx.size());
+		if (lhs_gp_size != rhs_gp_size)
+		{
+			std::cerr << "\t\tsize: " << lhs_gp_size << " (lhs), " << rhs_gp_size << " (rhs).\n";
+			return false;
+		}
+		
+		bool retval(true);
+		for (std::size_t j(0); j < lhs_gp_size; ++j)
+		{
+			auto const lhs_is_gap(lhs_seq_idx.is_gap(j));
+			auto const rhs_is_gap(rhs_seq_idx.is_gap(j));
+			if (lhs_is_gap != rhs_is_gap)
+			{
+				retval = false;
+				std::cerr << "\t\tPosition " << j << ": " << lhs_is_gap << " (lhs), " << rhs_is_gap << " (rhs).\n";
+			}
+		}
+		
+		return retval;
+	}
+	
+	
 	int msa_index_cmp(char const *lhs_path, char const *rhs_path)
 	{
 		fg::msa_index lhs;
@@ -39,42 +66,29 @@ namespace {
 		auto const lhs_size(lhs.sequence_indices.size());
 		auto const rhs_size(rhs.sequence_indices.size());
 		std::cerr << "Entries: " << lhs_size << " (lhs), " << rhs_size << " (rhs).\n";
-		if (lhs_size == rhs_size)
+		if (lhs_size != rhs_size)
+			return 1;
+		
+		// The gap vector representations may differ, e.g. if the indices were built with different size slacks.
+		bool gap_positions_match(true);
+		for (std::size_t i(0); i < lhs_size; ++i)
 		{
-			for (std::size_t i(0); i < lhs_size; ++i)
+			auto const &lhs_seq_idx(lhs.sequence_indices[i]);
+			auto const &rhs_seq_idx(rhs.sequence_indices[i]);
+			if (lhs_seq_idx != rhs_seq_idx)
 			{
-				auto const &lhs_seq_idx(lhs.sequence_indices[i]);
-				auto const &rhs_seq_idx(rhs.sequence_indices[i]);
-				if (lhs_seq_idx != rhs_seq_idx)
-				{
-					std::cerr << "Entries at index " << i << " differ.\n";
-					
-					auto const &lhs_gp(lhs_seq_idx.gap_positions);
-					auto const &rhs_gp(rhs_seq_idx.gap_positions);
-					int const gap_positions_res(lhs_gp == rhs_gp);
-					std::cerr << "\tGap positions: " << gap_positions_res << ".\n";
-					if (!gap_positions_res)
-					{
-						auto const lhs_gp_size(lhs_gp.size());
-						auto const rhs_gp_size(rhs_gp.size());
-						std::cerr << "\t\tsize: " << lhs_gp_size << " (lhs), " << rhs_gp_size << " (rhs).\n";
-						if (lhs_gp_size == rhs_gp_size)
-						{
-							for (std::size_t j(0); j < lhs_gp_size; ++j)
-							{
-								if (lhs_gp[j] != rhs_gp[j])
-									std::cerr << "\t\tPosition " << j << ": " << lhs_gp[j] << " (lhs), " << rhs_gp[j] << " (rhs).\n";
-							}
-						}
-					}
+				std::cerr << "Entries at index " << i << " differ.\n";
+				std::cerr << "\tGap vector type: " << fg::gap_vector_type_name(lhs_seq_idx.type()) << " (lhs), " << fg::gap_vector_type_name(rhs_seq_idx.type()) << " (rhs).\n";
 					
-					std::cerr << "\trank_0: " << int(lhs_seq_idx.rank0_support == rhs_seq_idx.rank0_support) << ".\n";
-					std::cerr << "\tselect_0: " << int(lhs_seq_idx.select0_support == rhs_seq_idx.select0_support) << ".\n";
-				}
+				int const gap_positions_res(compare_gap_positions(lhs_seq_idx, rhs_seq_idx));
+				std::cerr << "\tGap positions: " << gap_positions_res << ".\n";
+				if (!gap_positions_res)
+					gap_positions_match = false;
 			}
 		}
-		
-		return (!(lhs == rhs));
+					
+		std::cerr << "Gap positions match: " << int(gap_positions_match) << ".\n";
+		return (!gap_positions_match);
 	}
 }
 
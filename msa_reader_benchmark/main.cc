@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <boost/format.hpp>
+#include <chrono>
+#include <filesystem>
+#include <founder_graphs/msa_reader.hh>
+#include <founder_graphs/reverse_msa_reader.hh>
+#include <fstream>
+#include <iostream>
+#include <libbio/file_handling.hh>
+#include <random>
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+#include "cmdline.h"
+
+namespace fg	= founder_graphs;
+namespace fs	= std::filesystem;
+namespace lb	= libbio;
+
+
+namespace {
+	
+	typedef std::vector <std::string>	path_vector;
+	
+	
+	struct benchmark_result
+	{
+		double			seconds{};
+		std::uint64_t	checksum{};		// Prevents the reads from being optimised out.
+	};
+	
+	
+	// One file descriptor is needed per sequence.
+	void raise_open_file_limit()
+	{
+		rlimit limit{};
+		if (0 != ::getrlimit(RLIMIT_NOFILE, &limit))
+			return;
+		
+		limit.rlim_cur = limit.rlim_max;
+		::setrlimit(RLIMIT_NOFILE, &limit);
+	}
+	
+	
+	path_vector read_sequence_list(char const *path)
+	{
+		lb::file_istream stream;
+		lb::open_file_for_reading(path, stream);
+		
+		path_vector retval;
+		std::string line;
+		while (std::getline(stream, line))
+			retval.push_back(line);
+		return retval;
+	}
+	
+	
+	path_vector generate_sequences(char const *directory, std::size_t const row_count, std::size_t const length)
+	{
+		std::cerr << "Generating " << row_count << " sequences of length " << length << "…\n";
+		fs::create_directories(directory);
+		
+		path_vector retval;
+		std::mt19937_64 rng;
+		std::uniform_int_distribution <std::uint8_t> dist(0, 4);
+		std::string buffer(length, 0);
+		boost::format fmt("%d.txt");
+		for (std::size_t i(0); i < row_count; ++i)
+		{
+			for (auto &cc : buffer)
+				cc = "ACGT-"[dist(rng)];
+			
+			auto const path((fs::path(directory) / boost::str(fmt % i)).string());
+			std::ofstream stream(path, std::ios_base::binary | std::ios_base::trunc);
+			if (!stream.write(buffer.data(), buffer.size()))
+				throw std::runtime_error(boost::str(boost::format("Unable to write to %s") % path));
+			retval.push_back(path);
+		}
+		
+		return retval;
+	}
+	
+	
+	template <typename t_fn>
+	double measure(t_fn &&fn)
+	{
+		auto const start(std::chrono::steady_clock::now());
+		fn();
+		auto const end(std::chrono::steady_clock::now());
+		return std::chrono::duration <double>(end - start).count();
+	}
+	
+	
+	benchmark_result read_forward(path_vector const &paths, std::size_t const block_size, bool const should_use_io_uring)
+	{
+		fg::text_msa_reader reader;
+		reader.set_uses_io_uring(should_use_io_uring);
+		for (auto const &path : paths)
+			reader.add_file(path);
+		reader.prepare();
+		
+		benchmark_result retval;
+		auto const aligned_size(reader.aligned_size());
+		retval.seconds = measure([&](){
+			for (std::size_t column_lb(0); column_lb < aligned_size; column_lb += block_size)
+			{
+				reader.fill_buffer(column_lb, std::min(aligned_size, column_lb + block_size), [&retval](auto const &spans){
+					for (auto const &span : spans)
+						retval.checksum += std::uint8_t(span.back());
+					return true;
+				});
+			}
+		});
+		
+		return retval;
+	}
+	
+	
+	benchmark_result read_reverse(path_vector const &paths, bool const should_use_io_uring)
+	{
+		fg::text_reverse_msa_reader reader;
+		reader.set_uses_io_uring(should_use_io_uring);
+		for (auto const &path : paths)
+			reader.add_file(path);
+		reader.prepare();
+		
+		benchmark_result retval;
+		retval.seconds = measure([&](){
+			while (reader.fill_buffer([&reader, &retval](bool const did_read){
+				if (!did_read)
+					return false;
+				
+				retval.checksum += std::uint8_t(reader.buffer().front());
+				return true;
+			}));
+		});
+		
+		return retval;
+	}
+	
+	
+	void output_result(char const *direction, bool const uses_io_uring, int const round, std::size_t const total_size, benchmark_result const &result)
+	{
+		std::cout
+			<< direction << '\t'
+			<< (uses_io_uring ? "io_uring" : "pread") << '\t'
+			<< round << '\t'
+			<< result.seconds << '\t'
+			<< (total_size / result.seconds / (1024.0 * 1024.0)) << '\t'
+			<< result.checksum << '\n';
+	}
+}
+
+
+int main(int argc, char **argv)
+{
+	gengetopt_args_info args_info;
+	if (0 != cmdline_parser(argc, argv, &args_info))
+		std::exit(EXIT_FAILURE);
+	
+	std::ios_base::sync_with_stdio(false);	// Don't use C style IO after calling cmdline_parser.
+	std::cin.tie(nullptr);					// We don't require any input from the user.
+	
+	if (!(args_info.sequence_list_given || args_info.generate_given))
+	{
+		std::cerr << "ERROR: Either --sequence-list or --generate is required.\n";
+		std::exit(EXIT_FAILURE);
+	}
+	
+	if (args_info.row_count_arg <= 0 || args_info.length_arg <= 0 || args_info.block_size_arg <= 0 || args_info.rounds_arg <= 0)
+	{
+		std::cerr << "ERROR: The counts must be positive.\n";
+		std::exit(EXIT_FAILURE);
+	}
+	
+	raise_open_file_limit();
+	
+	auto const paths(
+		args_info.sequence_list_given
+		? read_sequence_list(args_info.sequence_list_arg)
+		: generate_sequences(args_info.generate_arg, args_info.row_count_arg, args_info.length_arg)
+	);
+	
+	if (paths.empty())
+	{
+		std::cerr << "ERROR: No sequences given.\n";
+		std::exit(EXIT_FAILURE);
+	}
+	
+	// Check whether io_uring can be used.
+	bool const has_io_uring(fg::batched_file_reader().setup_io_uring());
+	if (!has_io_uring)
+		std::cerr << "WARNING: io_uring is not available; only pread will be measured.\n";
+	
+	std::size_t const total_size(paths.size() * fs::file_size(paths.front()));
+	std::cout << "DIRECTION\tMETHOD\tROUND\tSECONDS\tMIB_PER_SECOND\tCHECKSUM\n";
+	for (int round(0); round < args_info.rounds_arg; ++round)
+	{
+		for (bool const should_use_io_uring : {false, true})
+		{
+			if (should_use_io_uring && !has_io_uring)
+				continue;
+			
+			output_result("forward", should_use_io_uring, round, total_size, read_forward(paths, args_info.block_size_arg, should_use_io_uring));
+			output_result("reverse", should_use_io_uring, round, total_size, read_reverse(paths, should_use_io_uring));
+		}
+	}
+	
+	return EXIT_SUCCESS;
+}
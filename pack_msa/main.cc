@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <founder_graphs/msa_reader.hh>
+#include <founder_graphs/packed_msa.hh>
+#include <iostream>
+#include <libbio/assert.hh>
+#include <libbio/file_handling.hh>
+#include <libbio/utility.hh>
+#include <string>
+#include <vector>
+#include "cmdline.h"
+
+namespace fg	= founder_graphs;
+namespace lb	= libbio;
+
+
+namespace {
+	
+	void pack_msa(fg::msa_reader &reader, char const *sequence_list_path, std::size_t const tile_width)
+	{
+		{
+			lb::file_istream stream;
+			lb::open_file_for_reading(sequence_list_path, stream);
+			
+			std::string line;
+			while (std::getline(stream, line))
+				reader.add_file(line);
+		}
+		
+		reader.prepare();
+		auto const row_count(reader.handle_count());
+		auto const aligned_size(reader.aligned_size());
+		
+		fg::packed_msa_writer writer(std::cout, row_count, aligned_size, tile_width);
+		writer.write_header();
+		
+		// Read the rows one tile at a time.
+		lb::log_time(std::cerr) << "Packing " << row_count << " sequences of length " << aligned_size << "…\n";
+		std::vector <fg::packed_msa_writer::row_span_type> rows(row_count);
+		for (std::size_t column_lb(0); column_lb < aligned_size; column_lb += tile_width)
+		{
+			auto const column_rb(std::min(aligned_size, column_lb + tile_width));
+			reader.fill_buffer(column_lb, column_rb, [&rows, &writer](auto const &spans){
+				libbio_assert_eq(spans.size(), rows.size());
+				std::copy(spans.begin(), spans.end(), rows.begin());
+				writer.write_tile(rows);
+				return true;
+			});
+		}
+		
+		writer.finish();
+		lb::log_time(std::cerr) << "Done.\n";
+	}
+}
+
+
+int main(int argc, char **argv)
+{
+#ifndef NDEBUG
+	std::cerr << "Assertions have been enabled." << std::endl;
+#endif
+
+	gengetopt_args_info args_info;
+	if (0 != cmdline_parser(argc, argv, &args_info))
+		std::exit(EXIT_FAILURE);
+	
+	std::ios_base::sync_with_stdio(false);	// Don't use C style IO after calling cmdline_parser.
+	std::cin.tie(nullptr);					// We don't require any input from the user.
+	
+	if (args_info.tile_width_arg <= 0)
+	{
+		std::cerr << "ERROR: Tile width must be positive.\n";
+		std::exit(EXIT_FAILURE);
+	}
+	
+	if (args_info.fasta_input_flag)
+	{
+		fg::fasta_msa_reader reader;
+		pack_msa(reader, args_info.sequence_list_arg, args_info.tile_width_arg);
+	}
+	else if (args_info.bgzip_input_flag)
+	{
+		fg::bgzip_msa_reader reader;
+		pack_msa(reader, args_info.sequence_list_arg, args_info.tile_width_arg);
+	}
+	else
+	{
+		fg::text_msa_reader reader;
+		pack_msa(reader, args_info.sequence_list_arg, args_info.tile_width_arg);
+	}
+	
+	return EXIT_SUCCESS;
+}
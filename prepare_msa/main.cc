@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <cereal/archives/portable_binary.hpp>
+#include <founder_graphs/msa_index.hh>
+#include <founder_graphs/msa_index_builder.hh>
+#include <iostream>
+#include <libbio/file_handling.hh>
+#include <libbio/utility.hh>
+#include <optional>
+#include <string>
+#include <vector>
+#include "cmdline.h"
+
+namespace fg	= founder_graphs;
+namespace lb	= libbio;
+
+
+namespace {
+	
+	// Writes the outputs in the order of the sequence list.
+	class msa_preparer final : public fg::msa_index_builder_delegate
+	{
+	protected:
+		lb::file_ostream						&m_text_stream;
+		cereal::PortableBinaryOutputArchive		&m_index_archive;
+		lb::file_ostream						*m_statistics_stream{};
+		
+	public:
+		msa_preparer(
+			lb::file_ostream &text_stream,
+			cereal::PortableBinaryOutputArchive &index_archive,
+			lb::file_ostream *statistics_stream
+		):
+			m_text_stream(text_stream),
+			m_index_archive(index_archive),
+			m_statistics_stream(statistics_stream)
+		{
+		}
+		
+		void output_sequence(fg::msa_index_sequence const &seq) override;
+	};
+	
+	
+	void msa_preparer::output_sequence(fg::msa_index_sequence const &seq)
+	{
+		// Text, in the format expected by build_cst.
+		m_text_stream << '#';
+		for (auto const &chunk : seq.gap_free_chunks)
+			m_text_stream.write(chunk.data(), chunk.size());
+		
+		// Index.
+		m_index_archive(seq.index);
+		
+		// Statistics.
+		if (m_statistics_stream)
+		{
+			std::size_t const gap_count(seq.gap_count);
+			*m_statistics_stream
+				<< seq.path << '\t'
+				<< seq.size << '\t'
+				<< gap_count << '\t'
+				<< (seq.size - gap_count) << '\t'
+				<< fg::gap_vector_type_name(seq.index.type()) << '\t'
+				<< seq.index.size_in_bytes() << '\n';
+		}
+	}
+	
+	
+	void prepare_msa(gengetopt_args_info const &args_info)
+	{
+		std::vector <std::string> paths;
+		{
+			lb::file_istream stream;
+			lb::open_file_for_reading(args_info.sequence_list_arg, stream);
+			
+			std::string line;
+			while (std::getline(stream, line))
+				paths.push_back(line);
+		}
+		
+		// Open the outputs.
+		lb::file_ostream text_stream;
+		lb::file_ostream index_stream;
+		lb::open_file_for_writing(args_info.text_output_arg, text_stream, lb::writing_open_mode::CREATE);
+		lb::open_file_for_writing(args_info.msa_index_output_arg, index_stream, lb::writing_open_mode::CREATE);
+		
+		std::optional <lb::file_ostream> statistics_stream;
+		if (args_info.statistics_output_given)
+		{
+			lb::open_file_for_writing(args_info.statistics_output_arg, statistics_stream.emplace(), lb::writing_open_mode::CREATE);
+			*statistics_stream << "PATH\tALIGNED_LENGTH\tGAP_COUNT\tNON_GAP_COUNT\tGAP_VECTOR_TYPE\tGAP_VECTOR_BYTES\n";
+		}
+		
+		cereal::PortableBinaryOutputArchive index_archive(index_stream);
+		fg::msa_index::save_header(index_archive, paths.size());
+		
+		// Handle the inputs.
+		lb::log_time(std::cerr) << "Processing " << paths.size() << " sequences…\n";
+		msa_preparer preparer(text_stream, index_archive, (statistics_stream ? &*statistics_stream : nullptr));
+		fg::msa_index_builder builder(preparer, args_info.buffer_count_arg, args_info.size_slack_arg, args_info.gzip_input_flag, true);
+		for (auto const &path : paths)
+			builder.submit(path);
+		builder.finish();
+		
+		text_stream << std::flush;
+		index_stream << std::flush;
+		if (statistics_stream)
+			*statistics_stream << std::flush;
+		
+		lb::log_time(std::cerr) << "Done.\n";
+	}
+}
+
+
+int main(int argc, char **argv)
+{
+#ifndef NDEBUG
+	std::cerr << "Assertions have been enabled." << std::endl;
+#endif
+
+	gengetopt_args_info args_info;
+	if (0 != cmdline_parser(argc, argv, &args_info))
+		std::exit(EXIT_FAILURE);
+	
+	std::ios_base::sync_with_stdio(false);	// Don't use C style IO after calling cmdline_parser.
+	std::cin.tie(nullptr);					// We don't require any input from the user.
+	
+	if (args_info.buffer_count_arg <= 0)
+	{
+		std::cerr << "Buffer count must be positive.\n";
+		std::exit(EXIT_FAILURE);
+	}
+	
+	if (args_info.size_slack_arg < 0.0)
+	{
+		std::cerr << "Size slack must be non-negative.\n";
+		std::exit(EXIT_FAILURE);
+	}
+	
+	prepare_msa(args_info);
+	
+	return EXIT_SUCCESS;
+}
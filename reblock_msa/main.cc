@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <array>
+#include <filesystem>
+#include <founder_graphs/bgzip_writer.hh>
+#include <founder_graphs/sequence_reader.hh>
+#include <iostream>
+#include <libbio/assert.hh>
+#include <libbio/dispatch.hh>
+#include <libbio/file_handle.hh>
+#include <libbio/file_handling.hh>
+#include <libbio/utility.hh>
+#include <set>
+#include <span>
+#include <string>
+#include <vector>
+#include "cmdline.h"
+
+namespace fg	= founder_graphs;
+namespace fs	= std::filesystem;
+namespace lb	= libbio;
+
+
+namespace {
+	
+	struct reblock_options
+	{
+		std::size_t	block_size{};
+		std::size_t	chunk_size{};	// In blocks.
+		int			compression_level{};
+	};
+	
+	
+	// A number of consecutive blocks compressed in parallel.
+	struct chunk
+	{
+		std::vector <char>						uncompressed_data;
+		std::vector <char>						compressed_data;	// BGZF_BLOCK_MAX_SIZE bytes per block.
+		std::vector <std::size_t>				block_sizes;
+		lb::dispatch_ptr <dispatch_group_t>		group;
+		std::size_t								uncompressed_size{};
+		
+		chunk(reblock_options const &options):
+			uncompressed_data(options.block_size * options.chunk_size),
+			compressed_data(fg::BGZF_BLOCK_MAX_SIZE * options.chunk_size),
+			block_sizes(options.chunk_size),
+			group(dispatch_group_create())
+		{
+		}
+		
+		std::size_t block_count(std::size_t const block_size) const { return (uncompressed_size + block_size - 1) / block_size; }
+		
+		void read(fg::sequence_reader &reader) { uncompressed_size = reader.read(uncompressed_data); }
+		void compress(reblock_options const &options);
+		void wait();
+	};
+	
+	
+	void chunk::compress(reblock_options const &options)
+	{
+		auto const queue(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
+		auto const count(block_count(options.block_size));
+		for (std::size_t i(0); i < count; ++i)
+		{
+			// Each task writes to its own part of the buffers.
+			lb::dispatch_group_async_fn(*group, queue, [this, &options, i](){
+				auto const block_lb(i * options.block_size);
+				auto const block_rb(std::min(uncompressed_size, block_lb + options.block_size));
+				block_sizes[i] = fg::compress_bgzf_block(
+					std::span(uncompressed_data.data() + block_lb, block_rb - block_lb),
+					std::span(compressed_data.data() + i * fg::BGZF_BLOCK_MAX_SIZE, fg::BGZF_BLOCK_MAX_SIZE),
+					options.compression_level
+				);
+			});
+		}
+	}
+	
+	
+	void chunk::wait()
+	{
+		if (0 != dispatch_group_wait(*group, DISPATCH_TIME_FOREVER))
+			throw std::runtime_error("dispatch_group_wait failed even though DISPATCH_TIME_FOREVER was specified as timeout.");
+	}
+	
+	
+	// Returns the uncompressed size.
+	std::size_t reblock_sequence(
+		std::string const &input_path,
+		std::string const &output_path,
+		reblock_options const &options,
+		std::array <chunk, 2> &chunks
+	)
+	{
+		fg::sequence_reader reader(input_path);
+		
+		lb::file_ostream stream;
+		lb::open_file_for_writing(output_path, stream, lb::writing_open_mode::CREATE);
+		
+		fg::index_entry_vector index_entries;
+		index_entries.emplace_back(0, 0);
+		
+		// Read the next chunk while the current one is being compressed.
+		std::size_t current{};
+		chunks[current].read(reader);
+		chunks[current].compress(options);
+		while (true)
+		{
+			auto &current_chunk(chunks[current]);
+			auto &next_chunk(chunks[1 - current]);
+			if (0 == current_chunk.uncompressed_size)
+			{
+				current_chunk.wait();
+				break;
+			}
+			
+			next_chunk.read(reader);
+			next_chunk.compress(options);
+			current_chunk.wait();
+			
+			// Write the blocks.
+			auto const count(current_chunk.block_count(options.block_size));
+			for (std::size_t i(0); i < count; ++i)
+			{
+				auto const &last_entry(index_entries.back());
+				auto const block_size(current_chunk.block_sizes[i]);
+				auto const uncompressed_block_size(std::min(options.block_size, current_chunk.uncompressed_size - i * options.block_size));
+				stream.write(current_chunk.compressed_data.data() + i * fg::BGZF_BLOCK_MAX_SIZE, block_size);
+				index_entries.emplace_back(last_entry.compressed_offset + block_size, last_entry.uncompressed_offset + uncompressed_block_size);
+			}
+			
+			current = 1 - current;
+		}
+		
+		fg::write_bgzf_eof_marker(stream);
+		stream << std::flush;
+		
+		// The last entry refers to the EOF marker. If the input was empty, only the initial entry is left,
+		// and it is needed by write_bgzip_index().
+		auto const uncompressed_size(index_entries.back().uncompressed_offset);
+		if (1 < index_entries.size())
+			index_entries.pop_back();
+		
+		lb::file_ostream index_stream;
+		lb::open_file_for_writing(output_path + ".gzi", index_stream, lb::writing_open_mode::CREATE);
+		fg::write_bgzip_index(index_stream, index_entries);
+		index_stream << std::flush;
+		
+		return uncompressed_size;
+	}
+	
+	
+	std::string output_file_name(std::string const &input_path)
+	{
+		fs::path path(input_path);
+		if (".gz" == path.extension())
+			path.replace_extension();
+		return path.filename().string() + ".gz";
+	}
+	
+	
+	void reblock_msa(char const *sequence_list_path, char const *output_directory, reblock_options const &options)
+	{
+		std::vector <std::string> paths;
+		{
+			lb::file_istream stream;
+			lb::open_file_for_reading(sequence_list_path, stream);
+			
+			std::string line;
+			while (std::getline(stream, line))
+				paths.push_back(line);
+		}
+		
+		// Determine the output paths. The file names need to be distinct.
+		std::vector <std::string> output_paths;
+		{
+			std::set <std::string> output_names;
+			for (auto const &path : paths)
+			{
+				auto name(output_file_name(path));
+				if (!output_names.insert(name).second)
+				{
+					std::cerr << "ERROR: More than one input would be written to " << name << ".\n";
+					std::exit(EXIT_FAILURE);
+				}
+				
+				output_paths.push_back((fs::path(output_directory) / name).string());
+			}
+		}
+		
+		fs::create_directories(output_directory);
+		
+		std::array <chunk, 2> chunks{chunk(options), chunk(options)};
+		std::size_t aligned_size{SIZE_MAX};
+		for (std::size_t i(0); i < paths.size(); ++i)
+		{
+			lb::log_time(std::cerr) << "Compressing " << paths[i] << " (" << (1 + i) << '/' << paths.size() << ")…\n";
+			auto const size(reblock_sequence(paths[i], output_paths[i], options, chunks));
+			
+			// The block boundaries match only if the sequences have the same length.
+			if (SIZE_MAX == aligned_size)
+				aligned_size = size;
+			else if (size != aligned_size)
+			{
+				std::cerr << "ERROR: The length of " << paths[i] << " (" << size << ") differs from that of the preceding sequences (" << aligned_size << ").\n";
+				std::exit(EXIT_FAILURE);
+			}
+			
+			std::cout << output_paths[i] << '\n';
+		}
+		
+		std::cout << std::flush;
+		lb::log_time(std::cerr) << "Done.\n";
+	}
+}
+
+
+int main(int argc, char **argv)
+{
+#ifndef NDEBUG
+	std::cerr << "Assertions have been enabled." << std::endl;
+#endif
+
+	gengetopt_args_info args_info;
+	if (0 != cmdline_parser(argc, argv, &args_info))
+		std::exit(EXIT_FAILURE);
+	
+	std::ios_base::sync_with_stdio(false);	// Don't use C style IO after calling cmdline_parser.
+	std::cin.tie(nullptr);					// We don't require any input from the user.
+	
+	if (! (0 < args_info.block_size_arg && std::size_t(args_info.block_size_arg) <= fg::BGZF_BLOCK_UNCOMPRESSED_MAX_SIZE))
+	{
+		std::cerr << "ERROR: Block size must be positive and at most " << fg::BGZF_BLOCK_UNCOMPRESSED_MAX_SIZE << ".\n";
+		std::exit(EXIT_FAILURE);
+	}
+	
+	if (args_info.chunk_size_arg <= 0)
+	{
+		std::cerr << "ERROR: Chunk size must be positive.\n";
+		std::exit(EXIT_FAILURE);
+	}
+	
+	if (! (0 <= args_info.compression_level_arg && args_info.compression_level_arg <= 9))
+	{
+		std::cerr << "ERROR: Compression level must be between 0 and 9.\n";
+		std::exit(EXIT_FAILURE);
+	}
+	
+	reblock_options options;
+	options.block_size = args_info.block_size_arg;
+	options.chunk_size = args_info.chunk_size_arg;
+	options.compression_level = args_info.compression_level_arg;
+	
+	reblock_msa(args_info.sequence_list_arg, args_info.output_directory_arg, options);
+	
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <catch2/catch.hpp>
+#include <founder_graphs/batched_backward_search.hh>
+#include <range/v3/view/zip.hpp>
+#include <rapidcheck.h>
+#include <rapidcheck/catch.h>
+#include <sdsl/construct.hpp>
+#include <string>
+#include <vector>
+
+namespace fg	= founder_graphs;
+
+
+namespace {
+	
+	typedef fg::backward_search_query <fg::csa_type>	query_type;
+	
+	
+	struct search_input
+	{
+		std::string					text;
+		std::vector <std::string>	patterns;	// Used for generating the initial ranges.
+		std::string					characters;	// One per pattern.
+	};
+	
+	
+	std::ostream &operator<<(std::ostream &os, search_input const &input)
+	{
+		os << "Text: " << input.text << '\n';
+		for (auto const &[pattern, cc] : ranges::views::zip(input.patterns, input.characters))
+			os << "Pattern: " << pattern << " character: " << cc << '\n';
+		return os;
+	}
+	
+	
+	bool test_batched_backward_search(search_input const &input)
+	{
+		fg::csa_type csa;
+		sdsl::construct_im(csa, input.text, 1);
+		
+		// Determine the initial ranges and skip the empty ones.
+		std::vector <query_type> queries;
+		for (auto const &[pattern, cc] : ranges::views::zip(input.patterns, input.characters))
+		{
+			fg::csa_type::size_type lb{}, rb{};
+			if (sdsl::backward_search(csa, 0, csa.size() - 1, pattern.begin(), pattern.end(), lb, rb))
+				queries.emplace_back(lb, rb, cc);
+		}
+		
+		// Compare to sdsl::backward_search().
+		auto expected(queries);
+		for (auto &query : expected)
+			sdsl::backward_search(csa, query.lb, query.rb, query.cc, query.lb, query.rb);
+		
+		fg::batched_backward_search(csa, std::span <query_type>(queries));
+		
+		for (auto const &[query, expected_query] : ranges::views::zip(queries, expected))
+		{
+			// Compare the empty ranges by size only.
+			if (expected_query.empty() && query.empty())
+				continue;
+			
+			if (! (query.lb == expected_query.lb && query.rb == expected_query.rb))
+				return false;
+		}
+		
+		return true;
+	}
+}
+
+
+namespace rc {
+	
+	template <>
+	struct Arbitrary <search_input>
+	{
+		static Gen <search_input> arbitrary()
+		{
+			auto const char_gen(gen::element('A', 'C', 'G', 'T', 'N'));
+			return gen::mapcat(gen::inRange <std::size_t>(1, 128), [char_gen](std::size_t const pattern_count){
+				return gen::build <search_input>(
+					gen::set(&search_input::text, gen::nonEmpty(gen::container <std::string>(gen::element('A', 'C', 'G', 'T', '#')))),
+					gen::set(&search_input::patterns, gen::container <std::vector <std::string>>(pattern_count, gen::resize(4, gen::container <std::string>(char_gen)))),
+					gen::set(&search_input::characters, gen::container <std::string>(pattern_count, char_gen))
+				);
+			});
+		}
+	};
+}
+
+
+SCENARIO("batched_backward_search works on a simple input", "[batched_backward_search]")
+{
+	GIVEN("A text and some patterns")
+	{
+		search_input const input{
+			"ACGTACGT#AACCGGTT#ACGT#",
+			{"", "A", "CG", "GT#", "T", "TT", "ACGT", "C"},
+			"ACGTNT#A"
+		};
+		
+		WHEN("the ranges are extended with batched_backward_search")
+		{
+			THEN("the result matches that of sdsl::backward_search")
+			{
+				CHECK(test_batched_backward_search(input));
+			}
+		}
+	}
+}
+
+
+TEST_CASE("batched_backward_search produces the same ranges as sdsl::backward_search", "[batched_backward_search]")
+{
+	rc::prop("batched_backward_search matches sdsl::backward_search", [](search_input const &input){
+		return test_batched_backward_search(input);
+	});
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <founder_graphs/batched_file_reader.hh>
+#include <iterator>
+#include <libbio/file_handle.hh>
+#include <libbio/file_handling.hh>
+#include <rapidcheck.h>
+#include <rapidcheck/catch.h>
+#include <vector>
+
+namespace fg	= founder_graphs;
+namespace lb	= libbio;
+
+
+namespace {
+	
+	char const *TEST_FILE_PATH{"test-files/random-200000B.txt"};
+	
+	
+	std::vector <char> read_test_file()
+	{
+		lb::file_istream stream;
+		lb::open_file_for_reading(TEST_FILE_PATH, stream);
+		std::vector <char> retval;
+		std::copy(std::istreambuf_iterator <char>(stream), std::istreambuf_iterator <char>(), std::back_inserter(retval));
+		return retval;
+	}
+	
+	
+	// Read the given ranges from the same file opened a number of times s.t. the requests refer to different files.
+	bool test_batched_file_reader(std::vector <std::pair <std::size_t, std::size_t>> const &ranges, bool const should_use_io_uring, bool const should_register_buffer)
+	{
+		static auto const expected(read_test_file());
+		
+		std::vector <lb::file_handle> handles;
+		std::vector <int> fds;
+		for (std::size_t i(0); i < std::min(std::size_t(4), ranges.size()); ++i)
+			fds.push_back(handles.emplace_back(lb::open_file_for_reading(TEST_FILE_PATH)).get());
+		
+		fg::batched_file_reader reader;
+		if (should_use_io_uring)
+			reader.setup_io_uring(8); // Fewer than the requests in most cases.
+		reader.set_files(fds);
+		
+		// Prepare the buffer and the requests.
+		std::size_t total_length{};
+		for (auto const &[offset, length] : ranges)
+			total_length += length;
+		
+		std::vector <char> buffer(total_length, 0);
+		if (should_register_buffer)
+			reader.register_buffer(buffer);
+		
+		std::vector <fg::read_request> requests;
+		{
+			std::size_t buffer_offset{};
+			for (auto const &[offset, length] : ranges)
+			{
+				requests.push_back(fg::read_request{buffer.data() + buffer_offset, offset, length, std::uint32_t(requests.size() % fds.size())});
+				buffer_offset += length;
+			}
+		}
+		
+		reader.read(requests);
+		
+		// Compare.
+		for (auto const &req : requests)
+		{
+			if (!std::equal(req.buffer, req.buffer + req.length, expected.begin() + req.offset))
+				return false;
+		}
+		
+		return true;
+	}
+}
+
+
+SCENARIO("batched_file_reader reads the requested ranges", "[batched_file_reader]")
+{
+	GIVEN("A number of file ranges")
+	{
+		std::vector <std::pair <std::size_t, std::size_t>> const ranges{
+			{0, 1},
+			{100, 4096},
+			{199000, 1000},
+			{50000, 0},
+			{12345, 65536}
+		};
+		
+		WHEN("the ranges are read with pread")
+		{
+			THEN("the contents match the file")
+			{
+				CHECK(test_batched_file_reader(ranges, false, false));
+			}
+		}
+		
+		WHEN("the ranges are read with io_uring if available")
+		{
+			THEN("the contents match the file")
+			{
+				CHECK(test_batched_file_reader(ranges, true, false));
+				CHECK(test_batched_file_reader(ranges, true, true));
+			}
+		}
+	}
+}
+
+
+TEST_CASE("batched_file_reader reads arbitrary ranges", "[batched_file_reader]")
+{
+	rc::prop("The contents of the ranges match the file", [](bool const should_use_io_uring, bool const should_register_buffer){
+		auto const count(*rc::gen::inRange <std::size_t>(1, 64));
+		std::vector <std::pair <std::size_t, std::size_t>> ranges;
+		for (std::size_t i(0); i < count; ++i)
+		{
+			auto const offset(*rc::gen::inRange <std::size_t>(0, 200000));
+			auto const length(*rc::gen::inRange <std::size_t>(0, 1 + std::min(std::size_t(8192), 200000 - offset)));
+			ranges.emplace_back(offset, length);
+		}
+		
+		return test_batched_file_reader(ranges, should_use_io_uring, should_register_buffer);
+	});
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <algorithm>
+#include <array>
+#include <boost/format.hpp>
+#include <catch2/catch.hpp>
+#include <founder_graphs/msa_reader.hh>
+#include <iterator>
+#include <libbio/file_handling.hh>
+#include <memory>
+#include <mutex>
+#include <rapidcheck.h>
+#include <rapidcheck/catch.h>
+#include <string>
+#include <vector>
+
+namespace fg	= founder_graphs;
+namespace lb	= libbio;
+
+
+namespace {
+	
+	constexpr static std::size_t const INPUT_COUNT{4};
+	typedef std::array <std::vector <char>, INPUT_COUNT> expected_data_array;
+	
+	
+	expected_data_array const &expected_data()
+	{
+		static expected_data_array retval;
+		static std::once_flag flag;
+		std::call_once(flag, [](){
+			boost::format fmt("test-files/equal-length-1/%d");
+			for (std::size_t i(0); i < INPUT_COUNT; ++i)
+			{
+				lb::file_istream input;
+				lb::open_file_for_reading(boost::str(fmt % (1 + i)), input);
+				std::copy(
+					std::istreambuf_iterator <char>(input),
+					std::istreambuf_iterator <char>(),
+					std::back_inserter(retval[i])
+				);
+			}
+		});
+		return retval;
+	}
+	
+	
+	void prepare_reader(fg::bgzip_random_access_msa_reader &reader, std::string const &directory, std::size_t const cache_size)
+	{
+		reader.set_cache(std::make_shared <fg::bgzip_block_cache>(cache_size));
+		
+		boost::format fmt("test-files/%s/%d.gz");
+		for (std::size_t i(0); i < INPUT_COUNT; ++i)
+			reader.add_file(boost::str(fmt % directory % (1 + i)));
+		
+		reader.prepare();
+	}
+	
+	
+	bool check_region(
+		fg::bgzip_random_access_msa_reader &reader,
+		std::size_t const row_lb,
+		std::size_t const row_rb,
+		std::size_t const column_lb,
+		std::size_t const column_rb
+	)
+	{
+		auto const &expected(expected_data());
+		auto const width(column_rb - column_lb);
+		std::vector <char> buffer((row_rb - row_lb) * width);
+		reader.read(row_lb, row_rb, column_lb, column_rb, std::span(buffer));
+		
+		for (std::size_t row(row_lb); row < row_rb; ++row)
+		{
+			auto const it(buffer.begin() + (row - row_lb) * width);
+			if (!std::equal(it, it + width, expected[row].begin() + column_lb, expected[row].begin() + column_rb))
+				return false;
+		}
+		
+		return true;
+	}
+}
+
+
+SCENARIO("bgzip_random_access_msa_reader can read a set of files in order", "[bgzip_random_access_msa_reader]")
+{
+	GIVEN("a set of bgzip files")
+	{
+		auto const &expected(expected_data());
+		REQUIRE(0 < expected.front().size());
+		
+		// The files in unequal-blocks-1 have the same contents but were compressed with different block sizes.
+		auto const directory(GENERATE(as <std::string>{}, "equal-length-1", "unequal-blocks-1"));
+		fg::bgzip_random_access_msa_reader reader;
+		prepare_reader(reader, directory, fg::BGZIP_BLOCK_CACHE_SIZE_DEFAULT);
+		REQUIRE(reader.aligned_size() == expected.front().size());
+		REQUIRE(reader.handle_count() == INPUT_COUNT);
+		
+		WHEN(boost::str(boost::format("the files in %s are read with fill_buffer()") % directory))
+		{
+			THEN("the contents match the originals")
+			{
+				std::size_t const step(1000);
+				std::size_t const aligned_size(reader.aligned_size());
+				for (std::size_t lb(0); lb < aligned_size; lb += step)
+				{
+					auto const rb(std::min(aligned_size, lb + step));
+					REQUIRE(reader.fill_buffer(lb, rb, [&](auto const &spans){
+						REQUIRE(spans.size() == INPUT_COUNT);
+						for (std::size_t i(0); i < INPUT_COUNT; ++i)
+						{
+							auto const &span(spans[i]);
+							REQUIRE(std::equal(span.begin(), span.end(), expected[i].begin() + lb, expected[i].begin() + rb));
+						}
+						return true;
+					}));
+				}
+			}
+		}
+		
+		WHEN(boost::str(boost::format("the same region of the files in %s is read twice") % directory))
+		{
+			THEN("the second read is served from the cache")
+			{
+				auto &cache(*reader.cache());
+				auto const column_rb(std::min(std::size_t(5000), reader.aligned_size()));
+				REQUIRE(check_region(reader, 0, INPUT_COUNT, 0, column_rb));
+				auto const miss_count(cache.miss_count());
+				REQUIRE(0 < miss_count);
+				REQUIRE(check_region(reader, 0, INPUT_COUNT, 0, column_rb));
+				REQUIRE(cache.miss_count() == miss_count);
+				REQUIRE(0 < cache.hit_count());
+			}
+		}
+	}
+}
+
+
+TEST_CASE("bgzip_random_access_msa_reader can read arbitrary regions", "[bgzip_random_access_msa_reader]")
+{
+	// Use a small cache to exercise eviction.
+	auto const cache_size(GENERATE(std::size_t(1), fg::BGZIP_BLOCK_CACHE_SIZE_DEFAULT));
+	fg::bgzip_random_access_msa_reader reader;
+	prepare_reader(reader, "unequal-blocks-1", cache_size);
+	
+	rc::prop("The region matches the original", [&reader](){
+		auto const aligned_size(reader.aligned_size());
+		auto const row_lb(*rc::gen::inRange <std::size_t>(0, INPUT_COUNT));
+		auto const row_rb(*rc::gen::inRange <std::size_t>(1 + row_lb, 1 + INPUT_COUNT));
+		auto const column_lb(*rc::gen::inRange <std::size_t>(0, aligned_size));
+		auto const column_rb(*rc::gen::inRange <std::size_t>(column_lb, 1 + aligned_size));
+		RC_ASSERT(check_region(reader, row_lb, row_rb, column_lb, column_rb));
+	});
+}
@@ -41,7 +41,9 @@ SCENARIO("bgzip_reader can read a file")
 	GIVEN("a bgzip file")
 	{
 		// Compressed file
+		auto const access_mode(GENERATE(fg::bgzip_access_mode::pread, fg::bgzip_access_mode::mmap));
 		fg::bgzip_reader bgzip_reader;
+		bgzip_reader.set_access_mode(access_mode);
 		bgzip_reader.open("test-files/random-200000B.txt.gz");
 		
 		// Expected contents
@@ -69,7 +71,9 @@ SCENARIO("bgzip_reader can read a file")
 	GIVEN("A bgzip file")
 	{
 		// Compressed file
+		auto const access_mode(GENERATE(fg::bgzip_access_mode::pread, fg::bgzip_access_mode::mmap));
 		fg::bgzip_reader bgzip_reader;
+		bgzip_reader.set_access_mode(access_mode);
 		bgzip_reader.open("test-files/random-200000B.txt.gz");
 		
 		// Expected contnets
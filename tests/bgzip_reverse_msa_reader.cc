@@ -8,6 +8,7 @@
 #include <catch2/catch.hpp>
 #include <founder_graphs/reverse_msa_reader.hh>
 #include <libbio/file_handling.hh>
+#include <string>
 
 namespace fg	= founder_graphs;
 namespace gen	= Catch::Generators;
@@ -72,20 +73,25 @@ SCENARIO("bgzip_reverse_msa_reader can read a set of files")
 			REQUIRE(0 < expected_data.front().size());
 		}
 		
-		// Compressed files
+		// Compressed files. The files in unequal-blocks-1 have the same contents but were compressed with different block sizes.
+		auto const layout(GENERATE(fg::msa_buffer_layout::row_major, fg::msa_buffer_layout::column_major));
+		auto const directory(GENERATE(as <std::string>{}, "equal-length-1", "unequal-blocks-1"));
+		auto const read_ahead_block_count(GENERATE(0, 2));
 		fg::bgzip_reverse_msa_reader msa_reader;
+		msa_reader.set_layout(layout);
+		msa_reader.set_read_ahead_block_count(read_ahead_block_count);
 		{
-			boost::format fmt("test-files/equal-length-1/%d.gz");
+			boost::format fmt("test-files/%s/%d.gz");
 			for (std::size_t i(0); i < input_count; ++i)
 			{
-				auto const fname(boost::str(fmt % (1 + i)));
+				auto const fname(boost::str(fmt % directory % (1 + i)));
 				msa_reader.add_file(fname);
 			}
 			
 			msa_reader.prepare();
 		}
 		
-		WHEN("the files are read")
+		WHEN(boost::str(boost::format("the files in %s are read using the %s layout") % directory % (fg::msa_buffer_layout::row_major == layout ? "row-major" : "column-major")))
 		{
 			THEN("the contents match the originals")
 			{
@@ -115,9 +121,12 @@ SCENARIO("bgzip_reverse_msa_reader can read a set of files")
 							auto const &expected_seq(expected_data[i]);
 							for (std::size_t j(0); j < block_size; ++j)
 							{
-								auto const buffer_pos((i + 1) * block_size - j - 1);
+								auto const buffer_pos(fg::msa_buffer_layout::row_major == msa_reader.layout() ? (i + 1) * block_size - j - 1 : j * input_count + i);
 								auto const expected_seq_pos(input_size - (base_position + j) - 1);
 								REQUIRE(buffer[buffer_pos] == expected_seq[expected_seq_pos]);
+								REQUIRE(msa_reader.character(j, i) == expected_seq[expected_seq_pos]);
+								if (fg::msa_buffer_layout::column_major == msa_reader.layout())
+									REQUIRE(msa_reader.column(j)[i] == expected_seq[expected_seq_pos]);
 								++handled_characters;
 							}
 						}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <founder_graphs/bgzip_reader.hh>
+#include <founder_graphs/bgzip_writer.hh>
+#include <fstream>
+#include <rapidcheck.h>
+#include <rapidcheck/catch.h>
+#include <string>
+#include <vector>
+
+namespace fg	= founder_graphs;
+
+
+namespace {
+	
+	std::string const BGZIP_WRITER_TEST_PATH((std::filesystem::temp_directory_path() / "founder-graphs-bgzip-writer-test.gz").string());
+	
+	
+	// Compress the data in blocks of the given size and write the index.
+	void write_bgzip_file(std::string const &data, std::size_t const block_size, int const compression_level)
+	{
+		std::ofstream stream(BGZIP_WRITER_TEST_PATH, std::ios_base::binary | std::ios_base::trunc);
+		REQUIRE(stream.is_open());
+		
+		fg::index_entry_vector entries;
+		entries.emplace_back(0, 0);
+		std::vector <char> buffer(fg::BGZF_BLOCK_MAX_SIZE);
+		for (std::size_t lb(0); lb < data.size(); lb += block_size)
+		{
+			auto const rb(std::min(data.size(), lb + block_size));
+			auto const size(fg::compress_bgzf_block(std::span(data.data() + lb, rb - lb), buffer, compression_level));
+			stream.write(buffer.data(), size);
+			entries.emplace_back(entries.back().compressed_offset + size, rb);
+		}
+		
+		fg::write_bgzf_eof_marker(stream);
+		REQUIRE(stream.good());
+		
+		// The last entry refers to the EOF marker. The initial entry is kept if the data is empty.
+		if (1 < entries.size())
+			entries.pop_back();
+		std::ofstream index_stream(BGZIP_WRITER_TEST_PATH + ".gzi", std::ios_base::binary | std::ios_base::trunc);
+		REQUIRE(index_stream.is_open());
+		fg::write_bgzip_index(index_stream, entries);
+		REQUIRE(index_stream.good());
+	}
+	
+	
+	bool test_bgzip_writer(std::string const &data, std::size_t const block_size, int const compression_level)
+	{
+		write_bgzip_file(data, block_size, compression_level);
+		
+		fg::bgzip_reader reader;
+		reader.open(BGZIP_WRITER_TEST_PATH);
+		
+		auto const expected_block_count((data.size() + block_size - 1) / block_size);
+		if (! (reader.uncompressed_size() == data.size() && reader.block_count() == expected_block_count))
+			return false;
+		
+		if (0 == expected_block_count)
+			return true;
+		
+		// Decompress all the blocks at once.
+		std::vector <char> input_buffer;
+		std::string output(data.size(), '\0');
+		auto const input(reader.read_blocks(0, expected_block_count, input_buffer));
+		reader.decompress(0, expected_block_count, input, std::span(output.data(), output.size()));
+		return output == data;
+	}
+}
+
+
+SCENARIO("bgzip_writer produces files that bgzip_reader can read", "[bgzip_writer]")
+{
+	GIVEN("Some text")
+	{
+		std::string text;
+		for (std::size_t i(0); i < 200000; ++i)
+			text.push_back("ACGTN-"[(i * i + 7 * i) % 6]);
+		
+		WHEN("the text is compressed with the default block size")
+		{
+			THEN("the decompressed text matches the original")
+			{
+				CHECK(test_bgzip_writer(text, fg::BGZF_BLOCK_UNCOMPRESSED_MAX_SIZE, 6));
+			}
+		}
+		
+		WHEN("the text is compressed without compression")
+		{
+			THEN("the decompressed text matches the original")
+			{
+				CHECK(test_bgzip_writer(text, fg::BGZF_BLOCK_UNCOMPRESSED_MAX_SIZE, 0));
+			}
+		}
+	}
+}
+
+
+SCENARIO("bgzip_writer handles empty input", "[bgzip_writer]")
+{
+	GIVEN("An empty text")
+	{
+		std::string const text;
+		
+		WHEN("the text is compressed")
+		{
+			THEN("the file consists of the EOF marker and can be read")
+			{
+				CHECK(test_bgzip_writer(text, fg::BGZF_BLOCK_UNCOMPRESSED_MAX_SIZE, 6));
+			}
+		}
+	}
+}
+
+
+TEST_CASE("bgzip_writer handles arbitrary block sizes", "[bgzip_writer]")
+{
+	rc::prop("The decompressed text matches the original", [](std::string const &suffix){
+		auto const block_size(*rc::gen::inRange <std::size_t>(1, 1 + fg::BGZF_BLOCK_UNCOMPRESSED_MAX_SIZE));
+		auto const compression_level(*rc::gen::inRange(0, 10));
+		auto const data("A" + suffix); // Non-empty.
+		RC_ASSERT(test_bgzip_writer(data, block_size, compression_level));
+	});
+}
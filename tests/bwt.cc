@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <catch2/catch.hpp>
+#include <founder_graphs/bwt.hh>
+#include <rapidcheck.h>
+#include <rapidcheck/catch.h>
+#include <string>
+#include "naive_suffix_array.hh"
+
+namespace fg	= founder_graphs;
+namespace fgt	= founder_graphs::tests;
+
+
+namespace {
+	
+	bool test_construct_bwt_parallel(std::string const &text_, std::size_t const partition_count)
+	{
+		fgt::naive_suffix_array const expected(text_);
+		auto const sa(expected.sa_vector());
+		
+		sdsl::int_vector <8> bwt;
+		fg::construct_bwt_parallel(expected.text, sa, bwt, partition_count);
+		
+		if (bwt.size() != expected.size())
+			return false;
+		
+		for (std::size_t i(0); i < expected.size(); ++i)
+		{
+			if (bwt[i] != std::uint8_t(expected.bwt[i]))
+				return false;
+		}
+		
+		return true;
+	}
+}
+
+
+TEST_CASE("construct_bwt_parallel handles arbitrary texts", "[bwt]")
+{
+	rc::prop("The BWT matches the naïvely computed one", [](){
+		auto const text(*rc::gen::container <std::string>(rc::gen::elementOf(std::string("#ACGT"))));
+		auto const partition_count(*rc::gen::inRange <std::size_t>(1, 17));
+		RC_ASSERT(test_construct_bwt_parallel(text, partition_count));
+	});
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <founder_graphs/external_suffix_array.hh>
+#include <rapidcheck.h>
+#include <rapidcheck/catch.h>
+#include <sdsl/int_vector.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "naive_suffix_array.hh"
+
+namespace fg	= founder_graphs;
+namespace fgt	= founder_graphs::tests;
+
+
+namespace {
+	
+	struct naive_block_sorter final : public fg::external_suffix_array_block_sorter
+	{
+		void sort_block(std::span <std::uint8_t> const block, std::span <std::int32_t> const sa) override
+		{
+			std::vector <std::size_t> suffixes;
+			fgt::sort_suffixes(block, suffixes);
+			REQUIRE(suffixes.size() == sa.size());
+			std::copy(suffixes.begin(), suffixes.end(), sa.begin());
+		}
+	};
+	
+	
+	bool test_external_suffix_array_builder(std::string const &text, std::size_t const block_size)
+	{
+		naive_block_sorter sorter;
+		fg::external_suffix_array_builder builder(text, std::filesystem::temp_directory_path().string(), sorter);
+		
+		std::stringstream stream;
+		builder.build(block_size, stream);
+		
+		sdsl::int_vector <0> sa;
+		sa.load(stream);
+		
+		fgt::naive_suffix_array const expected(text);
+		if (sa.size() != expected.size())
+			return false;
+		
+		for (std::size_t i(0); i < expected.size(); ++i)
+		{
+			if (sa[i] != expected.sa[i])
+				return false;
+		}
+		
+		return true;
+	}
+}
+
+
+SCENARIO("external_suffix_array_builder builds the suffix array of a concatenated text", "[external_suffix_array]")
+{
+	GIVEN("A text with repeated sequences")
+	{
+		std::string const text("#AACGTAACG#AACGTTACG#AACGTAACG#AACGTAACG");
+		
+		WHEN("the suffix array is built in one block")
+		{
+			THEN("it matches the expected one")
+			{
+				CHECK(test_external_suffix_array_builder(text, 1 + text.size()));
+			}
+		}
+		
+		WHEN("the suffix array is built in blocks shorter than the sequences")
+		{
+			THEN("it matches the expected one")
+			{
+				CHECK(test_external_suffix_array_builder(text, 3));
+			}
+		}
+		
+		WHEN("the suffix array is built in blocks of one character")
+		{
+			THEN("it matches the expected one")
+			{
+				CHECK(test_external_suffix_array_builder(text, 1));
+			}
+		}
+	}
+}
+
+
+TEST_CASE("external_suffix_array_builder handles arbitrary texts", "[external_suffix_array]")
+{
+	rc::prop("The suffix array matches the naïvely computed one", [](){
+		auto const text(*rc::gen::container <std::string>(rc::gen::elementOf(std::string("#ACGT"))));
+		auto const block_size(*rc::gen::inRange <std::size_t>(1, 2 + text.size()));
+		RC_ASSERT(test_external_suffix_array_builder(text, block_size));
+	});
+}
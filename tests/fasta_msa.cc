@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <founder_graphs/msa_reader.hh>
+#include <founder_graphs/reverse_msa_reader.hh>
+#include <fstream>
+#include <rapidcheck.h>
+#include <rapidcheck/catch.h>
+#include <string>
+#include <vector>
+
+namespace fg	= founder_graphs;
+
+
+namespace {
+	
+	std::string const FASTA_MSA_TEST_PATH((std::filesystem::temp_directory_path() / "founder-graphs-fasta-msa-test.fa").string());
+	
+	
+	// Write the rows with the given line length and the corresponding index.
+	void write_fasta_msa(std::vector <std::string> const &rows, std::size_t const line_length, std::string const &path)
+	{
+		std::ofstream stream(path, std::ios_base::binary | std::ios_base::trunc);
+		std::ofstream index_stream(path + ".fai", std::ios_base::binary | std::ios_base::trunc);
+		REQUIRE(stream.is_open());
+		REQUIRE(index_stream.is_open());
+		
+		std::size_t offset{};
+		for (std::size_t i(0); i < rows.size(); ++i)
+		{
+			auto const header(">seq" + std::to_string(i) + " description\n");
+			stream << header;
+			offset += header.size();
+			
+			auto const &row(rows[i]);
+			index_stream << "seq" << i << '\t' << row.size() << '\t' << offset << '\t' << line_length << '\t' << (1 + line_length) << '\n';
+			for (std::size_t j(0); j < row.size(); j += line_length)
+			{
+				auto const line(row.substr(j, line_length));
+				stream << line << '\n';
+				offset += 1 + line.size();
+			}
+		}
+	}
+	
+	
+	bool test_reverse_reader(std::vector <std::string> const &rows, std::size_t const block_size, fg::msa_buffer_layout const layout)
+	{
+		auto const row_count(rows.size());
+		auto const aligned_size(rows.front().size());
+		
+		fg::fasta_reverse_msa_reader reader;
+		reader.set_layout(layout);
+		reader.set_block_size(block_size);
+		reader.add_file(FASTA_MSA_TEST_PATH);
+		reader.prepare();
+		
+		if (! (reader.handle_count() == row_count && reader.aligned_size() == aligned_size))
+			return false;
+		
+		bool retval(true);
+		std::size_t base_position{};
+		while (reader.fill_buffer([&](bool const did_read){
+			if (!did_read)
+				return false;
+			
+			auto const current_block_size(reader.block_size());
+			for (std::size_t i(0); i < current_block_size; ++i)
+			{
+				auto const column(aligned_size - base_position - i - 1);
+				for (std::size_t j(0); j < row_count; ++j)
+				{
+					if (reader.character(i, j) != rows[j][column])
+						retval = false;
+				}
+			}
+			
+			base_position += current_block_size;
+			return true;
+		}));
+		
+		return retval && base_position == aligned_size;
+	}
+	
+	
+	bool test_forward_reader(std::vector <std::string> const &rows, std::size_t const lb, std::size_t const rb)
+	{
+		fg::fasta_msa_reader reader;
+		reader.add_file(FASTA_MSA_TEST_PATH);
+		reader.prepare();
+		
+		if (! (reader.handle_count() == rows.size() && reader.aligned_size() == rows.front().size()))
+			return false;
+		
+		return reader.fill_buffer(lb, rb, [&rows, lb, rb](auto const &spans){
+			if (spans.size() != rows.size())
+				return false;
+			
+			for (std::size_t i(0); i < rows.size(); ++i)
+			{
+				auto const &span(spans[i]);
+				if (! std::equal(span.begin(), span.end(), rows[i].begin() + lb, rows[i].begin() + rb))
+					return false;
+			}
+			
+			return true;
+		});
+	}
+}
+
+
+SCENARIO("An indexed FASTA MSA can be read in both directions", "[fasta_msa]")
+{
+	GIVEN("Some aligned sequences in a FASTA file with wrapped lines")
+	{
+		std::vector <std::string> const rows{
+			"AC--GT-ANNAC",
+			"------------",
+			"ACGTACGTACGT",
+			"-A-C-G-T-A-C"
+		};
+		
+		auto const line_length(GENERATE(1, 5, 12, 64));
+		write_fasta_msa(rows, line_length, FASTA_MSA_TEST_PATH);
+		
+		WHEN("the MSA is read from right to left")
+		{
+			THEN("the columns match the rows in both layouts")
+			{
+				CHECK(test_reverse_reader(rows, 5, fg::msa_buffer_layout::row_major));
+				CHECK(test_reverse_reader(rows, 5, fg::msa_buffer_layout::column_major));
+			}
+		}
+		
+		WHEN("ranges of the MSA are read from left to right")
+		{
+			THEN("the ranges match the rows")
+			{
+				CHECK(test_forward_reader(rows, 0, 12));
+				CHECK(test_forward_reader(rows, 3, 9));
+				CHECK(test_forward_reader(rows, 11, 12));
+			}
+		}
+	}
+}
+
+
+TEST_CASE("Reading an indexed FASTA MSA reproduces the input", "[fasta_msa]")
+{
+	rc::prop("The read columns match the input rows", [](){
+		auto const aligned_size(*rc::gen::inRange <std::size_t>(1, 64));
+		auto const line_length(*rc::gen::inRange <std::size_t>(1, 2 + aligned_size));
+		auto const block_size(*rc::gen::inRange <std::size_t>(1, 2 + aligned_size));
+		auto const rows(*rc::gen::nonEmpty(rc::gen::container <std::vector <std::string>>(
+			rc::gen::container <std::string>(aligned_size, rc::gen::element('A', 'C', 'G', 'T', 'N', '-'))
+		)));
+		auto const lb(*rc::gen::inRange <std::size_t>(0, aligned_size));
+		auto const rb(*rc::gen::inRange <std::size_t>(1 + lb, 1 + aligned_size));
+		
+		write_fasta_msa(rows, line_length, FASTA_MSA_TEST_PATH);
+		RC_ASSERT(test_reverse_reader(rows, block_size, fg::msa_buffer_layout::row_major));
+		RC_ASSERT(test_reverse_reader(rows, block_size, fg::msa_buffer_layout::column_major));
+		RC_ASSERT(test_forward_reader(rows, lb, rb));
+	});
+}
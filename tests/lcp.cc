@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <catch2/catch.hpp>
+#include <founder_graphs/lcp.hh>
+#include <rapidcheck.h>
+#include <rapidcheck/catch.h>
+#include <stdexcept>
+#include <string>
+#include "naive_suffix_array.hh"
+
+namespace fg	= founder_graphs;
+namespace fgt	= founder_graphs::tests;
+
+
+namespace {
+	
+	bool test_construct_lcp_parallel(std::string const &text_, std::size_t const partition_count)
+	{
+		fgt::naive_suffix_array const expected(text_);
+		auto const sa(expected.sa_vector());
+		
+		sdsl::int_vector <0> lcp;
+		fg::construct_lcp_parallel(expected.text, sa, lcp, partition_count);
+		
+		if (lcp.size() != expected.size())
+			return false;
+		
+		for (std::size_t i(0); i < expected.size(); ++i)
+		{
+			if (lcp[i] != expected.lcp[i])
+				return false;
+		}
+		
+		return true;
+	}
+}
+
+
+SCENARIO("construct_lcp_parallel builds the LCP array of a concatenated text", "[lcp]")
+{
+	GIVEN("A text with repeated sequences")
+	{
+		std::string const text("#AACGTAACG#AACGTTACG#AACGTAACG");
+		
+		WHEN("the LCP array is built with one partition")
+		{
+			THEN("it matches the expected one")
+			{
+				CHECK(test_construct_lcp_parallel(text, 1));
+			}
+		}
+		
+		WHEN("the LCP array is built with more partitions than characters")
+		{
+			THEN("it matches the expected one")
+			{
+				CHECK(test_construct_lcp_parallel(text, 64));
+			}
+		}
+	}
+	
+	GIVEN("A text with a zero character before the terminator")
+	{
+		std::string const text("#AACG\0TAACG", 11);
+		
+		WHEN("the LCP array is built")
+		{
+			THEN("the text is rejected")
+			{
+				CHECK_THROWS_AS(test_construct_lcp_parallel(text, 4), std::runtime_error);
+			}
+		}
+	}
+}
+
+
+TEST_CASE("construct_lcp_parallel handles arbitrary texts", "[lcp]")
+{
+	rc::prop("The LCP array matches the naïvely computed one", [](){
+		auto const text(*rc::gen::container <std::string>(rc::gen::elementOf(std::string("#ACGT"))));
+		auto const partition_count(*rc::gen::inRange <std::size_t>(1, 17));
+		RC_ASSERT(test_construct_lcp_parallel(text, partition_count));
+	});
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <founder_graphs/msa_index.hh>
+#include <rapidcheck.h>
+#include <rapidcheck/catch.h>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fg	= founder_graphs;
+
+
+namespace {
+	
+	bool check_gaps(std::string const &text, sdsl::bit_vector const &gaps, std::size_t const pos)
+	{
+		for (std::size_t i(0); i < gaps.size(); ++i)
+		{
+			bool const expected(pos <= i && i < pos + text.size() && '-' == text[i - pos]);
+			if (gaps[i] != expected)
+				return false;
+		}
+		
+		return true;
+	}
+}
+
+
+TEST_CASE("mark_gaps sets the bits of the gap characters", "[mark_gaps]")
+{
+	rc::prop("The bits match the gap characters", [](){
+		auto const text(*rc::gen::container <std::string>(rc::gen::element('A', 'C', 'G', 'T', '-')));
+		auto const pos(*rc::gen::inRange <std::size_t>(0, 200));
+		
+		sdsl::bit_vector gaps(pos + text.size() + 64, 0);
+		auto const gap_count(fg::mark_gaps(text, gaps.data(), pos));
+		RC_ASSERT(gap_count == std::size_t(std::count(text.begin(), text.end(), '-')));
+		RC_ASSERT(check_gaps(text, gaps, pos));
+	});
+}
+
+
+TEST_CASE("mark_gaps can be called for adjacent ranges", "[mark_gaps]")
+{
+	rc::prop("The bits match the gap characters", [](){
+		auto const text(*rc::gen::container <std::string>(rc::gen::element('A', 'C', 'G', 'T', '-')));
+		auto const split_pos(*rc::gen::inRange <std::size_t>(0, 1 + text.size()));
+		
+		sdsl::bit_vector gaps(text.size(), 0);
+		auto const gap_count(
+			fg::mark_gaps(std::span(text.data() + split_pos, text.size() - split_pos), gaps.data(), split_pos) +
+			fg::mark_gaps(std::span(text.data(), split_pos), gaps.data(), 0)
+		);
+		RC_ASSERT(gap_count == std::size_t(std::count(text.begin(), text.end(), '-')));
+		RC_ASSERT(check_gaps(text, gaps, 0));
+	});
+}
+
+
+TEST_CASE("aligned_sequence_index supports rank0 and select0 with all the gap vector types", "[aligned_sequence_index]")
+{
+	rc::prop("rank0 and select0 match the gap positions", [](){
+		// Generate runs of gaps and non-gap characters.
+		auto const runs(*rc::gen::container <std::vector <std::pair <bool, std::uint8_t>>>(rc::gen::pair(rc::gen::arbitrary <bool>(), rc::gen::inRange <std::uint8_t>(1, 100))));
+		std::string text;
+		for (auto const &[is_gap, length] : runs)
+			text.append(length, is_gap ? '-' : 'A');
+		
+		sdsl::bit_vector gaps(text.size(), 0);
+		fg::mark_gaps(text, gaps.data(), 0);
+		
+		auto const type(*rc::gen::element(fg::gap_vector_type::rrr, fg::gap_vector_type::sd, fg::gap_vector_type::run_length));
+		fg::aligned_sequence_index const seq_idx(gaps, type);
+		RC_ASSERT(seq_idx.type() == type);
+		RC_ASSERT(seq_idx.size() == text.size());
+		
+		std::size_t non_gap_count{};
+		for (std::size_t i(0); i < text.size(); ++i)
+		{
+			RC_ASSERT(seq_idx.rank0(i) == non_gap_count);
+			RC_ASSERT(seq_idx.is_gap(i) == ('-' == text[i]));
+			if ('-' != text[i])
+			{
+				++non_gap_count;
+				RC_ASSERT(seq_idx.select0(non_gap_count) == i);
+			}
+		}
+		
+		RC_ASSERT(seq_idx.rank0(text.size()) == non_gap_count);
+	});
+}
+
+
+TEST_CASE("aligned_sequence_index chooses the smallest gap vector without size slack", "[aligned_sequence_index]")
+{
+	rc::prop("The chosen gap vector is not larger than the others", [](std::vector <bool> const &bits){
+		sdsl::bit_vector gaps(bits.size(), 0);
+		for (std::size_t i(0); i < bits.size(); ++i)
+			gaps[i] = bits[i];
+		
+		fg::aligned_sequence_index const seq_idx(gaps, 0.0);
+		for (auto const type : {fg::gap_vector_type::rrr, fg::gap_vector_type::sd, fg::gap_vector_type::run_length})
+			RC_ASSERT(seq_idx.size_in_bytes() <= fg::aligned_sequence_index(gaps, type).size_in_bytes());
+	});
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#ifndef FOUNDER_GRAPHS_TESTS_NAIVE_SUFFIX_ARRAY_HH
+#define FOUNDER_GRAPHS_TESTS_NAIVE_SUFFIX_ARRAY_HH
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <sdsl/int_vector.hpp>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+namespace founder_graphs::tests {
+	
+	// Sort the suffixes naïvely. A suffix that is a prefix of another one is the smaller one.
+	// The characters are compared as unsigned, as in SDSL.
+	template <typename t_string>
+	void sort_suffixes(t_string const &text, std::vector <std::size_t> &suffixes)
+	{
+		suffixes.resize(text.size());
+		std::iota(suffixes.begin(), suffixes.end(), 0);
+		std::sort(suffixes.begin(), suffixes.end(), [&text](auto const lhs, auto const rhs){
+			return std::lexicographical_compare(
+				text.begin() + lhs,
+				text.end(),
+				text.begin() + rhs,
+				text.end(),
+				[](auto const lhs_, auto const rhs_){ return std::uint8_t(lhs_) < std::uint8_t(rhs_); }
+			);
+		});
+	}
+	
+	
+	// The suffix array, its inverse, the LCP array and the BWT of a zero-terminated copy of the given text
+	// determined naïvely.
+	struct naive_suffix_array
+	{
+		sdsl::int_vector <8>		text;	// Zero-terminated.
+		std::vector <std::size_t>	sa;
+		std::vector <std::size_t>	isa;
+		std::vector <std::size_t>	lcp;
+		std::string					bwt;
+		
+		explicit naive_suffix_array(std::string_view const text_):
+			text(1 + text_.size(), 0),
+			isa(1 + text_.size()),
+			lcp(1 + text_.size(), 0),
+			bwt(1 + text_.size(), '\0')
+		{
+			std::copy(text_.begin(), text_.end(), text.begin());
+			
+			auto const text__(text_view());
+			sort_suffixes(text__, sa);
+			
+			for (std::size_t i(0); i < sa.size(); ++i)
+			{
+				isa[sa[i]] = i;
+				bwt[i] = text__[sa[i] ? sa[i] - 1 : text__.size() - 1];
+				if (i)
+				{
+					auto const lhs(text__.substr(sa[i - 1]));
+					auto const rhs(text__.substr(sa[i]));
+					lcp[i] = std::mismatch(lhs.begin(), lhs.end(), rhs.begin(), rhs.end()).first - lhs.begin();
+				}
+			}
+		}
+		
+		std::size_t size() const { return text.size(); }
+		std::string_view text_view() const { return std::string_view(reinterpret_cast <char const *>(text.data()), text.size()); }
+		
+		// Bit-compressed copy of the suffix array, as built by SDSL.
+		sdsl::int_vector <0> sa_vector() const
+		{
+			sdsl::int_vector <0> retval(sa.size(), 0, sdsl::bits::hi(text.size()) + 1);
+			std::copy(sa.begin(), sa.end(), retval.begin());
+			return retval;
+		}
+		
+		// The range of the suffixes that have the given prefix.
+		std::pair <std::size_t, std::size_t> range(std::string_view const pattern) const
+		{
+			auto const text__(text_view());
+			auto const lb(std::partition_point(sa.begin(), sa.end(), [text__, pattern](auto const pos){
+				return text__.substr(pos, pattern.size()) < pattern;
+			}));
+			auto const rb(std::partition_point(lb, sa.end(), [text__, pattern](auto const pos){
+				return text__.substr(pos, pattern.size()) == pattern;
+			}));
+			return {lb - sa.begin(), rb - sa.begin()};
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <founder_graphs/msa_reader.hh>
+#include <founder_graphs/packed_msa.hh>
+#include <founder_graphs/reverse_msa_reader.hh>
+#include <fstream>
+#include <rapidcheck.h>
+#include <rapidcheck/catch.h>
+#include <string>
+#include <vector>
+
+namespace fg	= founder_graphs;
+
+
+namespace {
+	
+	std::string const PACKED_MSA_TEST_PATH((std::filesystem::temp_directory_path() / "founder-graphs-packed-msa-test.dat").string());
+	
+	
+	void write_packed_msa(std::vector <std::string> const &rows, std::size_t const tile_width, std::string const &path)
+	{
+		auto const aligned_size(rows.front().size());
+		std::ofstream stream(path, std::ios_base::binary | std::ios_base::trunc);
+		REQUIRE(stream.is_open());
+		
+		fg::packed_msa_writer writer(stream, rows.size(), aligned_size, tile_width);
+		writer.write_header();
+		
+		std::vector <fg::packed_msa_writer::row_span_type> spans(rows.size());
+		for (std::size_t lb(0); lb < aligned_size; lb += tile_width)
+		{
+			auto const rb(std::min(aligned_size, lb + tile_width));
+			for (std::size_t i(0); i < rows.size(); ++i)
+				spans[i] = fg::packed_msa_writer::row_span_type(rows[i].data() + lb, rb - lb);
+			writer.write_tile(spans);
+		}
+		
+		writer.finish();
+	}
+	
+	
+	// Read the columns from right to left and compare to the rows.
+	bool test_reverse_reader(std::vector <std::string> const &rows, fg::msa_buffer_layout const layout)
+	{
+		auto const row_count(rows.size());
+		auto const aligned_size(rows.front().size());
+		
+		fg::packed_reverse_msa_reader reader;
+		reader.set_layout(layout);
+		reader.add_file(PACKED_MSA_TEST_PATH);
+		reader.prepare();
+		
+		if (! (reader.handle_count() == row_count && reader.aligned_size() == aligned_size))
+			return false;
+		
+		bool retval(true);
+		std::size_t base_position{};
+		while (reader.fill_buffer([&](bool const did_read){
+			if (!did_read)
+				return false;
+			
+			auto const block_size(reader.block_size());
+			for (std::size_t i(0); i < block_size; ++i)
+			{
+				auto const column(aligned_size - base_position - i - 1);
+				for (std::size_t j(0); j < row_count; ++j)
+				{
+					if (reader.character(i, j) != rows[j][column])
+						retval = false;
+					
+					if (fg::msa_buffer_layout::column_major == layout && reader.column(i)[j] != rows[j][column])
+						retval = false;
+				}
+			}
+			
+			base_position += block_size;
+			return true;
+		}));
+		
+		return retval && base_position == aligned_size;
+	}
+	
+	
+	// Read the given range and compare to the rows.
+	bool test_forward_reader(std::vector <std::string> const &rows, std::size_t const lb, std::size_t const rb)
+	{
+		fg::packed_msa_reader reader;
+		reader.add_file(PACKED_MSA_TEST_PATH);
+		reader.prepare();
+		
+		if (! (reader.handle_count() == rows.size() && reader.aligned_size() == rows.front().size()))
+			return false;
+		
+		return reader.fill_buffer(lb, rb, [&rows, lb, rb](auto const &spans){
+			if (spans.size() != rows.size())
+				return false;
+			
+			for (std::size_t i(0); i < rows.size(); ++i)
+			{
+				auto const &span(spans[i]);
+				if (! std::equal(span.begin(), span.end(), rows[i].begin() + lb, rows[i].begin() + rb))
+					return false;
+			}
+			
+			return true;
+		});
+	}
+}
+
+
+SCENARIO("A packed MSA can be read in both directions", "[packed_msa]")
+{
+	GIVEN("Some aligned sequences with characters outside the packed alphabet")
+	{
+		std::vector <std::string> const rows{
+			"AC--GT-ANNac",
+			"------------",
+			"ACGTACGTACGT",
+			"-A-C-G-T*RYK",
+			"acgtnWS*BDHV",
+			"TTTTTTTTTTTT"
+		};
+		
+		auto const tile_width(GENERATE(1, 5, 12, 64));
+		write_packed_msa(rows, tile_width, PACKED_MSA_TEST_PATH);
+		
+		WHEN("the packed MSA is read from right to left")
+		{
+			THEN("the columns match the rows in both layouts")
+			{
+				CHECK(test_reverse_reader(rows, fg::msa_buffer_layout::row_major));
+				CHECK(test_reverse_reader(rows, fg::msa_buffer_layout::column_major));
+			}
+		}
+		
+		WHEN("ranges of the packed MSA are read from left to right")
+		{
+			THEN("the ranges match the rows")
+			{
+				CHECK(test_forward_reader(rows, 0, 12));
+				CHECK(test_forward_reader(rows, 3, 9));
+				CHECK(test_forward_reader(rows, 11, 12));
+			}
+		}
+	}
+}
+
+
+TEST_CASE("Reading a packed MSA reproduces the input", "[packed_msa]")
+{
+	rc::prop("The packed MSA matches the input rows", [](){
+		auto const aligned_size(*rc::gen::inRange <std::size_t>(1, 64));
+		auto const tile_width(*rc::gen::inRange <std::size_t>(1, 2 + aligned_size));
+		auto const rows(*rc::gen::nonEmpty(rc::gen::container <std::vector <std::string>>(
+			rc::gen::container <std::string>(aligned_size, rc::gen::element('A', 'C', 'G', 'T', 'N', '-', 'a', 'R', 'W', '*'))
+		)));
+		auto const lb(*rc::gen::inRange <std::size_t>(0, aligned_size));
+		auto const rb(*rc::gen::inRange <std::size_t>(1 + lb, 1 + aligned_size));
+		
+		write_packed_msa(rows, tile_width, PACKED_MSA_TEST_PATH);
+		RC_ASSERT(test_reverse_reader(rows, fg::msa_buffer_layout::row_major));
+		RC_ASSERT(test_reverse_reader(rows, fg::msa_buffer_layout::column_major));
+		RC_ASSERT(test_forward_reader(rows, lb, rb));
+	});
+}
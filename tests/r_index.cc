@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <founder_graphs/r_index.hh>
+#include <rapidcheck.h>
+#include <rapidcheck/catch.h>
+#include <string>
+#include "naive_suffix_array.hh"
+
+namespace fg	= founder_graphs;
+namespace fgt	= founder_graphs::tests;
+
+
+namespace {
+	
+	constexpr static std::size_t const MAX_PATTERN_LENGTH{16};
+	
+	
+	bool test_r_index(std::string const &text)
+	{
+		fgt::naive_suffix_array const expected(text);
+		auto const expected_text(expected.text_view());
+		
+		fg::r_index index;
+		{
+			fg::r_index_builder builder;
+			for (std::size_t i(0); i < expected.sa.size(); ++i)
+				builder.add(expected.bwt[i], expected.sa[i], expected.lcp[i]);
+			builder.finish(index);
+		}
+		
+		auto const size(expected.size());
+		if (index.size() != size)
+			return false;
+		
+		if (index.max_lcp() != *std::max_element(expected.lcp.begin(), expected.lcp.end()))
+			return false;
+		
+		// Rank.
+		for (std::size_t comp(0); comp < index.sigma; ++comp)
+		{
+			char const cc(index.comp2char[comp]);
+			for (std::size_t i(0); i <= size; ++i)
+			{
+				if (index.rank(i, comp) != std::size_t(std::count(expected.bwt.begin(), expected.bwt.begin() + i, cc)))
+					return false;
+			}
+		}
+		
+		// Φ⁻¹ and PLCP.
+		for (std::size_t pos(0); pos < size; ++pos)
+		{
+			auto const rank(expected.isa[pos]);
+			if (index.plcp(pos) != expected.lcp[rank])
+				return false;
+			
+			if (rank + 1 < size && index.phi_inverse(pos) != expected.sa[rank + 1])
+				return false;
+		}
+		
+		// Backward search from each text position.
+		for (std::size_t pos(0); pos < size; ++pos)
+		{
+			fg::r_index::range_type range(index);
+			for (std::size_t lb(pos); 0 < lb && pos - lb < MAX_PATTERN_LENGTH; --lb)
+			{
+				if (0 == range.backward_search(index, expected_text[lb - 1]))
+					return false;
+				
+				auto const [expected_lb, expected_rb] = expected.range(expected_text.substr(lb - 1, pos - lb + 1));
+				if (! (range.lb == expected_lb && range.rb + 1 == expected_rb))
+					return false;
+				
+				if (! (range.sa_lb == expected.sa[range.lb] && range.sa_rb == expected.sa[range.rb]))
+					return false;
+			}
+		}
+		
+		// Backward search with a character that does not occur in the text.
+		{
+			fg::r_index::range_type range(index);
+			if (0 != range.backward_search(index, 'Z') || !range.empty())
+				return false;
+		}
+		
+		return true;
+	}
+}
+
+
+SCENARIO("r_index supports backward search with toeholds, Φ⁻¹ and PLCP", "[r_index]")
+{
+	GIVEN("A text with repeated sequences")
+	{
+		std::string const text("#AACGTAACG#AACGTTACG#AACGTAACG#AACGTAACG");
+		
+		WHEN("the index is built")
+		{
+			THEN("the queries match the naïvely computed values")
+			{
+				CHECK(test_r_index(text));
+			}
+		}
+	}
+	
+	GIVEN("A text with a single character")
+	{
+		std::string const text("#");
+		
+		WHEN("the index is built")
+		{
+			THEN("the queries match the naïvely computed values")
+			{
+				CHECK(test_r_index(text));
+			}
+		}
+	}
+}
+
+
+TEST_CASE("r_index handles arbitrary texts", "[r_index]")
+{
+	rc::prop("The queries match the naïvely computed values", [](){
+		auto const text(*rc::gen::container <std::string>(rc::gen::elementOf(std::string("#ACGT"))));
+		RC_ASSERT(test_r_index(text));
+	});
+}
+
+
+TEST_CASE("r_index handles repetitive texts", "[r_index]")
+{
+	rc::prop("The queries match the naïvely computed values", [](){
+		auto const sequence(*rc::gen::container <std::string>(rc::gen::elementOf(std::string("ACGT"))));
+		auto const copy_count(*rc::gen::inRange <std::size_t>(1, 8));
+		std::string text;
+		for (std::size_t i(0); i < copy_count; ++i)
+		{
+			text += '#';
+			text += sequence;
+			if (!sequence.empty())
+				text[text.size() - 1 - *rc::gen::inRange <std::size_t>(0, sequence.size())] = 'T';
+		}
+		RC_ASSERT(test_r_index(text));
+	});
+}
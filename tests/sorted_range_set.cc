@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <catch2/catch.hpp>
+#include <founder_graphs/cst.hh>
+#include <founder_graphs/sorted_range_set.hh>
+#include <rapidcheck.h>
+#include <rapidcheck/catch.h>
+#include <sdsl/construct.hpp>
+#include <string>
+#include <vector>
+
+namespace fg	= founder_graphs;
+
+
+namespace {
+	
+	typedef fg::sorted_range_set <fg::csa_type>	range_set_type;
+	typedef range_set_type::range_type			range_type;
+	
+	
+	// Aligned sequences with equal lengths.
+	struct aligned_sequences
+	{
+		std::vector <std::string>	sequences;
+		std::size_t					aligned_size{};
+	};
+	
+	
+	std::ostream &operator<<(std::ostream &os, aligned_sequences const &seqs)
+	{
+		for (auto const &seq : seqs.sequences)
+			os << seq << '\n';
+		return os;
+	}
+	
+	
+	void build_csa(aligned_sequences const &seqs, fg::csa_type &csa)
+	{
+		// Concatenate the sequences without gaps.
+		std::string text;
+		for (auto const &seq : seqs.sequences)
+		{
+			for (auto const cc : seq)
+			{
+				if ('-' != cc)
+					text.push_back(cc);
+			}
+			text.push_back('#');
+		}
+		
+		sdsl::construct_im(csa, text, 1);
+	}
+	
+	
+	// Check the equivalence classes against ranges determined separately for each sequence.
+	bool check_classes(range_set_type const &range_set, std::vector <range_type> const &expected_ranges)
+	{
+		std::vector <bool> seen_members(expected_ranges.size(), false);
+		range_type const *prev_range{};
+		for (auto const &eq_class : range_set.classes())
+		{
+			auto const &range(eq_class.range);
+			
+			// Check the order. Equal ranges should have been merged.
+			if (prev_range && !(prev_range->lb < range.lb || (prev_range->lb == range.lb && range.rb < prev_range->rb)))
+				return false;
+			prev_range = &range;
+			
+			if (0 == eq_class.member_count)
+				return false;
+			
+			for (auto const idx : range_set.members(eq_class))
+			{
+				if (seen_members[idx])
+					return false;
+				seen_members[idx] = true;
+				
+				auto const &expected_range(expected_ranges[idx]);
+				if (! (range.lb == expected_range.lb && range.rb == expected_range.rb))
+					return false;
+			}
+		}
+		
+		return std::all_of(seen_members.begin(), seen_members.end(), [](auto const val){ return val; });
+	}
+	
+	
+	bool test_range_set(aligned_sequences const &seqs)
+	{
+		fg::csa_type csa;
+		build_csa(seqs, csa);
+		
+		auto const seq_count(seqs.sequences.size());
+		range_set_type range_set(csa, seq_count);
+		std::vector <range_type> expected_ranges(seq_count, range_type(csa));
+		for (std::size_t i(0); i < seqs.aligned_size; ++i)
+		{
+			auto const col(seqs.aligned_size - i - 1);
+			range_set.backward_search(csa, '-', [&seqs, col](std::size_t const idx){
+				return seqs.sequences[idx][col];
+			});
+			
+			for (std::size_t j(0); j < seq_count; ++j)
+			{
+				auto const cc(seqs.sequences[j][col]);
+				if ('-' != cc)
+					expected_ranges[j].backward_search(csa, cc);
+			}
+			
+			if (!check_classes(range_set, expected_ranges))
+				return false;
+		}
+		
+		return true;
+	}
+}
+
+
+namespace rc {
+	
+	template <>
+	struct Arbitrary <aligned_sequences>
+	{
+		static Gen <aligned_sequences> arbitrary()
+		{
+			return gen::mapcat(gen::inRange <std::size_t>(1, 32), [](std::size_t const aligned_size){
+				return gen::map(
+					gen::nonEmpty(
+						gen::container <std::vector <std::string>>(
+							gen::container <std::string>(aligned_size, gen::element('A', 'C', 'G', 'T', '-'))
+						)
+					),
+					[aligned_size](std::vector <std::string> &&sequences){
+						return aligned_sequences{std::move(sequences), aligned_size};
+					}
+				);
+			});
+		}
+	};
+}
+
+
+SCENARIO("sorted_range_set maintains the equivalence classes of the ranges", "[sorted_range_set]")
+{
+	GIVEN("A small set of aligned sequences")
+	{
+		aligned_sequences const seqs{{
+			"AC-GT",
+			"ACAGT",
+			"-CAG-",
+			"TTTTT",
+			"AC-GT"
+		}, 5};
+		
+		WHEN("backward search is done column by column")
+		{
+			THEN("the equivalence classes match the ranges of the sequences and remain sorted")
+			{
+				CHECK(test_range_set(seqs));
+			}
+		}
+	}
+}
+
+
+TEST_CASE("sorted_range_set produces the same ranges as backward search by sequence", "[sorted_range_set]")
+{
+	rc::prop("sorted_range_set::classes() match the ranges of the sequences in sorted order", [](aligned_sequences const &seqs){
+		return test_range_set(seqs);
+	});
+}
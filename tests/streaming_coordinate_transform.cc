@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2022 Tuukka Norri
+ * This code is licensed under MIT license (see LICENSE for details).
+ */
+
+#include <catch2/catch.hpp>
+#include <founder_graphs/streaming_coordinate_transform.hh>
+#include <rapidcheck.h>
+#include <rapidcheck/catch.h>
+#include <string>
+#include <vector>
+
+namespace fg	= founder_graphs;
+
+
+namespace {
+	
+	// Check the result of non_gap_column() against that of counting the characters.
+	bool test_coordinate_transform(std::vector <std::string> const &rows, std::size_t const window_size)
+	{
+		if (rows.empty())
+			return true;
+		
+		auto const aligned_size(rows.front().size());
+		fg::streaming_coordinate_transform transform(rows.size(), window_size);
+		for (std::size_t i(0); i < aligned_size; ++i)
+		{
+			auto const column(aligned_size - i - 1);
+			transform.add_column(column, [&rows, column](std::size_t const row_idx){ return '-' == rows[row_idx][column]; });
+			
+			for (std::size_t row_idx(0); row_idx < rows.size(); ++row_idx)
+			{
+				auto const &row(rows[row_idx]);
+				std::size_t count{};
+				for (std::size_t expected_column(column); expected_column < aligned_size; ++expected_column)
+				{
+					if ('-' == row[expected_column])
+						continue;
+					
+					++count;
+					if (window_size < count)
+						break;
+					
+					if (transform.non_gap_column(row_idx, count) != expected_column)
+						return false;
+				}
+			}
+		}
+		
+		return true;
+	}
+}
+
+
+SCENARIO("streaming_coordinate_transform determines the columns of non-gap characters", "[streaming_coordinate_transform]")
+{
+	GIVEN("Some aligned sequences")
+	{
+		std::vector <std::string> const rows{
+			"AC--GT-A",
+			"--------",
+			"ACGTACGT",
+			"-A-C-G-T"
+		};
+		
+		WHEN("the window is not limited")
+		{
+			THEN("the columns match those determined by counting")
+			{
+				CHECK(test_coordinate_transform(rows, fg::streaming_coordinate_transform::WINDOW_SIZE_MAX));
+			}
+		}
+		
+		WHEN("the window is limited")
+		{
+			THEN("the columns inside the window match those determined by counting")
+			{
+				CHECK(test_coordinate_transform(rows, 2));
+			}
+		}
+	}
+}
+
+
+TEST_CASE("streaming_coordinate_transform matches counting non-gap characters", "[streaming_coordinate_transform]")
+{
+	rc::prop("non_gap_column() returns the column of the given non-gap character", [](){
+		auto const aligned_size(*rc::gen::inRange <std::size_t>(1, 64));
+		auto const window_size(*rc::gen::inRange <std::size_t>(1, 2 + aligned_size));
+		auto const rows(*rc::gen::container <std::vector <std::string>>(
+			rc::gen::container <std::string>(aligned_size, rc::gen::element('A', '-'))
+		));
+		return test_coordinate_transform(rows, window_size);
+	});
+}